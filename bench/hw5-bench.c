@@ -0,0 +1,744 @@
+/*
+ * HW5 benchmark driver. Generates synthetic inputs, runs every engine against them, and prints one JSON object per
+ * (distribution, engine) pair to standard output.
+ *
+ * Usage: hw5-bench [--inputs N] [--records M] [--runs R] [--dir DIRECTORY] [--fifo] [--handoff condition|event]
+ *                  [--spin-rounds N] [--yield-rounds N] [--hogs N] [--format character|line|fixed:N|delimited:C]
+ *                  [--gzip-output LEVEL]
+ *
+ * --fifo feeds each input to the engines through a named pipe written by its own process, rather than as a regular
+ * file. --hogs runs N busy-looping processes alongside the engines, to measure them on an oversubscribed machine.
+ * --format selects how the engines split the inputs into records; the inputs are generated the same way regardless.
+ * --gzip-output has the engines compress the output at the given zlib level (0-9).
+ *
+ * Every run's output is checked against the reference interleave of the inputs, pulled from a Hw5Interleaver. The
+ * ns_per_record_run_* fields are percentiles across runs of each run's time divided by its record count, not
+ * percentiles of the latency of individual records.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../include/hw5.h"
+
+#include "../include/util/memory.h"
+#include "../include/util/file.h"
+#include "../include/util/gzip.h"
+#include "../include/util/record.h"
+#include "../include/util/thread.h"
+#include "../include/util/stats.h"
+#include "../include/util/string.h"
+#include "../include/util/guard.h"
+#include "../include/util/error.h"
+#include "../include/util/macro.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+enum BenchDistribution {
+    /**
+     * Every input holds the same number of two-byte `"X\n"` records.
+     */
+    BENCH_DISTRIBUTION_UNIFORM,
+
+    /**
+     * Input i holds 1/(i+1) as many two-byte `"X\n"` records as the first input.
+     */
+    BENCH_DISTRIBUTION_SKEWED,
+
+    /**
+     * Every input holds uniformly random bytes (including whitespace), twice as many as it would hold records.
+     */
+    BENCH_DISTRIBUTION_RANDOM
+};
+
+struct BenchEngine {
+    char const *name;
+    enum Hw5Engine engine;
+};
+
+struct BenchConfig {
+    size_t inputCount;
+    size_t recordCount;
+    size_t runCount;
+    char const *directory;
+
+    bool fifoInputs;
+    struct RecordFormat recordFormat;
+    char const *recordFormatName;
+    enum Hw5Handoff handoff;
+    unsigned int handoffSpinRounds;
+    unsigned int handoffYieldRounds;
+    size_t hogCount;
+
+    bool gzipOutput;
+    unsigned int gzipOutputLevel;
+};
+
+/**
+ * The measurements of one run, taken by the child process that performed it.
+ */
+struct BenchRunResult {
+    uint64_t elapsedNanoseconds;
+    long peakResidentKibibytes;
+};
+
+static struct BenchEngine const benchEngines[] = {
+    { .name = "stream", .engine = HW5_ENGINE_STREAM },
+    { .name = "partitioned", .engine = HW5_ENGINE_PARTITIONED },
+    { .name = "uring", .engine = HW5_ENGINE_URING },
+    { .name = "epoll", .engine = HW5_ENGINE_EPOLL }
+};
+
+static char const * const benchDistributionNames[] = {
+    [BENCH_DISTRIBUTION_UNIFORM] = "uniform",
+    [BENCH_DISTRIBUTION_SKEWED] = "skewed",
+    [BENCH_DISTRIBUTION_RANDOM] = "random"
+};
+
+static size_t const generatorBufferSize = 1048576;
+static size_t const decodeBufferSize = 1048576;
+
+static struct BenchConfig parseBenchConfig(int argc, char **argv);
+static size_t parseSize(char const *text, char const *optionName);
+static unsigned int parseUnsignedInt(char const *text, char const *optionName);
+
+static struct RecordFormat parseRecordFormat(char const *text);
+
+static size_t generateInputs(
+    struct BenchConfig const *configPtr,
+    enum BenchDistribution distribution,
+    char * const *inFilePaths,
+    size_t *totalOutputLengthOutPtr
+);
+static uint64_t nextRandom(uint64_t *statePtr);
+static size_t countFileRecords(
+    char const *filePath,
+    struct RecordFormat const *recordFormatPtr,
+    size_t *outputLengthOutPtr
+);
+
+static struct BenchRunResult runEngineOnce(
+    struct BenchConfig const *configPtr,
+    char * const *inFilePaths,
+    char * const *fifoPaths,
+    char const *outFilePath,
+    enum Hw5Engine engine
+);
+static bool outputMatchesReference(
+    char const *outFilePath,
+    char * const *inFilePaths,
+    size_t inFileCount,
+    struct RecordFormat const *recordFormatPtr,
+    size_t *outFileLengthOutPtr
+);
+static pid_t startFeeder(char const *inFilePath, char const *fifoPath);
+static pid_t startHog(void);
+static pid_t safeFork(char const *callerDescription);
+static void awaitChild(pid_t childId, char const *callerDescription);
+static int compareUint64(void const *aAsVoidPtr, void const *bAsVoidPtr);
+static uint64_t getPercentile(uint64_t const *sortedValues, size_t valueCount, unsigned int percentile);
+
+int main(int const argc, char ** const argv) {
+    struct BenchConfig const config = parseBenchConfig(argc, argv);
+
+    char ** const inFilePaths = safeMalloc(sizeof *inFilePaths * config.inputCount, "main");
+    for (size_t i = 0; i < config.inputCount; i += 1) {
+        inFilePaths[i] = formatString("%s/hw5-bench-%zu.in", config.directory, i);
+    }
+    char * const outFilePath = formatString("%s/hw5-bench.out", config.directory);
+
+    char **fifoPaths = NULL;
+    if (config.fifoInputs) {
+        fifoPaths = safeMalloc(sizeof *fifoPaths * config.inputCount, "main");
+        for (size_t i = 0; i < config.inputCount; i += 1) {
+            fifoPaths[i] = formatString("%s/hw5-bench-%zu.fifo", config.directory, i);
+            unlink(fifoPaths[i]);
+            if (mkfifo(fifoPaths[i], 0600) != 0) {
+                int const mkfifoErrorCode = errno;
+                abortWithErrorFmt(
+                    "main: Failed to create named pipe \"%s\" using mkfifo (error code: %d; error message: \"%s\")",
+                    fifoPaths[i],
+                    mkfifoErrorCode,
+                    strerror(mkfifoErrorCode)
+                );
+            }
+        }
+    }
+
+    pid_t * const hogIds = safeMalloc(sizeof *hogIds * (config.hogCount > 0 ? config.hogCount : 1), "main");
+    for (size_t i = 0; i < config.hogCount; i += 1) {
+        hogIds[i] = startHog();
+    }
+
+    uint64_t * const elapsedNanoseconds = safeMalloc(sizeof *elapsedNanoseconds * config.runCount, "main");
+
+    for (size_t d = 0; d < ARRAY_LENGTH(benchDistributionNames); d += 1) {
+        enum BenchDistribution const distribution = (enum BenchDistribution)d;
+        size_t totalByteCount;
+        size_t const totalRecordCount = generateInputs(&config, distribution, inFilePaths, &totalByteCount);
+
+        for (size_t engineIndex = 0; engineIndex < ARRAY_LENGTH(benchEngines); engineIndex += 1) {
+            struct BenchEngine const * const benchEnginePtr = &benchEngines[engineIndex];
+
+            long peakResidentKibibytes = 0;
+            size_t outFileLength = 0;
+            for (size_t run = 0; run < config.runCount; run += 1) {
+                struct BenchRunResult const result = runEngineOnce(
+                    &config,
+                    inFilePaths,
+                    fifoPaths,
+                    outFilePath,
+                    benchEnginePtr->engine
+                );
+                elapsedNanoseconds[run] = result.elapsedNanoseconds;
+                if (result.peakResidentKibibytes > peakResidentKibibytes) {
+                    peakResidentKibibytes = result.peakResidentKibibytes;
+                }
+
+                // Every engine must produce the same output, record for record
+                if (
+                    !outputMatchesReference(
+                        outFilePath,
+                        inFilePaths,
+                        config.inputCount,
+                        &config.recordFormat,
+                        &outFileLength
+                    )
+                ) {
+                    abortWithErrorFmt(
+                        "main: Engine \"%s\" did not write the reference interleave of its inputs",
+                        benchEnginePtr->name
+                    );
+                }
+            }
+
+            qsort(elapsedNanoseconds, config.runCount, sizeof *elapsedNanoseconds, compareUint64);
+            uint64_t const medianNanoseconds = getPercentile(elapsedNanoseconds, config.runCount, 50);
+            uint64_t const p90Nanoseconds = getPercentile(elapsedNanoseconds, config.runCount, 90);
+            uint64_t const p99Nanoseconds = getPercentile(elapsedNanoseconds, config.runCount, 99);
+            double const medianSeconds = (double)(medianNanoseconds > 0 ? medianNanoseconds : 1) / (double)1000000000u;
+            double const recordDivisor = (double)(totalRecordCount > 0 ? totalRecordCount : 1);
+
+            printf(
+                "{\"distribution\":\"%s\",\"engine\":\"%s\",\"inputs\":%zu,\"records\":%zu,\"bytes\":%zu,\"runs\":%zu,"
+                    "\"input_kind\":\"%s\",\"format\":\"%s\",\"handoff\":\"%s\","
+                    "\"spin_rounds\":%u,\"yield_rounds\":%u,\"hogs\":%zu,"
+                    "\"output_kind\":\"%s\",\"gzip_level\":%u,\"output_file_bytes\":%zu,"
+                    "\"records_per_second\":%.0f,\"bytes_per_second\":%.0f,"
+                    "\"ns_per_record_run_p50\":%.3f,\"ns_per_record_run_p90\":%.3f,"
+                    "\"ns_per_record_run_p99\":%.3f,\"ns_per_record_run_max\":%.3f,\"peak_rss_kib\":%ld}\n",
+                benchDistributionNames[distribution],
+                benchEnginePtr->name,
+                config.inputCount,
+                totalRecordCount,
+                totalByteCount,
+                config.runCount,
+                config.fifoInputs ? "fifo" : "file",
+                config.recordFormatName,
+                config.handoff == HW5_HANDOFF_EVENT ? "event" : "condition",
+                config.handoffSpinRounds,
+                config.handoffYieldRounds,
+                config.hogCount,
+                config.gzipOutput ? "gzip" : "plain",
+                config.gzipOutputLevel,
+                outFileLength,
+                (double)totalRecordCount / medianSeconds,
+                (double)totalByteCount / medianSeconds,
+                (double)medianNanoseconds / recordDivisor,
+                (double)p90Nanoseconds / recordDivisor,
+                (double)p99Nanoseconds / recordDivisor,
+                (double)elapsedNanoseconds[config.runCount - 1] / recordDivisor,
+                peakResidentKibibytes
+            );
+            fflush(stdout);
+        }
+    }
+
+    for (size_t i = 0; i < config.hogCount; i += 1) {
+        kill(hogIds[i], SIGKILL);
+        waitpid(hogIds[i], NULL, 0);
+    }
+    free(hogIds);
+
+    for (size_t i = 0; i < config.inputCount; i += 1) {
+        unlink(inFilePaths[i]);
+        free(inFilePaths[i]);
+        if (fifoPaths != NULL) {
+            unlink(fifoPaths[i]);
+            free(fifoPaths[i]);
+        }
+    }
+    unlink(outFilePath);
+    free(inFilePaths);
+    free(fifoPaths);
+    free(outFilePath);
+    free(elapsedNanoseconds);
+
+    return EXIT_SUCCESS;
+}
+
+static struct BenchConfig parseBenchConfig(int const argc, char ** const argv) {
+    struct BenchConfig config = {
+        .inputCount = 8,
+        .recordCount = 4000000,
+        .runCount = 11,
+        .directory = "/tmp",
+
+        .fifoInputs = false,
+        .recordFormat = characterRecordFormat(),
+        .recordFormatName = "character",
+        .handoff = HW5_HANDOFF_CONDITION,
+        .handoffSpinRounds = 0,
+        .handoffYieldRounds = 0,
+        .hogCount = 0,
+
+        .gzipOutput = false,
+        .gzipOutputLevel = 0
+    };
+
+    for (int i = 1; i < argc; i += 1) {
+        char const * const option = argv[i];
+        if (strcmp(option, "--fifo") == 0) {
+            config.fifoInputs = true;
+            continue;
+        }
+
+        if (i + 1 == argc) {
+            abortWithErrorFmt("parseBenchConfig: Option \"%s\" is unknown or missing its value", option);
+        }
+        char const * const value = argv[i + 1];
+        i += 1;
+
+        if (strcmp(option, "--inputs") == 0) {
+            config.inputCount = parseSize(value, option);
+        } else if (strcmp(option, "--records") == 0) {
+            config.recordCount = parseSize(value, option);
+        } else if (strcmp(option, "--runs") == 0) {
+            config.runCount = parseSize(value, option);
+        } else if (strcmp(option, "--dir") == 0) {
+            config.directory = value;
+        } else if (strcmp(option, "--format") == 0) {
+            config.recordFormat = parseRecordFormat(value);
+            config.recordFormatName = value;
+        } else if (strcmp(option, "--handoff") == 0) {
+            if (strcmp(value, "condition") == 0) {
+                config.handoff = HW5_HANDOFF_CONDITION;
+            } else if (strcmp(value, "event") == 0) {
+                config.handoff = HW5_HANDOFF_EVENT;
+            } else {
+                abortWithErrorFmt("parseBenchConfig: Unknown handoff \"%s\"", value);
+            }
+        } else if (strcmp(option, "--spin-rounds") == 0) {
+            config.handoffSpinRounds = parseUnsignedInt(value, option);
+        } else if (strcmp(option, "--yield-rounds") == 0) {
+            config.handoffYieldRounds = parseUnsignedInt(value, option);
+        } else if (strcmp(option, "--hogs") == 0) {
+            config.hogCount = parseSize(value, option);
+        } else if (strcmp(option, "--gzip-output") == 0) {
+            config.gzipOutput = true;
+            config.gzipOutputLevel = parseUnsignedInt(value, option);
+            guard(config.gzipOutputLevel <= 9, "parseBenchConfig: --gzip-output must be at most 9");
+        } else {
+            abortWithErrorFmt("parseBenchConfig: Unknown option \"%s\"", option);
+        }
+    }
+
+    guard(config.inputCount > 0, "parseBenchConfig: --inputs must be positive");
+    guard(config.runCount > 0, "parseBenchConfig: --runs must be positive");
+    return config;
+}
+
+static size_t parseSize(char const * const text, char const * const optionName) {
+    char *end;
+    errno = 0;
+    unsigned long long const value = strtoull(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0') {
+        abortWithErrorFmt("parseSize: Value \"%s\" of option \"%s\" is not a number", text, optionName);
+    }
+
+    return (size_t)value;
+}
+
+static unsigned int parseUnsignedInt(char const * const text, char const * const optionName) {
+    size_t const value = parseSize(text, optionName);
+    if (value > UINT_MAX) {
+        abortWithErrorFmt("parseUnsignedInt: Value \"%s\" of option \"%s\" is too large", text, optionName);
+    }
+
+    return (unsigned int)value;
+}
+
+static struct RecordFormat parseRecordFormat(char const * const text) {
+    if (strcmp(text, "character") == 0) {
+        return characterRecordFormat();
+    }
+    if (strcmp(text, "line") == 0) {
+        return lineRecordFormat();
+    }
+    if (strncmp(text, "fixed:", 6) == 0) {
+        size_t const length = parseSize(&text[6], "--format");
+        guard(length > 0, "parseRecordFormat: Fixed record length must be positive");
+        return fixedRecordFormat(length);
+    }
+    if (strncmp(text, "delimited:", 10) == 0 && strlen(text) == 11) {
+        return delimitedRecordFormat(text[10]);
+    }
+
+    abortWithErrorFmt("parseRecordFormat: Unknown record format \"%s\"", text);
+    return characterRecordFormat();
+}
+
+/**
+ * Write the benchmark inputs for the given distribution, each to its path.
+ *
+ * @param configPtr The benchmark configuration.
+ * @param distribution The distribution.
+ * @param inFilePaths The input file paths.
+ * @param totalOutputLengthOutPtr Where to store the length of the output that interleaving the inputs produces.
+ *
+ * @returns The total number of records across the inputs, in the configured record format.
+ */
+static size_t generateInputs(
+    struct BenchConfig const * const configPtr,
+    enum BenchDistribution const distribution,
+    char * const * const inFilePaths,
+    size_t * const totalOutputLengthOutPtr
+) {
+    uint64_t randomState = 0x9E3779B97F4A7C15u;
+    size_t totalRecordCount = 0;
+    size_t totalOutputLength = 0;
+
+    for (size_t i = 0; i < configPtr->inputCount; i += 1) {
+        struct BufferedWriter * const writer = bufferedWriterOpen(
+            inFilePaths[i],
+            generatorBufferSize,
+            "generateInputs"
+        );
+
+        size_t recordCount = configPtr->recordCount;
+        bool twoByteRecords = true;
+        switch (distribution) {
+            case BENCH_DISTRIBUTION_UNIFORM: {
+                break;
+            }
+            case BENCH_DISTRIBUTION_SKEWED: {
+                recordCount /= i + 1;
+                break;
+            }
+            case BENCH_DISTRIBUTION_RANDOM: {
+                twoByteRecords = false;
+                break;
+            }
+            default: {
+                abortWithErrorFmt("generateInputs: Unknown distribution %d", (int)distribution);
+                break;
+            }
+        }
+
+        // Produce 8 bytes (4 records, or 8 random bytes) per random number
+        size_t const byteCount = recordCount * 2;
+        for (size_t written = 0; written < byteCount; written += 8) {
+            uint64_t const random = nextRandom(&randomState);
+            size_t const chunkLength = byteCount - written < 8 ? byteCount - written : 8;
+
+            char chunk[8];
+            for (size_t j = 0; j < chunkLength; j += 1) {
+                if (twoByteRecords) {
+                    chunk[j] = j % 2 == 0 ? (char)('a' + (random >> (j * 8)) % 26) : '\n';
+                } else {
+                    chunk[j] = (char)(unsigned char)(random >> (j * 8));
+                }
+            }
+            bufferedWriterWrite(writer, chunk, chunkLength, "generateInputs");
+        }
+
+        bufferedWriterClose(writer, "generateInputs");
+
+        size_t outputLength;
+        totalRecordCount += countFileRecords(inFilePaths[i], &configPtr->recordFormat, &outputLength);
+        totalOutputLength += outputLength;
+    }
+
+    *totalOutputLengthOutPtr = totalOutputLength;
+    return totalRecordCount;
+}
+
+/**
+ * Advance the given xorshift64* state.
+ *
+ * @returns The next pseudo-random number.
+ */
+static uint64_t nextRandom(uint64_t * const statePtr) {
+    uint64_t state = *statePtr;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    *statePtr = state;
+    return state * 0x2545F4914F6CDD1Du;
+}
+
+/**
+ * Count the records of the given file in the given format, and the length of the output they are written as.
+ */
+static size_t countFileRecords(
+    char const * const filePath,
+    struct RecordFormat const * const recordFormatPtr,
+    size_t * const outputLengthOutPtr
+) {
+    struct MappedFile mappedFile;
+    if (!tryMapFile(filePath, &mappedFile, "countFileRecords")) {
+        abortWithErrorFmt("countFileRecords: File \"%s\" is not a regular file", filePath);
+    }
+
+    size_t recordCount;
+    size_t outputLength;
+    if (recordFormatPtr->kind == RECORD_KIND_CHARACTER) {
+        recordCount = countCharacterRecords(mappedFile.data, mappedFile.length, true);
+        outputLength = recordCount * 2;
+    } else {
+        struct RecordScan recordScan;
+        recordScanInit(&recordScan);
+        recordCount = countCompleteRecords(recordFormatPtr, &recordScan, mappedFile.data, mappedFile.length);
+        outputLength = mappedFile.length;
+
+        // The input ends part way through a record
+        char terminator;
+        if (recordScan.recordLength > 0) {
+            recordCount += 1;
+            outputLength += getRecordTerminator(recordFormatPtr, false, &terminator) ? 1 : 0;
+        }
+    }
+
+    unmapFile(&mappedFile, "countFileRecords");
+    *outputLengthOutPtr = outputLength;
+    return recordCount;
+}
+
+/**
+ * Run the given engine once in a child process, so that each run starts from a fresh heap and its peak resident set
+ * size can be measured on its own. With FIFO inputs, each named pipe is fed by its own process for the run.
+ */
+static struct BenchRunResult runEngineOnce(
+    struct BenchConfig const * const configPtr,
+    char * const * const inFilePaths,
+    char * const * const fifoPaths,
+    char const * const outFilePath,
+    enum Hw5Engine const engine
+) {
+    size_t const inFileCount = configPtr->inputCount;
+
+    int pipeFileDescriptors[2];
+    if (pipe(pipeFileDescriptors) != 0) {
+        int const pipeErrorCode = errno;
+        abortWithErrorFmt(
+            "runEngineOnce: Failed to create pipe using pipe (error code: %d; error message: \"%s\")",
+            pipeErrorCode,
+            strerror(pipeErrorCode)
+        );
+    }
+
+    pid_t * const feederIds = safeMalloc(sizeof *feederIds * inFileCount, "runEngineOnce");
+    if (configPtr->fifoInputs) {
+        for (size_t i = 0; i < inFileCount; i += 1) {
+            feederIds[i] = startFeeder(inFilePaths[i], fifoPaths[i]);
+        }
+    }
+
+    pid_t const childId = safeFork("runEngineOnce");
+    if (childId == 0) {
+        safeClose(pipeFileDescriptors[0], "runEngineOnce");
+
+        struct Hw5Options options = hw5DefaultOptions();
+        options.engine = engine;
+        options.recordFormat = configPtr->recordFormat;
+        options.handoff = configPtr->handoff;
+        options.handoffSpinRounds = configPtr->handoffSpinRounds;
+        options.handoffYieldRounds = configPtr->handoffYieldRounds;
+        options.gzipOutput = configPtr->gzipOutput;
+        options.gzipOutputLevel = (int)configPtr->gzipOutputLevel;
+
+        char * const * const enginePaths = configPtr->fifoInputs ? fifoPaths : inFilePaths;
+        uint64_t const startNanoseconds = getMonotonicNanoseconds();
+        hw5WithOptions((char const * const *)enginePaths, inFileCount, outFilePath, &options);
+        uint64_t const endNanoseconds = getMonotonicNanoseconds();
+
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+
+        struct BenchRunResult const result = {
+            .elapsedNanoseconds = endNanoseconds - startNanoseconds,
+            .peakResidentKibibytes = usage.ru_maxrss
+        };
+        ssize_t const writeResult = write(pipeFileDescriptors[1], &result, sizeof result);
+        _exit(writeResult == (ssize_t)sizeof result ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    safeClose(pipeFileDescriptors[1], "runEngineOnce");
+    struct BenchRunResult result;
+    size_t const readLength = safeRead(pipeFileDescriptors[0], (char *)&result, sizeof result, "runEngineOnce");
+    safeClose(pipeFileDescriptors[0], "runEngineOnce");
+
+    awaitChild(childId, "runEngineOnce");
+    if (configPtr->fifoInputs) {
+        for (size_t i = 0; i < inFileCount; i += 1) {
+            awaitChild(feederIds[i], "runEngineOnce");
+        }
+    }
+    free(feederIds);
+
+    if (readLength != sizeof result) {
+        abortWithError("runEngineOnce: Benchmark run failed");
+    }
+
+    return result;
+}
+
+/**
+ * Determine whether the given output file's contents, decoded if it is gzip-compressed, are the reference interleave
+ * of the given inputs, and get the length of the output file itself.
+ */
+static bool outputMatchesReference(
+    char const * const outFilePath,
+    char * const * const inFilePaths,
+    size_t const inFileCount,
+    struct RecordFormat const * const recordFormatPtr,
+    size_t * const outFileLengthOutPtr
+) {
+    struct stat fileStatus;
+    if (stat(outFilePath, &fileStatus) != 0) {
+        return false;
+    }
+    *outFileLengthOutPtr = (size_t)fileStatus.st_size;
+
+    FILE * const outFile = safeFopenDecoded(outFilePath, "outputMatchesReference");
+    struct Hw5Interleaver * const interleaver = hw5InterleaverCreate(
+        (char const * const *)inFilePaths,
+        inFileCount,
+        recordFormatPtr,
+        NULL
+    );
+    char * const outBuffer = safeMalloc(sizeof *outBuffer * decodeBufferSize, "outputMatchesReference");
+    char * const referenceBuffer = safeMalloc(sizeof *referenceBuffer * decodeBufferSize, "outputMatchesReference");
+
+    bool matches = true;
+    while (true) {
+        size_t const referenceLength = hw5InterleaverRead(interleaver, referenceBuffer, decodeBufferSize);
+
+        // Once the reference has ended, reading one more byte shows whether the output has too
+        size_t const outLength = safeFread(
+            outBuffer,
+            1,
+            referenceLength > 0 ? referenceLength : 1,
+            outFile,
+            "outputMatchesReference"
+        );
+        if (outLength != referenceLength || memcmp(outBuffer, referenceBuffer, referenceLength) != 0) {
+            matches = false;
+            break;
+        }
+        if (referenceLength == 0) {
+            break;
+        }
+    }
+
+    free(outBuffer);
+    free(referenceBuffer);
+    hw5InterleaverDestroy(interleaver);
+    fclose(outFile);
+    return matches;
+}
+
+/**
+ * Start a process that writes the given input file into the given named pipe, then exits.
+ */
+static pid_t startFeeder(char const * const inFilePath, char const * const fifoPath) {
+    pid_t const feederId = safeFork("startFeeder");
+    if (feederId != 0) {
+        return feederId;
+    }
+
+    struct MappedFile inFile;
+    if (!tryMapFile(inFilePath, &inFile, "startFeeder")) {
+        abortWithErrorFmt("startFeeder: File \"%s\" is not a regular file", inFilePath);
+    }
+
+    // Opening the named pipe blocks until the engine opens it for reading
+    struct BufferedWriter * const writer = bufferedWriterOpen(fifoPath, generatorBufferSize, "startFeeder");
+    bufferedWriterWrite(writer, inFile.data, inFile.length, "startFeeder");
+    bufferedWriterClose(writer, "startFeeder");
+
+    unmapFile(&inFile, "startFeeder");
+    _exit(EXIT_SUCCESS);
+}
+
+/**
+ * Start a process that busy-loops until it is killed.
+ */
+static pid_t startHog(void) {
+    pid_t const hogId = safeFork("startHog");
+    if (hogId != 0) {
+        return hogId;
+    }
+
+    while (true) {
+        cpuRelax();
+    }
+}
+
+static pid_t safeFork(char const * const callerDescription) {
+    pid_t const childId = fork();
+    if (childId < 0) {
+        int const forkErrorCode = errno;
+        abortWithErrorFmt(
+            "%s: Failed to create process using fork (error code: %d; error message: \"%s\")",
+            callerDescription,
+            forkErrorCode,
+            strerror(forkErrorCode)
+        );
+    }
+
+    return childId;
+}
+
+/**
+ * Wait for the given child process, aborting unless it exited successfully.
+ */
+static void awaitChild(pid_t const childId, char const * const callerDescription) {
+    int childStatus;
+    if (waitpid(childId, &childStatus, 0) != childId || !WIFEXITED(childStatus)
+        || WEXITSTATUS(childStatus) != EXIT_SUCCESS) {
+        abortWithErrorFmt("%s: Benchmark process %ld failed", callerDescription, (long)childId);
+    }
+}
+
+static int compareUint64(void const * const aAsVoidPtr, void const * const bAsVoidPtr) {
+    uint64_t const a = *(uint64_t const *)aAsVoidPtr;
+    uint64_t const b = *(uint64_t const *)bAsVoidPtr;
+    return (a > b) - (a < b);
+}
+
+/**
+ * Get the nearest-rank percentile of the given sorted values.
+ */
+static uint64_t getPercentile(
+    uint64_t const * const sortedValues,
+    size_t const valueCount,
+    unsigned int const percentile
+) {
+    size_t rank = (valueCount * percentile + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    return sortedValues[rank - 1];
+}
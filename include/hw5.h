@@ -1,9 +1,153 @@
 #pragma once
 
+#include "./util/record.h"
+#include "./util/schedule.h"
+#include "./hw5/interleaver.h"
+
 #include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * The strategy used to produce the output file. Every engine produces byte-identical output.
+ */
+enum Hw5Engine {
+    /**
+     * Interleave on the calling thread. Regular input files are mapped; other inputs are read by a bounded pool of
+     * worker threads. Gzip-compressed inputs, detected by their magic bytes, are decoded by the worker threads while
+     * the output is written. Runs with inputs that are not regular files (e.g. FIFOs, whose producers may need them
+     * drained in any order) go to HW5_ENGINE_EPOLL unless they are checkpointed. HW5_ENGINE_PARTITIONED and
+     * HW5_ENGINE_URING fall back to this one if any input is a gzip-compressed regular file.
+     */
+    HW5_ENGINE_STREAM,
+
+    /**
+     * Index the record counts of every input in parallel, then split the rounds across worker threads which write to
+     * precomputed offsets of a pre-sized output file. Inputs that are not all regular files, and record formats other
+     * than RECORD_KIND_CHARACTER, fall back to HW5_ENGINE_STREAM.
+     */
+    HW5_ENGINE_PARTITIONED,
+
+    /**
+     * Interleave on the calling thread with no reader threads. Every input is read ahead by reads submitted through a
+     * single io_uring, or with pread where io_uring is unavailable. Gzip-compressed inputs that are not regular files
+     * are decoded on the calling thread.
+     */
+    HW5_ENGINE_URING,
+
+    /**
+     * Interleave on the calling thread with no reader threads. Uncompressed regular input files are mapped; other
+     * inputs (e.g. FIFOs) are read non-blocking into per-input buffers as a single epoll instance reports them
+     * readable, and decoded on the calling thread if they are gzip-compressed.
+     */
+    HW5_ENGINE_EPOLL
+};
+
+/**
+ * How HW5_ENGINE_STREAM hands characters between reader tasks and the writer when one side has to wait for the other.
+ */
+enum Hw5Handoff {
+    /**
+     * Park on a mutex and condition variable.
+     */
+    HW5_HANDOFF_CONDITION,
+
+    /**
+     * Park on a futex-backed event, which needs no mutex and makes a system call only when the other side is asleep.
+     */
+    HW5_HANDOFF_EVENT
+};
+
+struct Hw5Options {
+    enum Hw5Engine engine;
+
+    /**
+     * How records are read from each input and written to the output.
+     */
+    struct RecordFormat recordFormat;
+
+    /**
+     * The order in which records are taken from the inputs (see interleaveScheduleCreateWeighted and
+     * interleaveScheduleCreatePattern), which must be for inFileCount inputs. Null to take one record from each input
+     * in turn. HW5_ENGINE_PARTITIONED falls back to HW5_ENGINE_STREAM for any other schedule.
+     */
+    struct InterleaveSchedule const *schedule;
+
+    enum Hw5Handoff handoff;
+
+    /**
+     * The number of rounds a thread waiting on a handoff busy-waits before it parks, each round twice as long as the
+     * last (up to a cap). 0 to not spin.
+     */
+    unsigned int handoffSpinRounds;
+
+    /**
+     * The number of times a thread waiting on a handoff yields the processor, after spinning and before it parks. 0 to
+     * not yield.
+     */
+    unsigned int handoffYieldRounds;
+
+    /**
+     * The number of worker threads for engines that use them, or 0 for one per online processor.
+     */
+    size_t workerCount;
+
+    /**
+     * The processors to pin the run's threads to, or null to leave them unpinned. The calling thread, which writes the
+     * output, is pinned to the first for the duration of the run, and each worker thread to one of the rest in turn
+     * (or to the first if there is only one).
+     */
+    size_t const *cpus;
+    size_t cpuCount;
+
+    /**
+     * The stack size in bytes of each worker thread, or 0 for the default.
+     */
+    size_t workerStackSize;
+
+    /**
+     * Whether to write the output as a gzip stream rather than as is. The output is compressed in independent blocks
+     * (each a gzip member, as pigz does) on workerCount threads while the records are written. HW5_ENGINE_PARTITIONED
+     * falls back to HW5_ENGINE_STREAM when compressing.
+     */
+    bool gzipOutput;
+
+    /**
+     * The zlib compression level used if gzipOutput is set: 0 (none) to 9 (best), or -1 for zlib's default (6).
+     */
+    int gzipOutputLevel;
+
+    /**
+     * Where to save checkpoints of the run, or null to not take any. If the file exists when the run starts, the run
+     * resumes from the checkpoint in it, discarding any output written after the checkpoint; the file is removed once
+     * the run completes. Checkpoints need HW5_ENGINE_STREAM (which every engine falls back to when checkpointing),
+     * inputs that are all uncompressed regular files, and uncompressed output.
+     */
+    char const *checkpointPath;
+
+    /**
+     * The number of bytes of output written between checkpoints. Each checkpoint syncs the output to storage.
+     */
+    size_t checkpointIntervalBytes;
+
+    /**
+     * Where to write runtime statistics (per-reader and writer counters) as lines of JSON: each time the process
+     * receives SIGUSR1 during the run, and once at the end. Null to not collect statistics. Only HW5_ENGINE_STREAM
+     * collects statistics, and not for the runs it hands to HW5_ENGINE_EPOLL.
+     */
+    FILE *statsFile;
+};
+
+struct Hw5Options hw5DefaultOptions(void);
 
 void hw5(
     char const * const *inFilePaths,
     size_t inFileCount,
     char const *outFilePath
 );
+void hw5WithOptions(
+    char const * const *inFilePaths,
+    size_t inFileCount,
+    char const *outFilePath,
+    struct Hw5Options const *options
+);
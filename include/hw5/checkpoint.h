@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../util/record.h"
+#include "../util/schedule.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**
+ * Where one input stood at a checkpoint.
+ */
+struct Hw5CheckpointInput {
+    /**
+     * The length of the input file, so that a changed input is not resumed.
+     */
+    size_t fileLength;
+
+    /**
+     * The number of bytes of the input consumed.
+     */
+    size_t byteOffset;
+
+    /**
+     * The number of records taken from the input.
+     */
+    size_t recordCount;
+};
+
+/**
+ * A consistent point of a run to resume from. Checkpoints are taken between rounds, once the output has been synced up
+ * to outputOffset.
+ */
+struct Hw5Checkpoint {
+    struct RecordFormat recordFormat;
+    struct InterleaveSchedule const *schedule;
+
+    /**
+     * The number of complete rounds written; the next round starts with the first slot of the schedule.
+     */
+    size_t roundCount;
+
+    /**
+     * The number of bytes of output written.
+     */
+    size_t outputOffset;
+
+    struct Hw5CheckpointInput *inputs;
+    size_t inputCount;
+};
+
+struct Hw5Checkpoint *hw5CheckpointCreate(
+    size_t inputCount,
+    struct RecordFormat const *recordFormatPtr,
+    struct InterleaveSchedule const *schedulePtr,
+    char const *callerDescription
+);
+bool hw5CheckpointTryLoad(struct Hw5Checkpoint *checkpoint, char const *filePath, char const *callerDescription);
+void hw5CheckpointSave(struct Hw5Checkpoint const *checkpoint, char const *filePath, char const *callerDescription);
+void hw5CheckpointDestroy(struct Hw5Checkpoint *checkpoint);
+
+void hw5CheckpointRemove(char const *filePath, char const *callerDescription);
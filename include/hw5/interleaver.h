@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../util/record.h"
+#include "../util/schedule.h"
+
+#include <stdlib.h>
+
+/**
+ * The output of hw5 over a set of inputs, pulled in batches instead of written to a file. Created with a null record
+ * format, it reads characterRecordFormat() records; with a null schedule, it takes one record from each input in turn.
+ */
+struct Hw5Interleaver;
+
+struct Hw5Interleaver *hw5InterleaverCreate(
+    char const * const *inFilePaths,
+    size_t inFileCount,
+    struct RecordFormat const *recordFormatPtr,
+    struct InterleaveSchedule const *schedulePtr
+);
+size_t hw5InterleaverRead(struct Hw5Interleaver *interleaver, char *buffer, size_t bufferLength);
+void hw5InterleaverDestroy(struct Hw5Interleaver *interleaver);
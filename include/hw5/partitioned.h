@@ -0,0 +1,14 @@
+#pragma once
+
+#include "../util/thread.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+bool hw5Partitioned(
+    char const * const *inFilePaths,
+    size_t inFileCount,
+    char const *outFilePath,
+    size_t workerCount,
+    struct ThreadSettings const *threadSettingsPtr
+);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../util/stats.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * The runtime statistics of one HW5 run: one set of counters per input's reader, plus the writer's.
+ */
+struct Hw5Stats {
+    struct ThreadStats writer;
+    struct ThreadStats *readers;
+    size_t readerCount;
+};
+
+struct Hw5Stats *hw5StatsCreate(size_t readerCount, char const *callerDescription);
+void hw5StatsWriteJson(struct Hw5Stats const *stats, bool final, FILE *file, char const *callerDescription);
+void hw5StatsDestroy(struct Hw5Stats *stats);
+
+struct Hw5StatsReporter;
+
+struct Hw5StatsReporter *hw5StatsReporterStart(
+    struct Hw5Stats const *stats,
+    FILE *file,
+    char const *callerDescription
+);
+void hw5StatsReporterStop(struct Hw5StatsReporter *reporter, char const *callerDescription);
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "../util/record.h"
+#include "../util/file.h"
+#include "../util/schedule.h"
+
+#include <stdlib.h>
+
+void hw5Uring(
+    char const * const *inFilePaths,
+    size_t inFileCount,
+    struct BufferedWriter *outWriter,
+    struct RecordFormat const *recordFormatPtr,
+    struct InterleaveSchedule const *schedulePtr
+);
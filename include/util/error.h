@@ -2,6 +2,6 @@
 
 #include <stdarg.h>
 
-void abortWithError(char const *errorMessage);
-void abortWithErrorFmt(char const *errorMessageFormat, ...);
-void abortWithErrorFmtVA(char const *errorMessageFormat, va_list errorMessageFormatArgs);
+_Noreturn void abortWithError(char const *errorMessage);
+_Noreturn void abortWithErrorFmt(char const *errorMessageFormat, ...);
+_Noreturn void abortWithErrorFmtVA(char const *errorMessageFormat, va_list errorMessageFormatArgs);
@@ -1,11 +1,46 @@
 #pragma once
 
+#include "./stats.h"
+
+#include <stdlib.h>
 #include <stdbool.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <sys/types.h>
+
+/**
+ * A read-only memory mapping of an entire file.
+ */
+struct MappedFile {
+    char const *data;
+    size_t length;
+};
 
 FILE *safeFopen(char const *filePath, char const *modes, char const *callerDescription);
 
+int safeOpen(char const *filePath, int flags, mode_t mode, char const *callerDescription);
+void safeClose(int fileDescriptor, char const *callerDescription);
+void safeSetNonBlocking(int fileDescriptor, bool nonBlocking, char const *callerDescription);
+void safeFtruncate(int fileDescriptor, size_t length, char const *callerDescription);
+void safeFdatasync(int fileDescriptor, char const *callerDescription);
+void safeRename(char const *oldFilePath, char const *newFilePath, char const *callerDescription);
+size_t safeRead(int fileDescriptor, char *buffer, size_t length, char const *callerDescription);
+bool safeTryRead(
+    int fileDescriptor,
+    char *buffer,
+    size_t length,
+    size_t *readLengthOutPtr,
+    char const *callerDescription
+);
+size_t safePread(int fileDescriptor, char *buffer, size_t length, size_t offset, char const *callerDescription);
+void safePwrite(
+    int fileDescriptor,
+    char const *data,
+    size_t length,
+    size_t offset,
+    char const *callerDescription
+);
+
 unsigned int safeFprintf(
     FILE *file,
     char const *callerDescription,
@@ -19,6 +54,9 @@ unsigned int safeVfprintf(
     char const *callerDescription
 );
 
+void safeFwrite(void const *buffer, size_t elementSize, size_t elementCount, FILE *file, char const *callerDescription);
+size_t safeFread(void *buffer, size_t elementSize, size_t elementCount, FILE *file, char const *callerDescription);
+
 bool safeFgets(char *buffer, size_t bufferLength, FILE *file, char const *callerDescription);
 
 int safeFscanf(
@@ -46,3 +84,71 @@ bool scanFileExactVA(
     char const *format,
     va_list formatArgs
 );
+
+bool tryMapFile(char const *filePath, struct MappedFile *mappedFileOutPtr, char const *callerDescription);
+void unmapFile(struct MappedFile *mappedFilePtr, char const *callerDescription);
+
+bool isScanfWhitespace(char character);
+size_t countCharacterRecords(char const *data, size_t dataLength, bool atInputStart);
+size_t findCharacterRecordStarts(
+    char const *data,
+    size_t dataLength,
+    bool *skippingWhitespacePtr,
+    size_t *offsetsOut,
+    size_t offsetsCapacity,
+    size_t *scannedLengthOutPtr
+);
+size_t scanCharacterRecords(
+    char const *data,
+    size_t dataLength,
+    bool *skippingWhitespacePtr,
+    char *recordsOut,
+    size_t recordsCapacity,
+    size_t *scannedLengthOutPtr
+);
+
+struct CharacterRecordReader;
+
+struct CharacterRecordReader *characterRecordReaderCreate(
+    FILE *file,
+    size_t blockSize,
+    char const *callerDescription
+);
+size_t characterRecordReaderRead(
+    struct CharacterRecordReader *reader,
+    char *recordsOut,
+    size_t recordsCapacity,
+    char const *callerDescription
+);
+void characterRecordReaderSetStats(struct CharacterRecordReader *reader, struct ThreadStats *stats);
+void characterRecordReaderDestroy(struct CharacterRecordReader *reader);
+
+struct BufferedWriter;
+
+struct BufferedWriter *bufferedWriterOpen(char const *filePath, size_t bufferSize, char const *callerDescription);
+struct BufferedWriter *bufferedWriterOpenGzip(
+    char const *filePath,
+    size_t bufferSize,
+    size_t threadCount,
+    int level,
+    char const *callerDescription
+);
+struct BufferedWriter *bufferedWriterOpenAt(
+    char const *filePath,
+    size_t offset,
+    size_t bufferSize,
+    char const *callerDescription
+);
+void bufferedWriterSetStats(struct BufferedWriter *writer, struct ThreadStats *stats);
+void bufferedWriterWrite(
+    struct BufferedWriter *writer,
+    char const *data,
+    size_t length,
+    char const *callerDescription
+);
+char *bufferedWriterReserve(struct BufferedWriter *writer, size_t length, char const *callerDescription);
+void bufferedWriterCommit(struct BufferedWriter *writer, size_t length);
+void bufferedWriterFlush(struct BufferedWriter *writer, char const *callerDescription);
+size_t bufferedWriterGetOffset(struct BufferedWriter const *writer);
+void bufferedWriterSync(struct BufferedWriter *writer, char const *callerDescription);
+void bufferedWriterClose(struct BufferedWriter *writer, char const *callerDescription);
@@ -3,8 +3,60 @@
 #include <stdbool.h>
 #include <stdarg.h>
 
-void guard(bool expression, char const *errorMessage);
-void guardFmt(bool expression, char const *errorMessageFormat, ...);
+/**
+ * Whether the guards of hot paths (hotGuard, hotGuardFmt and hotGuardNotNull) are checked. Defaults to 1, or to 0 in
+ * release builds (NDEBUG); define it as 0 or 1 to override. The other guards are always checked.
+ */
+#ifndef GUARD_HOT_PATHS
+#ifdef NDEBUG
+#define GUARD_HOT_PATHS 0
+#else
+#define GUARD_HOT_PATHS 1
+#endif
+#endif
+
+/**
+ * Evaluate to the truth of the given expression, hinting to the compiler that it is true.
+ */
+#define GUARD_LIKELY(expression) __builtin_expect(!!(expression), 1)
+
+/**
+ * Ensure that the given expression involving a parameter is true. If it is false, abort the program with the given
+ * error message. The check is a single branch predicted to pass; the abort path is out of line.
+ */
+#define guard(expression, errorMessage) (GUARD_LIKELY(expression) ? (void)0 : guardFailed(errorMessage))
+
+/**
+ * Ensure that the given expression involving a parameter is true. If it is false, abort the program with an error
+ * message formatted from the remaining arguments (printf). The arguments are only evaluated if the check fails.
+ */
+#define guardFmt(expression, ...) (GUARD_LIKELY(expression) ? (void)0 : guardFmtFailed(__VA_ARGS__))
+
+/**
+ * Ensure that the given object supplied by a parameter is not null. If it is null, abort the program with an error
+ * message naming the parameter and the calling function.
+ */
+#define guardNotNull(object, paramName, callerName) (\
+    GUARD_LIKELY((object) != NULL) ? (void)0 : guardNotNullFailed(paramName, callerName)\
+)
+
+/**
+ * Variants of guard, guardFmt and guardNotNull for functions called per record or per buffer, which GUARD_HOT_PATHS
+ * compiles out. The expression is still type-checked but never evaluated when compiled out, so it must not have side
+ * effects.
+ */
+#if GUARD_HOT_PATHS
+#define hotGuard(expression, errorMessage) guard(expression, errorMessage)
+#define hotGuardFmt(expression, ...) guardFmt(expression, __VA_ARGS__)
+#define hotGuardNotNull(object, paramName, callerName) guardNotNull(object, paramName, callerName)
+#else
+#define hotGuard(expression, errorMessage) ((void)sizeof (expression))
+#define hotGuardFmt(expression, ...) ((void)sizeof (expression))
+#define hotGuardNotNull(object, paramName, callerName) ((void)sizeof ((object) != NULL))
+#endif
+
 void guardFmtVA(bool expression, char const *errorMessageFormat, va_list errorMessageFormatArgs);
 
-void guardNotNull(void const *object, char const *paramName, char const *callerName);
+_Noreturn void guardFailed(char const *errorMessage) __attribute__((cold));
+_Noreturn void guardFmtFailed(char const *errorMessageFormat, ...) __attribute__((cold));
+_Noreturn void guardNotNullFailed(char const *paramName, char const *callerName) __attribute__((cold));
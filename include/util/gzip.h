@@ -0,0 +1,46 @@
+#pragma once
+
+#include "./callback.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+DECLARE_ACTION(GzipOutputSink, void *, char const *, size_t)
+
+bool hasGzipMagic(char const *data, size_t dataLength);
+bool isGzipFile(char const *filePath, char const *callerDescription);
+FILE *safeFopenDecoded(char const *filePath, char const *callerDescription);
+
+struct GzipDecoder;
+
+struct GzipDecoder *gzipDecoderCreate(char const *filePath, char const *callerDescription);
+size_t gzipDecoderDecode(
+    struct GzipDecoder *decoder,
+    char const *input,
+    size_t inputLength,
+    size_t *consumedLengthOutPtr,
+    char *output,
+    size_t outputCapacity,
+    char const *callerDescription
+);
+void gzipDecoderFinish(struct GzipDecoder *decoder, char const *callerDescription);
+void gzipDecoderDestroy(struct GzipDecoder *decoder);
+
+struct ParallelGzipWriter;
+
+struct ParallelGzipWriter *parallelGzipWriterCreate(
+    size_t blockSize,
+    size_t threadCount,
+    int level,
+    GzipOutputSink sink,
+    void *sinkArg,
+    char const *callerDescription
+);
+void parallelGzipWriterWrite(
+    struct ParallelGzipWriter *writer,
+    char const *data,
+    size_t length,
+    char const *callerDescription
+);
+void parallelGzipWriterFinish(struct ParallelGzipWriter *writer, char const *callerDescription);
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+bool isTwoByteCharacterRecordLayout(char const *data, size_t length);
+
+void interleaveTwoByteRecords(
+    char const * const *inputs,
+    size_t inputCount,
+    size_t recordOffset,
+    size_t recordCount,
+    char *output
+);
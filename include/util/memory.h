@@ -1,6 +1,41 @@
 #pragma once
 
 #include <stdlib.h>
+#include <stdbool.h>
+
+/**
+ * The assumed size of a CPU cache line, in bytes. Data written by different threads should be placed at least this far
+ * apart to avoid false sharing.
+ */
+#define CACHE_LINE_SIZE 64
 
 void *safeMalloc(size_t size, char const *callerDescription);
+void *safeAlignedMalloc(size_t alignment, size_t size, char const *callerDescription);
 void *safeRealloc(void *memory, size_t newSize, char const *callerDescription);
+
+/**
+ * A bump allocator. Memory is carved in order out of chunks obtained from malloc, and is only ever released all at
+ * once, by resetting the arena (to its start or to a mark). The chunks are kept across resets, so an arena that is
+ * reset between uses of the same sizes stops calling malloc after the first use.
+ */
+struct Arena;
+
+/**
+ * A position in an arena to reset it to, releasing everything allocated since (see arenaGetMark).
+ */
+struct ArenaMark {
+    struct ArenaChunk *chunk;
+    size_t usedLength;
+};
+
+struct Arena *arenaCreate(size_t chunkSize, char const *callerDescription);
+void *arenaAlloc(struct Arena *arena, size_t size, char const *callerDescription);
+void *arenaAlignedAlloc(struct Arena *arena, size_t alignment, size_t size, char const *callerDescription);
+struct ArenaMark arenaGetMark(struct Arena const *arena);
+void arenaResetToMark(struct Arena *arena, struct ArenaMark mark);
+void arenaReset(struct Arena *arena);
+void arenaDestroy(struct Arena *arena);
+
+struct Arena *getThreadScratchArena(char const *callerDescription);
+bool hasThreadScratchArena(void);
+void releaseThreadScratchArena(char const *callerDescription);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct Poller;
+
+struct Poller *pollerCreate(size_t maxEventCount, char const *callerDescription);
+bool pollerTryAdd(struct Poller *poller, int fileDescriptor, uint64_t userData, char const *callerDescription);
+void pollerRemove(struct Poller *poller, int fileDescriptor, char const *callerDescription);
+size_t pollerWait(
+    struct Poller *poller,
+    uint64_t *userDatasOut,
+    size_t userDatasCapacity,
+    char const *callerDescription
+);
+void pollerDestroy(struct Poller *poller, char const *callerDescription);
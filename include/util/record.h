@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+/**
+ * How an input is split into records.
+ */
+enum RecordKind {
+    /**
+     * Each record is a single byte, read with the fscanf format `"%c\n"`: any run of whitespace after a record is
+     * skipped. Each record is written as the byte followed by a newline.
+     */
+    RECORD_KIND_CHARACTER,
+
+    /**
+     * Each record runs up to and including the next delimiter byte, and is written as is. A final record that the input
+     * ends before its delimiter is written with the delimiter appended.
+     */
+    RECORD_KIND_DELIMITED,
+
+    /**
+     * Each record is a fixed number of bytes, and is written as is. A final record that the input ends before it is
+     * complete is written as is, short.
+     */
+    RECORD_KIND_FIXED
+};
+
+/**
+ * A description of how records are read from an input and written to the output. Records are described by where they
+ * lie within the input, so no record is ever copied into storage of its own.
+ */
+struct RecordFormat {
+    enum RecordKind kind;
+
+    /**
+     * The delimiter of RECORD_KIND_DELIMITED records.
+     */
+    char delimiter;
+
+    /**
+     * The number of bytes in a RECORD_KIND_FIXED record.
+     */
+    size_t length;
+};
+
+/**
+ * The state of scanning records from an input a piece at a time, which lets a record span any number of consecutive
+ * buffers.
+ */
+struct RecordScan {
+    /**
+     * Whether whitespace is currently being skipped (RECORD_KIND_CHARACTER only).
+     */
+    bool skippingWhitespace;
+
+    /**
+     * The number of bytes of the current record scanned so far, or 0 between records.
+     */
+    size_t recordLength;
+};
+
+struct RecordFormat characterRecordFormat(void);
+struct RecordFormat lineRecordFormat(void);
+struct RecordFormat delimitedRecordFormat(char delimiter);
+struct RecordFormat fixedRecordFormat(size_t length);
+
+void recordScanInit(struct RecordScan *scanOutPtr);
+size_t scanRecordPiece(
+    struct RecordFormat const *formatPtr,
+    struct RecordScan *scanPtr,
+    char const *data,
+    size_t dataLength,
+    size_t *pieceOffsetOutPtr,
+    size_t *pieceLengthOutPtr,
+    bool *completeOutPtr
+);
+size_t countCompleteRecords(
+    struct RecordFormat const *formatPtr,
+    struct RecordScan *scanPtr,
+    char const *data,
+    size_t dataLength
+);
+bool getRecordTerminator(struct RecordFormat const *formatPtr, bool complete, char *terminatorOutPtr);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The order in which records are taken from the inputs of an interleaving, precomputed into a table: each round takes
+ * one record from the input of each slot in turn, skipping inputs that have been exhausted, and the interleaving ends
+ * after a round in which no input had a record. Every input has at least one slot.
+ */
+struct InterleaveSchedule {
+    /**
+     * The input index of each slot of a round.
+     */
+    uint32_t *slots;
+
+    size_t slotCount;
+    size_t inputCount;
+
+    /**
+     * Whether the slots are each input once, in order.
+     */
+    bool roundRobin;
+};
+
+struct InterleaveSchedule *interleaveScheduleCreate(size_t inputCount, char const *callerDescription);
+struct InterleaveSchedule *interleaveScheduleCreateWeighted(
+    size_t const *weights,
+    size_t inputCount,
+    char const *callerDescription
+);
+struct InterleaveSchedule *interleaveScheduleCreatePattern(
+    size_t const *pattern,
+    size_t patternLength,
+    size_t inputCount,
+    char const *callerDescription
+);
+void interleaveScheduleDestroy(struct InterleaveSchedule *schedule);
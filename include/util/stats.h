@@ -0,0 +1,24 @@
+#pragma once
+
+#include "./memory.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/**
+ * Counters describing the work done by one reader or writer. Each counter is updated by a single thread at a time (see
+ * threadStatsAdd) and may be read concurrently by another thread, e.g. to report progress.
+ */
+struct ThreadStats {
+    _Alignas(CACHE_LINE_SIZE) atomic_uint_least64_t recordCount;
+    atomic_uint_least64_t byteCount;
+    atomic_uint_least64_t waitCount;
+    atomic_uint_least64_t blockedNanoseconds;
+    atomic_uint_least64_t ioNanoseconds;
+};
+
+void threadStatsInit(struct ThreadStats *stats);
+void threadStatsAdd(atomic_uint_least64_t *counterPtr, uint64_t amount);
+
+uint64_t getMonotonicNanoseconds(void);
@@ -1,7 +1,37 @@
 #pragma once
 
+#include "./memory.h"
+
 #include <stdlib.h>
 #include <stdarg.h>
+#include <stdint.h>
+
+/**
+ * The number of characters, including the terminating null character, that a StringBuilder holds before it moves its
+ * contents to the heap.
+ */
+#define STRING_BUILDER_INLINE_CAPACITY 256
+
+/**
+ * A growable null-terminated string. Strings that fit in the inline buffer need no allocation; longer ones move to the
+ * heap, whose capacity at least doubles each time it grows. Since data may point into the builder itself, a builder
+ * must not be copied.
+ */
+struct StringBuilder {
+    /**
+     * The contents, which are always null-terminated.
+     */
+    char *data;
+
+    size_t length;
+
+    /**
+     * The number of characters data can hold, not counting the terminating null character.
+     */
+    size_t capacity;
+
+    char inlineBuffer[STRING_BUILDER_INLINE_CAPACITY];
+};
 
 size_t safeSnprintf(
     char *buffer,
@@ -32,3 +62,28 @@ size_t safeVsprintf(
 
 char *formatString(char const *format, ...);
 char *formatStringVA(char const *format, va_list formatArgs);
+char *formatStringInArena(struct Arena *arena, char const *format, ...);
+char *formatStringInArenaVA(struct Arena *arena, char const *format, va_list formatArgs);
+
+void stringBuilderInit(struct StringBuilder *builderOutPtr);
+void stringBuilderReserve(struct StringBuilder *builder, size_t additionalLength, char const *callerDescription);
+void stringBuilderAppendChar(struct StringBuilder *builder, char character, char const *callerDescription);
+void stringBuilderAppendBytes(
+    struct StringBuilder *builder,
+    char const *data,
+    size_t dataLength,
+    char const *callerDescription
+);
+void stringBuilderAppendString(struct StringBuilder *builder, char const *string, char const *callerDescription);
+void stringBuilderAppendUnsigned(struct StringBuilder *builder, uint64_t value, char const *callerDescription);
+void stringBuilderAppendSigned(struct StringBuilder *builder, int64_t value, char const *callerDescription);
+void stringBuilderAppendFmt(struct StringBuilder *builder, char const *callerDescription, char const *format, ...);
+void stringBuilderAppendFmtVA(
+    struct StringBuilder *builder,
+    char const *callerDescription,
+    char const *format,
+    va_list formatArgs
+);
+void stringBuilderClear(struct StringBuilder *builder);
+char *stringBuilderDetachString(struct StringBuilder *builder, char const *callerDescription);
+void stringBuilderDestroy(struct StringBuilder *builder);
@@ -1,18 +1,86 @@
 #pragma once
 
 #include "./callback.h"
+#include "./stats.h"
 
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
 #include <pthread.h>
 
 DECLARE_FUNC(PthreadCreateStartRoutine, void *, void *)
+DECLARE_ACTION(WorkerPoolTask, void *)
+DECLARE_FUNC(SpinWaitCondition, bool, void *)
+
+/**
+ * How long a thread that has to wait for another keeps checking before it parks (see spinWait). Zero rounds of both
+ * kinds parks right away.
+ */
+struct SpinWaitPolicy {
+    /**
+     * Rounds of busy-waiting with pause instructions, each twice as long as the last (up to a cap).
+     */
+    unsigned int spinRounds;
+
+    /**
+     * Times to yield the processor once done spinning.
+     */
+    unsigned int yieldRounds;
+};
+
+/**
+ * Where and how a thread runs. Zero-initialized settings are the defaults.
+ */
+struct ThreadSettings {
+    /**
+     * The size in bytes of the thread's stack, or 0 for the default.
+     */
+    size_t stackSize;
+
+    /**
+     * The processors the thread may run on, or null to let it run on any.
+     */
+    size_t const *cpus;
+    size_t cpuCount;
+};
+
+/**
+ * A binary semaphore backed by a Linux futex. Setting an event that no thread is asleep on, or waiting on an event that
+ * is already set, stays in userspace.
+ */
+struct Event {
+    atomic_int state;
+};
+
+/**
+ * How a thread blocked on an SpscRing (because the ring is full or empty) waits to be woken.
+ */
+enum SpscRingWait {
+    /**
+     * Park on a mutex-protected condition variable.
+     */
+    SPSC_RING_WAIT_CONDITION,
+
+    /**
+     * Park on an Event, with no mutex; a wake takes a system call only when the other side is actually asleep.
+     */
+    SPSC_RING_WAIT_EVENT
+};
+
+struct ThreadAffinity;
+
+size_t getOnlineProcessorCount(void);
 
 pthread_t safePthreadCreate(
-    pthread_attr_t const *attributes,
+    struct ThreadSettings const *settingsPtr,
     PthreadCreateStartRoutine startRoutine,
     void *startRoutineArg,
     char const *callerDescription
 );
 void *safePthreadJoin(pthread_t threadId, char const *callerDescription);
+struct ThreadSettings spreadThreadSettings(struct ThreadSettings const *settingsPtr, size_t threadIndex);
+struct ThreadAffinity *pinCurrentThread(size_t const *cpus, size_t cpuCount, char const *callerDescription);
+void restoreCurrentThreadAffinity(struct ThreadAffinity *previousAffinity, char const *callerDescription);
 
 void safeMutexInit(
     pthread_mutex_t *mutexOutPtr,
@@ -29,9 +97,41 @@ void safeConditionInit(
     char const *callerDescription
 );
 void safeConditionSignal(pthread_cond_t *conditionPtr, char const *callerDescription);
+void safeConditionBroadcast(pthread_cond_t *conditionPtr, char const *callerDescription);
 void safeConditionWait(
     pthread_cond_t *conditionPtr,
     pthread_mutex_t *mutexPtr,
     char const *callerDescription
 );
 void safeConditionDestroy(pthread_cond_t *conditionPtr, char const *callerDescription);
+
+void cpuRelax(void);
+bool spinWait(struct SpinWaitPolicy policy, SpinWaitCondition isDone, void *isDoneArg);
+
+void eventInit(struct Event *eventOutPtr);
+void eventSet(struct Event *eventPtr, char const *callerDescription);
+bool eventTryWait(struct Event *eventPtr);
+void eventWait(struct Event *eventPtr, char const *callerDescription);
+
+struct SpscRing;
+
+struct SpscRing *spscRingCreate(size_t minCapacity, enum SpscRingWait wait, char const *callerDescription);
+void spscRingSetSpinWaitPolicy(struct SpscRing *ring, struct SpinWaitPolicy policy);
+void spscRingSetStats(struct SpscRing *ring, struct ThreadStats *producerStats, struct ThreadStats *consumerStats);
+size_t spscRingTryWrite(struct SpscRing *ring, char const *data, size_t length);
+size_t spscRingTryRead(struct SpscRing *ring, char *buffer, size_t bufferLength);
+void spscRingWrite(struct SpscRing *ring, char const *data, size_t length, char const *callerDescription);
+size_t spscRingRead(struct SpscRing *ring, char *buffer, size_t bufferLength, char const *callerDescription);
+bool spscRingIsEmpty(struct SpscRing *ring);
+void spscRingClose(struct SpscRing *ring, char const *callerDescription);
+void spscRingDestroy(struct SpscRing *ring, char const *callerDescription);
+
+struct WorkerPool;
+
+struct WorkerPool *workerPoolCreate(
+    size_t workerCount,
+    struct ThreadSettings const *settingsPtr,
+    char const *callerDescription
+);
+void workerPoolSubmit(struct WorkerPool *pool, WorkerPoolTask task, void *taskArg, char const *callerDescription);
+void workerPoolDestroy(struct WorkerPool *pool, char const *callerDescription);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+struct Uring;
+
+struct Uring *tryUringCreate(unsigned int entryCount, char const *callerDescription);
+bool uringTryPrepareRead(
+    struct Uring *ring,
+    int fileDescriptor,
+    void *buffer,
+    unsigned int length,
+    int64_t offset,
+    uint64_t userData
+);
+void uringSubmitAndWait(struct Uring *ring, unsigned int waitCount, char const *callerDescription);
+bool uringTryTakeCompletion(struct Uring *ring, uint64_t *userDataOutPtr, int32_t *resultOutPtr);
+void uringDestroy(struct Uring *ring, char const *callerDescription);
@@ -1,32 +1,184 @@
 #include "../include/hw5.h"
 
+#include "../include/hw5/partitioned.h"
+#include "../include/hw5/uring.h"
+#include "../include/hw5/epoll.h"
+#include "../include/hw5/stats.h"
+#include "../include/hw5/checkpoint.h"
 #include "../include/util/memory.h"
 #include "../include/util/thread.h"
 #include "../include/util/file.h"
+#include "../include/util/gzip.h"
+#include "../include/util/record.h"
+#include "../include/util/interleave.h"
+#include "../include/util/schedule.h"
 #include "../include/util/guard.h"
+#include "../include/util/error.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
-#include <pthread.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <assert.h>
 
-struct ReadFileCharactersThreadStartArg {
-    char const *inFilePath;
+/**
+ * The state of refilling one non-mapped input's ring, shared between the main thread and the pool task that refills
+ * it. The main thread requests a refill only when the ring has been drained and no refill is pending, so at most one
+ * refill task per input exists at a time and a refill can fill the whole ring without blocking. A refill that finds
+ * the ring drained again as it finishes resumes instead, since the main thread may have seen it still pending and
+ * parked. The input is opened by its first refill and closed by the refill that exhausts it.
+ */
+struct RingRefill {
+    // Aligned so that neighbouring inputs' refill tasks do not contend for the line holding the pending flag
+    _Alignas(CACHE_LINE_SIZE) char const *inFilePath;
+    struct RecordFormat const *recordFormatPtr;
+    struct SpscRing *characterRing;
+
+    // Touched only by refill tasks, which are ordered by the pending flag
+    struct ThreadStats *stats;
+    FILE *inFile;
+    struct CharacterRecordReader *reader;
+    struct RecordScan statsScan;
+
+    // Written by a refill task before it clears the pending flag
+    bool exhausted;
+    atomic_bool pending;
+};
+
+/**
+ * The main thread's view of one input file. A regular file is mapped into memory and its records are parsed in place.
+ * Any other file is read into a ring by refill tasks on the worker pool, and the main thread drains a batch of
+ * characters at a time so that the ring's indices are only touched once per batch. For `"%c\n"` records the ring
+ * carries the parsed characters; for any other record format it carries the input's bytes, and the main thread scans
+ * records out of each batch, writing any record that spans batches a piece at a time.
+ */
+struct CharacterQueue {
+    bool mapped;
     bool finished;
-    char *characterOutPtr;
 
-    pthread_mutex_t syncMutex;
-    pthread_cond_t readCondition;
-    pthread_cond_t wroteCondition;
+    struct MappedFile mappedFile;
+    size_t mappedPosition;
+    bool skippingWhitespace;
+
+    // The number of records taken so far, for checkpoints
+    size_t recordCount;
+
+    struct RecordScan recordScan;
+
+    struct RingRefill *refill;
+
+    char *batch;
+    size_t batchLength;
+    size_t batchPosition;
 };
 
-static void *readFileCharactersThreadStart(void * const argAsVoidPtr);
+/**
+ * The state of taking periodic checkpoints of a run, every time at least a given number of bytes of output has been
+ * written since the last one.
+ */
+struct StreamCheckpointer {
+    char const *filePath;
+    struct Hw5Checkpoint *checkpoint;
+    size_t intervalBytes;
+    size_t nextOutputOffset;
+};
+
+static size_t const characterRingCapacity = 16384;
+static size_t const characterBatchCapacity = 4096;
+static size_t const inFileBlockSize = 65536;
+static size_t const interleavedChunkSize = 65536;
+static size_t const outFileBufferSize = 1048576;
+
+static void runEngine(
+    char const * const *inFilePaths,
+    size_t inFileCount,
+    char const *outFilePath,
+    struct InterleaveSchedule const *schedulePtr,
+    struct Hw5Options const *options
+);
+static void hw5Stream(
+    char const * const *inFilePaths,
+    size_t inFileCount,
+    char const *outFilePath,
+    struct InterleaveSchedule const *schedulePtr,
+    struct Hw5Options const *options
+);
+
+static struct ThreadSettings getWorkerThreadSettings(struct Hw5Options const *options);
+static struct BufferedWriter *openOutWriter(char const *outFilePath, struct Hw5Options const *options);
+static void addMappedInputStats(
+    struct CharacterQueue const *queuePtr,
+    struct RecordFormat const *recordFormatPtr,
+    struct ThreadStats *readerStats
+);
+static bool hasGzipInputFile(char const * const *inFilePaths, size_t inFileCount);
+static bool hasNonRegularInputFile(char const * const *inFilePaths, size_t inFileCount);
+static enum SpscRingWait getRingWait(enum Hw5Handoff handoff);
+static bool resumeFromCheckpoint(
+    struct StreamCheckpointer *checkpointerPtr,
+    struct CharacterQueue *queues,
+    size_t queueCount
+);
+static void saveCheckpoint(
+    struct StreamCheckpointer *checkpointerPtr,
+    struct CharacterQueue const *queues,
+    size_t queueCount,
+    size_t roundCount,
+    struct BufferedWriter *outWriter
+);
+static size_t interleaveTwoByteRecordRounds(
+    struct CharacterQueue *queues,
+    size_t queueCount,
+    size_t startRound,
+    struct StreamCheckpointer *checkpointerPtr,
+    struct BufferedWriter *outWriter
+);
+static void positionInterleavedQueues(struct CharacterQueue *queues, size_t queueCount, size_t roundCount);
+static bool dequeueCharacter(struct CharacterQueue *queuePtr, struct WorkerPool *pool, char *characterOutPtr);
+static bool transferRecord(
+    struct CharacterQueue *queuePtr,
+    struct WorkerPool *pool,
+    struct RecordFormat const *recordFormatPtr,
+    struct BufferedWriter *outWriter
+);
+static size_t takeRingBatch(struct CharacterQueue *queuePtr, struct WorkerPool *pool);
+static void requestRingRefill(struct RingRefill *refillPtr, struct WorkerPool *pool);
+
+static void refillCharacterRingTask(void *argAsVoidPtr);
+static bool refillRing(struct RingRefill *refillPtr, char *batch);
+static size_t readInputBytes(struct RingRefill *refillPtr, char *batch, size_t capacity);
+
+/**
+ * Get the options used by hw5.
+ *
+ * @returns The default options.
+ */
+struct Hw5Options hw5DefaultOptions(void) {
+    return (struct Hw5Options){
+        .engine = HW5_ENGINE_STREAM,
+        .recordFormat = characterRecordFormat(),
+        .schedule = NULL,
+        .handoff = HW5_HANDOFF_CONDITION,
+        .handoffSpinRounds = 0,
+        .handoffYieldRounds = 0,
+        .workerCount = 0,
+        .cpus = NULL,
+        .cpuCount = 0,
+        .workerStackSize = 0,
+        .gzipOutput = false,
+        .gzipOutputLevel = -1,
+        .checkpointPath = NULL,
+        .checkpointIntervalBytes = 67108864,
+        .statsFile = NULL
+    };
+}
 
 /**
  * Run CSCI 451 HW5. This reads characters one at a time from each input file, printing the character to the output file
- * and cycling to the next file after each character is read. A separate thread is dedicated for reading each file,
- * while the writing occurs on the calling thread.
+ * and cycling to the next file after each character is read. Input files that run out of characters are skipped.
  *
  * @param inFilePaths The input file paths.
  * @param inFileCount The number of input files.
@@ -37,109 +189,929 @@ void hw5(
     size_t const inFileCount,
     char const * const outFilePath
 ) {
-    guardNotNull(inFilePaths, "inFilePaths", "hw5");
-    guardNotNull(outFilePath, "outFilePath", "hw5");
+    struct Hw5Options const options = hw5DefaultOptions();
+    hw5WithOptions(inFilePaths, inFileCount, outFilePath, &options);
+}
+
+/**
+ * Run CSCI 451 HW5 (see hw5) using the given options.
+ *
+ * @param inFilePaths The input file paths.
+ * @param inFileCount The number of input files.
+ * @param outFilePath The output file path.
+ * @param options The options.
+ */
+void hw5WithOptions(
+    char const * const * const inFilePaths,
+    size_t const inFileCount,
+    char const * const outFilePath,
+    struct Hw5Options const * const options
+) {
+    guardNotNull(inFilePaths, "inFilePaths", "hw5WithOptions");
+    guardNotNull(outFilePath, "outFilePath", "hw5WithOptions");
+    guardNotNull(options, "options", "hw5WithOptions");
+
+    struct InterleaveSchedule * const roundRobinSchedule = (
+        options->schedule == NULL ? interleaveScheduleCreate(inFileCount, "hw5WithOptions") : NULL
+    );
+    struct InterleaveSchedule const * const schedulePtr = (
+        options->schedule != NULL ? options->schedule : roundRobinSchedule
+    );
+    guard(schedulePtr->inputCount == inFileCount, "hw5WithOptions: The schedule must be for inFileCount inputs");
+
+    // The calling thread may be the main thread, whose scratch arena would otherwise never be freed, but an arena the
+    // caller already had is left for the caller, who may still hold it
+    bool const hadScratchArena = hasThreadScratchArena();
+
+    struct ThreadAffinity * const previousAffinity = (
+        options->cpuCount > 0 ? pinCurrentThread(options->cpus, options->cpuCount, "hw5WithOptions") : NULL
+    );
+
+    runEngine(inFilePaths, inFileCount, outFilePath, schedulePtr, options);
+
+    if (previousAffinity != NULL) {
+        restoreCurrentThreadAffinity(previousAffinity, "hw5WithOptions");
+    }
+
+    if (roundRobinSchedule != NULL) {
+        interleaveScheduleDestroy(roundRobinSchedule);
+    }
+
+    if (!hadScratchArena) {
+        releaseThreadScratchArena("hw5WithOptions");
+    }
+}
+
+/**
+ * Run the engine the options ask for, or HW5_ENGINE_STREAM if that engine cannot handle the run. HW5_ENGINE_STREAM hands
+ * runs with inputs that are not regular files to HW5_ENGINE_EPOLL.
+ */
+static void runEngine(
+    char const * const * const inFilePaths,
+    size_t const inFileCount,
+    char const * const outFilePath,
+    struct InterleaveSchedule const * const schedulePtr,
+    struct Hw5Options const * const options
+) {
+    struct ThreadSettings const workerSettings = getWorkerThreadSettings(options);
+
+    // Only HW5_ENGINE_STREAM takes checkpoints, and only it and HW5_ENGINE_EPOLL decode compressed regular files
+    bool const streamOnly = (
+        options->checkpointPath != NULL
+        || (
+            options->engine != HW5_ENGINE_STREAM
+            && options->engine != HW5_ENGINE_EPOLL
+            && hasGzipInputFile(inFilePaths, inFileCount)
+        )
+    );
 
-    FILE * const outFile = safeFopen(outFilePath, "w", "hw5");
+    switch (options->engine) {
+        case HW5_ENGINE_PARTITIONED: {
+            if (
+                !streamOnly
+                && !options->gzipOutput
+                && options->recordFormat.kind == RECORD_KIND_CHARACTER
+                && schedulePtr->roundRobin
+                && hw5Partitioned(inFilePaths, inFileCount, outFilePath, options->workerCount, &workerSettings)
+            ) {
+                return;
+            }
+            break;
+        }
+        case HW5_ENGINE_URING: {
+            if (streamOnly) {
+                break;
+            }
+            struct BufferedWriter * const outWriter = openOutWriter(outFilePath, options);
+            hw5Uring(inFilePaths, inFileCount, outWriter, &options->recordFormat, schedulePtr);
+            bufferedWriterClose(outWriter, "runEngine");
+            return;
+        }
+        case HW5_ENGINE_EPOLL: {
+            if (streamOnly) {
+                break;
+            }
+            struct BufferedWriter * const outWriter = openOutWriter(outFilePath, options);
+            hw5Epoll(inFilePaths, inFileCount, outWriter, &options->recordFormat, schedulePtr);
+            bufferedWriterClose(outWriter, "runEngine");
+            return;
+        }
+        case HW5_ENGINE_STREAM: {
+            break;
+        }
+        default: {
+            abortWithErrorFmt("runEngine: Unknown engine %d", (int)options->engine);
+            return;
+        }
+    }
+
+    // A refill task blocks on its input until it has read a whole block, so inputs that fill up in lockstep (e.g. FIFOs
+    // fed by one producer) could each wait on another forever; polling reads whatever arrives on any of them. A
+    // checkpointed run is left to fail in hw5Stream, since only regular files can be resumed
+    if (options->checkpointPath == NULL && hasNonRegularInputFile(inFilePaths, inFileCount)) {
+        struct BufferedWriter * const outWriter = openOutWriter(outFilePath, options);
+        hw5Epoll(inFilePaths, inFileCount, outWriter, &options->recordFormat, schedulePtr);
+        bufferedWriterClose(outWriter, "runEngine");
+        return;
+    }
+
+    hw5Stream(inFilePaths, inFileCount, outFilePath, schedulePtr, options);
+}
+
+/**
+ * Run HW5 by interleaving on the calling thread. Regular input files are mapped into memory and read directly by the
+ * calling thread. Other input files (regular files that cannot be mapped, and gzip-compressed ones) are read by a
+ * bounded pool of worker threads, which refill each input's lock-free ring on demand, so readers run ahead of the
+ * writer instead of waiting for it after every character, without needing a thread per input. Gzip-compressed inputs
+ * are decoded by the worker threads, so decompression overlaps with writing the output and never touches the disk.
+ * Runs with inputs that are not regular files (e.g. FIFOs) go to HW5_ENGINE_EPOLL instead, unless they are
+ * checkpointed.
+ *
+ * @param inFilePaths The input file paths.
+ * @param inFileCount The number of input files.
+ * @param outFilePath The output file path.
+ * @param schedulePtr The order in which records are taken from the inputs.
+ * @param options The options. The number of reader worker threads is capped at the number of inputs that are not
+ *                mapped.
+ */
+static void hw5Stream(
+    char const * const * const inFilePaths,
+    size_t const inFileCount,
+    char const * const outFilePath,
+    struct InterleaveSchedule const * const schedulePtr,
+    struct Hw5Options const * const options
+) {
+    // Started before any other thread so that only the reporter receives SIGUSR1
+    struct Hw5Stats * const stats = options->statsFile != NULL ? hw5StatsCreate(inFileCount, "hw5Stream") : NULL;
+    struct Hw5StatsReporter * const statsReporter = (
+        stats != NULL ? hw5StatsReporterStart(stats, options->statsFile, "hw5Stream") : NULL
+    );
+    struct ThreadStats * const writerStats = stats != NULL ? &stats->writer : NULL;
 
-    char readCharacter;
+    struct RecordFormat const * const recordFormatPtr = &options->recordFormat;
+    bool const characterRecords = recordFormatPtr->kind == RECORD_KIND_CHARACTER;
 
-    struct ReadFileCharactersThreadStartArg * const threadStartArgs = (
-        safeMalloc(sizeof *threadStartArgs * inFileCount, "hw5")
+    enum SpscRingWait const ringWait = getRingWait(options->handoff);
+    struct SpinWaitPolicy const spinWaitPolicy = {
+        .spinRounds = options->handoffSpinRounds,
+        .yieldRounds = options->handoffYieldRounds
+    };
+    struct RingRefill * const refills = safeAlignedMalloc(
+        CACHE_LINE_SIZE,
+        sizeof *refills * (inFileCount > 0 ? inFileCount : 1),
+        "hw5Stream"
     );
-    pthread_t * const threadIds = safeMalloc(sizeof *threadIds * inFileCount, "hw5");
+    struct CharacterQueue * const queues = safeMalloc(sizeof *queues * inFileCount, "hw5Stream");
+    size_t unmappedCount = 0;
     for (size_t i = 0; i < inFileCount; i += 1) {
         char const * const inFilePath = inFilePaths[i];
-        struct ReadFileCharactersThreadStartArg * const threadStartArgPtr = &threadStartArgs[i];
+        struct RingRefill * const refillPtr = &refills[i];
+        struct CharacterQueue * const queuePtr = &queues[i];
 
-        threadStartArgPtr->inFilePath = inFilePath;
-        threadStartArgPtr->finished = false;
-        threadStartArgPtr->characterOutPtr = &readCharacter;
+        struct ThreadStats * const readerStats = stats != NULL ? &stats->readers[i] : NULL;
 
-        safeMutexInit(&threadStartArgPtr->syncMutex, NULL, "hw5");
-        safeConditionInit(&threadStartArgPtr->readCondition, NULL, "hw5");
-        safeConditionInit(&threadStartArgPtr->wroteCondition, NULL, "hw5");
+        queuePtr->finished = false;
+        recordScanInit(&queuePtr->recordScan);
+        queuePtr->mapped = tryMapFile(inFilePath, &queuePtr->mappedFile, "hw5Stream");
+        if (queuePtr->mapped && hasGzipMagic(queuePtr->mappedFile.data, queuePtr->mappedFile.length)) {
+            // Decoded by a refill task like any stream, so decoding overlaps with writing the output
+            unmapFile(&queuePtr->mappedFile, "hw5Stream");
+            queuePtr->mapped = false;
+        }
+        queuePtr->recordCount = 0;
+        if (queuePtr->mapped) {
+            queuePtr->mappedPosition = 0;
+            queuePtr->skippingWhitespace = false;
+            continue;
+        }
 
-        // Lock this file's mutex before its thread launches to ensure the thread can wait on the read condition before
-        // the main thread locks the mutex and signals the read condition
-        safeMutexLock(&threadStartArgPtr->syncMutex, "hw5");
+        refillPtr->inFilePath = inFilePath;
+        refillPtr->recordFormatPtr = recordFormatPtr;
+        refillPtr->characterRing = spscRingCreate(characterRingCapacity, ringWait, "hw5Stream");
+        refillPtr->stats = readerStats;
+        spscRingSetStats(refillPtr->characterRing, readerStats, writerStats);
+        spscRingSetSpinWaitPolicy(refillPtr->characterRing, spinWaitPolicy);
+        refillPtr->inFile = NULL;
+        refillPtr->reader = NULL;
+        recordScanInit(&refillPtr->statsScan);
+        refillPtr->exhausted = false;
+        atomic_init(&refillPtr->pending, false);
 
-        threadIds[i] = safePthreadCreate(
-            NULL,
-            readFileCharactersThreadStart,
-            threadStartArgPtr,
-            "hw5"
-        );
+        queuePtr->refill = refillPtr;
+        queuePtr->batch = safeMalloc(sizeof *queuePtr->batch * characterBatchCapacity, "hw5Stream");
+        queuePtr->batchLength = 0;
+        queuePtr->batchPosition = 0;
+
+        unmappedCount += 1;
     }
 
-    while (true) {
-        bool foundUnfinished = false;
+    struct StreamCheckpointer checkpointer;
+    struct StreamCheckpointer * const checkpointerPtr = options->checkpointPath != NULL ? &checkpointer : NULL;
+    bool resumed = false;
+    if (checkpointerPtr != NULL) {
+        // Only mapped inputs can be resumed part way through, and only uncompressed output can be cut back
+        if (unmappedCount > 0 || options->gzipOutput) {
+            abortWithError(
+                "hw5Stream: Checkpoints need every input to be an uncompressed regular file, and uncompressed output"
+            );
+        }
+
+        checkpointer.filePath = options->checkpointPath;
+        checkpointer.checkpoint = hw5CheckpointCreate(inFileCount, recordFormatPtr, schedulePtr, "hw5Stream");
+        checkpointer.intervalBytes = options->checkpointIntervalBytes;
+        resumed = resumeFromCheckpoint(checkpointerPtr, queues, inFileCount);
+        checkpointer.nextOutputOffset = checkpointer.checkpoint->outputOffset + checkpointer.intervalBytes;
+    }
+    size_t roundCount = resumed ? checkpointer.checkpoint->roundCount : 0;
 
+    // Mapped inputs have no reader task, so what is left of them is accounted to their readers up front
+    if (stats != NULL) {
         for (size_t i = 0; i < inFileCount; i += 1) {
-            struct ReadFileCharactersThreadStartArg * const threadStartArgPtr = &threadStartArgs[i];
+            if (queues[i].mapped) {
+                addMappedInputStats(&queues[i], recordFormatPtr, &stats->readers[i]);
+            }
+        }
+    }
 
-            if (threadStartArgPtr->finished) {
-                continue;
+    // Opened after the statistics reporter starts, since a compressing writer starts threads of its own. A resumed run
+    // discards any output written after its checkpoint
+    struct BufferedWriter * const outWriter = (
+        resumed
+            ? bufferedWriterOpenAt(outFilePath, checkpointer.checkpoint->outputOffset, outFileBufferSize, "hw5Stream")
+            : openOutWriter(outFilePath, options)
+    );
+    bufferedWriterSetStats(outWriter, writerStats);
+
+    struct WorkerPool *pool = NULL;
+    if (unmappedCount > 0) {
+        size_t poolSize = options->workerCount > 0 ? options->workerCount : getOnlineProcessorCount();
+        if (poolSize > unmappedCount) {
+            poolSize = unmappedCount;
+        }
+        struct ThreadSettings const workerSettings = getWorkerThreadSettings(options);
+        pool = workerPoolCreate(poolSize, &workerSettings, "hw5Stream");
+
+        // Start every input's first refill right away so reading runs ahead of the first round
+        for (size_t i = 0; i < inFileCount; i += 1) {
+            if (!queues[i].mapped) {
+                requestRingRefill(queues[i].refill, pool);
             }
+        }
+    }
 
-            safeMutexLock(&threadStartArgPtr->syncMutex, "hw5");
-            safeConditionSignal(&threadStartArgPtr->readCondition, "hw5");
-            safeConditionWait(&threadStartArgPtr->wroteCondition, &threadStartArgPtr->syncMutex, "hw5");
-            safeMutexUnlock(&threadStartArgPtr->syncMutex, "hw5");
+    size_t const interleavedRoundCount = (
+        characterRecords && schedulePtr->roundRobin
+            ? interleaveTwoByteRecordRounds(queues, inFileCount, roundCount, checkpointerPtr, outWriter)
+            : 0
+    );
+    roundCount += interleavedRoundCount;
+    if (writerStats != NULL) {
+        threadStatsAdd(&writerStats->recordCount, interleavedRoundCount * inFileCount);
+    }
 
-            if (threadStartArgPtr->finished) {
+    // Each round walks the precomputed schedule, so picking the next input never branches
+    uint32_t const * const slots = schedulePtr->slots;
+    size_t const slotCount = schedulePtr->slotCount;
+    while (true) {
+        size_t roundRecordCount = 0;
+
+        for (size_t slot = 0; slot < slotCount; slot += 1) {
+            struct CharacterQueue * const queuePtr = &queues[slots[slot]];
+
+            if (!characterRecords) {
+                if (transferRecord(queuePtr, pool, recordFormatPtr, outWriter)) {
+                    queuePtr->recordCount += 1;
+                    roundRecordCount += 1;
+                }
+                continue;
+            }
+
+            char readCharacter;
+            if (!dequeueCharacter(queuePtr, pool, &readCharacter)) {
                 continue;
             }
-            foundUnfinished = true;
+            queuePtr->recordCount += 1;
+            roundRecordCount += 1;
 
-            safeFprintf(outFile, "hw5", "%c\n", readCharacter);
+            char const record[] = { readCharacter, '\n' };
+            bufferedWriterWrite(outWriter, record, sizeof record, "hw5Stream");
         }
 
-        if (!foundUnfinished) {
+        if (roundRecordCount == 0) {
             break;
         }
+        roundCount += 1;
+        if (writerStats != NULL) {
+            threadStatsAdd(&writerStats->recordCount, roundRecordCount);
+        }
+        if (checkpointerPtr != NULL && bufferedWriterGetOffset(outWriter) >= checkpointerPtr->nextOutputOffset) {
+            saveCheckpoint(checkpointerPtr, queues, inFileCount, roundCount, outWriter);
+        }
+    }
+
+    if (pool != NULL) {
+        workerPoolDestroy(pool, "hw5Stream");
     }
 
     for (size_t i = 0; i < inFileCount; i += 1) {
-        struct ReadFileCharactersThreadStartArg * const threadStartArgPtr = &threadStartArgs[i];
-        pthread_t const threadId = threadIds[i];
+        struct CharacterQueue * const queuePtr = &queues[i];
 
-        safePthreadJoin(threadId, "hw5");
-        safeMutexDestroy(&threadStartArgPtr->syncMutex, "hw5");
-        safeConditionDestroy(&threadStartArgPtr->readCondition, "hw5");
-        safeConditionDestroy(&threadStartArgPtr->wroteCondition, "hw5");
+        if (queuePtr->mapped) {
+            unmapFile(&queuePtr->mappedFile, "hw5Stream");
+            continue;
+        }
+
+        spscRingDestroy(queuePtr->refill->characterRing, "hw5Stream");
+        free(queuePtr->batch);
     }
 
-    free(threadStartArgs);
-    free(threadIds);
+    free(refills);
+    free(queues);
+
+    bufferedWriterClose(outWriter, "hw5Stream");
+
+    // The run is complete, so there is nothing left to resume
+    if (checkpointerPtr != NULL) {
+        hw5CheckpointRemove(checkpointer.filePath, "hw5Stream");
+        hw5CheckpointDestroy(checkpointer.checkpoint);
+    }
 
-    fclose(outFile);
+    if (stats != NULL) {
+        hw5StatsReporterStop(statsReporter, "hw5Stream");
+        hw5StatsWriteJson(stats, true, options->statsFile, "hw5Stream");
+        hw5StatsDestroy(stats);
+    }
 }
 
-static void *readFileCharactersThreadStart(void * const argAsVoidPtr) {
-    assert(argAsVoidPtr != NULL);
-    struct ReadFileCharactersThreadStartArg * const argPtr = argAsVoidPtr;
+/**
+ * Get the settings of the worker threads: the stack size the options ask for, and every processor but the first, which
+ * is the calling thread's.
+ */
+static struct ThreadSettings getWorkerThreadSettings(struct Hw5Options const * const options) {
+    bool const sharesFirstCpu = options->cpuCount < 2;
+    return (struct ThreadSettings){
+        .stackSize = options->workerStackSize,
+        .cpus = sharesFirstCpu ? options->cpus : &options->cpus[1],
+        .cpuCount = sharesFirstCpu ? options->cpuCount : options->cpuCount - 1
+    };
+}
 
-    FILE * const inFile = safeFopen(argPtr->inFilePath, "r", "readFileCharactersThreadStart");
+/**
+ * Open the output file for buffered writing, compressing it if the options ask for that.
+ */
+static struct BufferedWriter *openOutWriter(char const * const outFilePath, struct Hw5Options const * const options) {
+    if (!options->gzipOutput) {
+        return bufferedWriterOpen(outFilePath, outFileBufferSize, "openOutWriter");
+    }
 
-    // syncMutex is already locked
-    while (true) {
-        safeConditionWait(&argPtr->readCondition, &argPtr->syncMutex, "readFileCharactersThreadStart");
+    size_t const threadCount = options->workerCount > 0 ? options->workerCount : getOnlineProcessorCount();
+    return bufferedWriterOpenGzip(
+        outFilePath,
+        outFileBufferSize,
+        threadCount,
+        options->gzipOutputLevel,
+        "openOutWriter"
+    );
+}
+
+/**
+ * Load the checkpointer's checkpoint file, if there is one, and position each (mapped) queue where the checkpoint left
+ * it. If the checkpoint does not match the inputs, abort the program with an error message.
+ *
+ * @returns True if the run is resumed from a checkpoint, or false if it starts from the beginning.
+ */
+static bool resumeFromCheckpoint(
+    struct StreamCheckpointer * const checkpointerPtr,
+    struct CharacterQueue * const queues,
+    size_t const queueCount
+) {
+    struct Hw5Checkpoint * const checkpoint = checkpointerPtr->checkpoint;
+
+    bool const loaded = hw5CheckpointTryLoad(checkpoint, checkpointerPtr->filePath, "resumeFromCheckpoint");
+    for (size_t i = 0; i < queueCount; i += 1) {
+        struct CharacterQueue * const queuePtr = &queues[i];
+        struct Hw5CheckpointInput const * const inputPtr = &checkpoint->inputs[i];
+
+        if (!loaded) {
+            checkpoint->inputs[i].fileLength = queuePtr->mappedFile.length;
+            continue;
+        }
+
+        if (inputPtr->fileLength != queuePtr->mappedFile.length || inputPtr->byteOffset > inputPtr->fileLength) {
+            abortWithErrorFmt(
+                "resumeFromCheckpoint: Input %zu does not match checkpoint \"%s\"",
+                i,
+                checkpointerPtr->filePath
+            );
+        }
+
+        // Every checkpoint is taken between records, and records after the first are preceded by skipped whitespace
+        queuePtr->mappedPosition = inputPtr->byteOffset;
+        queuePtr->skippingWhitespace = inputPtr->recordCount > 0;
+        queuePtr->recordCount = inputPtr->recordCount;
+    }
+
+    return loaded;
+}
+
+/**
+ * Sync the output written so far, then save a checkpoint of the given round boundary.
+ */
+static void saveCheckpoint(
+    struct StreamCheckpointer * const checkpointerPtr,
+    struct CharacterQueue const * const queues,
+    size_t const queueCount,
+    size_t const roundCount,
+    struct BufferedWriter * const outWriter
+) {
+    struct Hw5Checkpoint * const checkpoint = checkpointerPtr->checkpoint;
+
+    // The checkpoint must never describe output that could still be lost
+    bufferedWriterSync(outWriter, "saveCheckpoint");
+
+    checkpoint->roundCount = roundCount;
+    checkpoint->outputOffset = bufferedWriterGetOffset(outWriter);
+    for (size_t i = 0; i < queueCount; i += 1) {
+        checkpoint->inputs[i].byteOffset = queues[i].mappedPosition;
+        checkpoint->inputs[i].recordCount = queues[i].recordCount;
+    }
+    hw5CheckpointSave(checkpoint, checkpointerPtr->filePath, "saveCheckpoint");
+
+    checkpointerPtr->nextOutputOffset = checkpoint->outputOffset + checkpointerPtr->intervalBytes;
+}
+
+/**
+ * Add the bytes and records of the given mapped queue's input from its current position on to its reader's statistics.
+ */
+static void addMappedInputStats(
+    struct CharacterQueue const * const queuePtr,
+    struct RecordFormat const * const recordFormatPtr,
+    struct ThreadStats * const readerStats
+) {
+    assert(queuePtr->mapped);
+
+    char const * const data = &queuePtr->mappedFile.data[queuePtr->mappedPosition];
+    size_t const dataLength = queuePtr->mappedFile.length - queuePtr->mappedPosition;
+    threadStatsAdd(&readerStats->byteCount, dataLength);
+
+    if (recordFormatPtr->kind == RECORD_KIND_CHARACTER) {
+        size_t const recordCount = countCharacterRecords(data, dataLength, !queuePtr->skippingWhitespace);
+        threadStatsAdd(&readerStats->recordCount, recordCount);
+        return;
+    }
+
+    // A record that the input ends part way through is still taken
+    struct RecordScan recordScan;
+    recordScanInit(&recordScan);
+    size_t const recordCount = countCompleteRecords(recordFormatPtr, &recordScan, data, dataLength);
+    threadStatsAdd(&readerStats->recordCount, recordCount + (recordScan.recordLength > 0 ? 1 : 0));
+}
+
+/**
+ * Determine whether any of the given input files is a regular gzip file.
+ */
+static bool hasGzipInputFile(char const * const * const inFilePaths, size_t const inFileCount) {
+    for (size_t i = 0; i < inFileCount; i += 1) {
+        if (isGzipFile(inFilePaths[i], "hasGzipInputFile")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Determine whether any of the given input files exists but is not a regular file (e.g. is a FIFO).
+ */
+static bool hasNonRegularInputFile(char const * const * const inFilePaths, size_t const inFileCount) {
+    for (size_t i = 0; i < inFileCount; i += 1) {
+        struct stat pathStatus;
+        if (stat(inFilePaths[i], &pathStatus) == 0 && !S_ISREG(pathStatus.st_mode)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static enum SpscRingWait getRingWait(enum Hw5Handoff const handoff) {
+    switch (handoff) {
+        case HW5_HANDOFF_CONDITION: {
+            return SPSC_RING_WAIT_CONDITION;
+        }
+        case HW5_HANDOFF_EVENT: {
+            return SPSC_RING_WAIT_EVENT;
+        }
+        default: {
+            abortWithErrorFmt("getRingWait: Unknown handoff %d", (int)handoff);
+            return SPSC_RING_WAIT_CONDITION;
+        }
+    }
+}
+
+/**
+ * Write as many leading rounds as possible using the vectorized interleave kernel. This applies only when every input
+ * is mapped, and only to the rounds in which every input's records are verified to be in the canonical two-byte
+ * `"X\n"` layout; verification happens one chunk at a time just before the chunk is interleaved. Each queue is then
+ * left positioned at the first round not yet written, for the general loop to continue from. Rounds are one record
+ * from each input in turn, so this is only for a round-robin schedule.
+ *
+ * @param queues The queues.
+ * @param queueCount The number of queues.
+ * @param startRound The number of rounds already written (by a run resumed from a checkpoint). Applies only if every
+ *                   queue is positioned just after that many two-byte records.
+ * @param checkpointerPtr The checkpointer, or null to not take checkpoints.
+ * @param outWriter The output writer.
+ *
+ * @returns The number of rounds written.
+ */
+static size_t interleaveTwoByteRecordRounds(
+    struct CharacterQueue * const queues,
+    size_t const queueCount,
+    size_t const startRound,
+    struct StreamCheckpointer * const checkpointerPtr,
+    struct BufferedWriter * const outWriter
+) {
+    assert(queues != NULL);
+    assert(outWriter != NULL);
+
+    if (queueCount == 0) {
+        return 0;
+    }
 
-        bool const scanned = scanFileExact(inFile, 1, "%c\n", argPtr->characterOutPtr);
-        if (!scanned) {
-            argPtr->finished = true;
+    size_t endRound = SIZE_MAX;
+    for (size_t i = 0; i < queueCount; i += 1) {
+        struct CharacterQueue const * const queuePtr = &queues[i];
+        if (!queuePtr->mapped || queuePtr->mappedPosition != startRound * 2 || queuePtr->recordCount != startRound) {
+            return 0;
         }
 
-        safeConditionSignal(&argPtr->wroteCondition, "readFileCharactersThreadStart");
+        size_t const recordCount = queuePtr->mappedFile.length / 2;
+        if (recordCount < endRound) {
+            endRound = recordCount;
+        }
+    }
+    if (endRound <= startRound) {
+        return 0;
+    }
+
+    char const ** const inputs = safeMalloc(sizeof *inputs * queueCount, "interleaveTwoByteRecordRounds");
+    for (size_t i = 0; i < queueCount; i += 1) {
+        inputs[i] = queues[i].mappedFile.data;
+    }
 
-        if (!scanned) {
+    size_t const roundSize = queueCount * 2;
+    size_t const chunkRoundCount = interleavedChunkSize > roundSize ? interleavedChunkSize / roundSize : 1;
+    if (chunkRoundCount * roundSize > outFileBufferSize) {
+        free(inputs);
+        return 0;
+    }
+
+    size_t round = startRound;
+    while (round < endRound) {
+        size_t const remainingRoundCount = endRound - round;
+        size_t const chunkLength = remainingRoundCount < chunkRoundCount ? remainingRoundCount : chunkRoundCount;
+
+        bool verified = true;
+        for (size_t i = 0; i < queueCount && verified; i += 1) {
+            verified = isTwoByteCharacterRecordLayout(&inputs[i][round * 2], chunkLength * 2);
+        }
+        if (!verified) {
             break;
         }
+
+        // Interleave straight into the writer's buffer
+        size_t const chunkSize = chunkLength * roundSize;
+        char * const chunk = bufferedWriterReserve(outWriter, chunkSize, "interleaveTwoByteRecordRounds");
+        interleaveTwoByteRecords(inputs, queueCount, round, chunkLength, chunk);
+        bufferedWriterCommit(outWriter, chunkSize);
+        round += chunkLength;
+
+        if (checkpointerPtr != NULL && bufferedWriterGetOffset(outWriter) >= checkpointerPtr->nextOutputOffset) {
+            positionInterleavedQueues(queues, queueCount, round);
+            saveCheckpoint(checkpointerPtr, queues, queueCount, round, outWriter);
+        }
+    }
+
+    free(inputs);
+
+    positionInterleavedQueues(queues, queueCount, round);
+    return round - startRound;
+}
+
+/**
+ * Position each queue after the given number of rounds of two-byte records.
+ */
+static void positionInterleavedQueues(
+    struct CharacterQueue * const queues,
+    size_t const queueCount,
+    size_t const roundCount
+) {
+    // Having consumed "X\n" records, each parse resumes at the next record while skipping whitespace
+    for (size_t i = 0; i < queueCount; i += 1) {
+        queues[i].mappedPosition = roundCount * 2;
+        queues[i].skippingWhitespace = roundCount > 0;
+        queues[i].recordCount = roundCount;
+    }
+}
+
+/**
+ * Take the next character read from the given queue's input file, waiting for a refill of its ring if necessary.
+ *
+ * @param queuePtr The queue.
+ * @param pool The worker pool running ring refills.
+ * @param characterOutPtr Where to store the character.
+ *
+ * @returns True if a character was taken, or false if the input file has been exhausted.
+ */
+static bool dequeueCharacter(
+    struct CharacterQueue * const queuePtr,
+    struct WorkerPool * const pool,
+    char * const characterOutPtr
+) {
+    assert(queuePtr != NULL);
+    assert(characterOutPtr != NULL);
+
+    if (queuePtr->finished) {
+        return false;
+    }
+
+    if (queuePtr->mapped) {
+        // Same semantics as scanCharacterRecords, walking the mapping directly
+        char const * const data = queuePtr->mappedFile.data;
+        size_t const length = queuePtr->mappedFile.length;
+        size_t position = queuePtr->mappedPosition;
+
+        if (queuePtr->skippingWhitespace) {
+            while (position < length && isScanfWhitespace(data[position])) {
+                position += 1;
+            }
+        }
+        if (position == length) {
+            queuePtr->finished = true;
+            return false;
+        }
+
+        *characterOutPtr = data[position];
+        queuePtr->mappedPosition = position + 1;
+        queuePtr->skippingWhitespace = true;
+        return true;
+    }
+
+    if (queuePtr->batchPosition == queuePtr->batchLength && takeRingBatch(queuePtr, pool) == 0) {
+        queuePtr->finished = true;
+        return false;
+    }
+
+    *characterOutPtr = queuePtr->batch[queuePtr->batchPosition];
+    queuePtr->batchPosition += 1;
+    return true;
+}
+
+/**
+ * Write the next record of the given queue's input file to the output, a piece at a time if it spans batches, waiting
+ * for refills of its ring as necessary. Nothing is copied besides the write itself.
+ *
+ * @param queuePtr The queue.
+ * @param pool The worker pool running ring refills.
+ * @param recordFormatPtr The record format.
+ * @param outWriter The output writer.
+ *
+ * @returns True if a record was written, or false if the input file has been exhausted.
+ */
+static bool transferRecord(
+    struct CharacterQueue * const queuePtr,
+    struct WorkerPool * const pool,
+    struct RecordFormat const * const recordFormatPtr,
+    struct BufferedWriter * const outWriter
+) {
+    assert(queuePtr != NULL);
+    assert(recordFormatPtr != NULL);
+    assert(outWriter != NULL);
+
+    if (queuePtr->finished) {
+        return false;
+    }
+
+    char const * const data = queuePtr->mapped ? queuePtr->mappedFile.data : queuePtr->batch;
+    size_t * const positionPtr = queuePtr->mapped ? &queuePtr->mappedPosition : &queuePtr->batchPosition;
+    size_t length = queuePtr->mapped ? queuePtr->mappedFile.length : queuePtr->batchLength;
+
+    char terminator;
+    while (true) {
+        if (*positionPtr == length) {
+            length = queuePtr->mapped ? 0 : takeRingBatch(queuePtr, pool);
+            if (length == 0) {
+                // The input ended, possibly part way through a record
+                queuePtr->finished = true;
+                bool const incomplete = queuePtr->recordScan.recordLength > 0;
+                if (incomplete && getRecordTerminator(recordFormatPtr, false, &terminator)) {
+                    bufferedWriterWrite(outWriter, &terminator, 1, "transferRecord");
+                }
+                return incomplete;
+            }
+        }
+
+        size_t pieceOffset;
+        size_t pieceLength;
+        bool complete;
+        size_t const scannedLength = scanRecordPiece(
+            recordFormatPtr,
+            &queuePtr->recordScan,
+            &data[*positionPtr],
+            length - *positionPtr,
+            &pieceOffset,
+            &pieceLength,
+            &complete
+        );
+        if (pieceLength > 0) {
+            bufferedWriterWrite(outWriter, &data[*positionPtr + pieceOffset], pieceLength, "transferRecord");
+        }
+        *positionPtr += scannedLength;
+
+        if (complete) {
+            if (getRecordTerminator(recordFormatPtr, true, &terminator)) {
+                bufferedWriterWrite(outWriter, &terminator, 1, "transferRecord");
+            }
+            return true;
+        }
+    }
+}
+
+/**
+ * Replace the given queue's drained batch with the next batch from its ring, waiting for a refill if necessary.
+ *
+ * @param queuePtr The queue, which must not be mapped.
+ * @param pool The worker pool running ring refills.
+ *
+ * @returns The length of the new batch, or 0 if the input file has been exhausted.
+ */
+static size_t takeRingBatch(struct CharacterQueue * const queuePtr, struct WorkerPool * const pool) {
+    assert(queuePtr != NULL);
+    assert(!queuePtr->mapped);
+
+    struct SpscRing * const characterRing = queuePtr->refill->characterRing;
+
+    size_t batchLength = spscRingTryRead(characterRing, queuePtr->batch, characterBatchCapacity);
+    if (batchLength < characterBatchCapacity) {
+        // The ring has been drained; refill it while this batch is consumed
+        requestRingRefill(queuePtr->refill, pool);
+    }
+    if (batchLength == 0) {
+        batchLength = spscRingRead(characterRing, queuePtr->batch, characterBatchCapacity, "takeRingBatch");
+    }
+
+    queuePtr->batchLength = batchLength;
+    queuePtr->batchPosition = 0;
+    return batchLength;
+}
+
+/**
+ * Submit a refill of the given input's ring unless one is already pending or the input has been exhausted. May only be
+ * called by the main thread, once the ring has been drained.
+ */
+static void requestRingRefill(struct RingRefill * const refillPtr, struct WorkerPool * const pool) {
+    assert(refillPtr != NULL);
+    assert(pool != NULL);
+
+    // Pairs with the fence in refillCharacterRingTask so that either this thread sees the refill finished or the refill
+    // sees the ring drained and resumes
+    atomic_thread_fence(memory_order_seq_cst);
+    bool expectedPending = false;
+    if (
+        !atomic_compare_exchange_strong_explicit(
+            &refillPtr->pending,
+            &expectedPending,
+            true,
+            memory_order_acquire,
+            memory_order_relaxed
+        )
+    ) {
+        return;
+    }
+    if (refillPtr->exhausted) {
+        atomic_store_explicit(&refillPtr->pending, false, memory_order_relaxed);
+        return;
+    }
+
+    workerPoolSubmit(pool, refillCharacterRingTask, refillPtr, "requestRingRefill");
+}
+
+static void refillCharacterRingTask(void * const argAsVoidPtr) {
+    assert(argAsVoidPtr != NULL);
+    struct RingRefill * const refillPtr = argAsVoidPtr;
+
+    struct RecordFormat const * const recordFormatPtr = refillPtr->recordFormatPtr;
+
+    if (refillPtr->inFile == NULL) {
+        refillPtr->inFile = safeFopenDecoded(refillPtr->inFilePath, "refillCharacterRingTask");
+        if (recordFormatPtr->kind == RECORD_KIND_CHARACTER) {
+            refillPtr->reader = characterRecordReaderCreate(
+                refillPtr->inFile,
+                inFileBlockSize,
+                "refillCharacterRingTask"
+            );
+            characterRecordReaderSetStats(refillPtr->reader, refillPtr->stats);
+        }
+    }
+
+    // The batch only lives as long as this task, so it comes from the worker's scratch memory rather than the heap
+    struct Arena * const scratchArena = getThreadScratchArena("refillCharacterRingTask");
+    struct ArenaMark const scratchMark = arenaGetMark(scratchArena);
+    char * const batch = arenaAlloc(scratchArena, sizeof *batch * characterBatchCapacity, "refillCharacterRingTask");
+
+    while (refillRing(refillPtr, batch)) {
+        atomic_store_explicit(&refillPtr->pending, false, memory_order_release);
+
+        // Pairs with the fence in requestRingRefill. If the main thread drained the ring after the last write, it may
+        // have seen this refill still pending and parked on the ring, so refill again rather than leave it waiting
+        atomic_thread_fence(memory_order_seq_cst);
+        bool expectedPending = false;
+        if (
+            !spscRingIsEmpty(refillPtr->characterRing)
+            || !atomic_compare_exchange_strong_explicit(
+                &refillPtr->pending,
+                &expectedPending,
+                true,
+                memory_order_acquire,
+                memory_order_relaxed
+            )
+        ) {
+            arenaResetToMark(scratchArena, scratchMark);
+            return;
+        }
+    }
+
+    arenaResetToMark(scratchArena, scratchMark);
+    if (refillPtr->reader != NULL) {
+        characterRecordReaderDestroy(refillPtr->reader);
+    }
+    fclose(refillPtr->inFile);
+
+    spscRingClose(refillPtr->characterRing, "refillCharacterRingTask");
+    atomic_store_explicit(&refillPtr->pending, false, memory_order_release);
+}
+
+/**
+ * Fill the given refill's ring from its input, which the ring must have room for, until the ring is full or the input
+ * is exhausted. Each batch is read into the given buffer of characterBatchCapacity bytes before it is written to the
+ * ring.
+ *
+ * @returns False if the input has been exhausted, or true otherwise.
+ */
+static bool refillRing(struct RingRefill * const refillPtr, char * const batch) {
+    assert(refillPtr != NULL);
+    assert(batch != NULL);
+
+    struct RecordFormat const * const recordFormatPtr = refillPtr->recordFormatPtr;
+
+    // The ring was empty when this refill was requested, so a whole ring's worth fits without blocking
+    size_t refilledLength = 0;
+    while (refilledLength < characterRingCapacity) {
+        size_t const remainingLength = characterRingCapacity - refilledLength;
+        size_t const batchCapacity = (
+            remainingLength < characterBatchCapacity ? remainingLength : characterBatchCapacity
+        );
+        size_t const batchLength = (
+            refillPtr->reader != NULL
+                ? characterRecordReaderRead(refillPtr->reader, batch, batchCapacity, "refillRing")
+                : readInputBytes(refillPtr, batch, batchCapacity)
+        );
+        if (batchLength == 0) {
+            refillPtr->exhausted = true;
+            if (refillPtr->stats != NULL && refillPtr->statsScan.recordLength > 0) {
+                threadStatsAdd(&refillPtr->stats->recordCount, 1);
+            }
+            return false;
+        }
+
+        spscRingWrite(refillPtr->characterRing, batch, batchLength, "refillRing");
+        refilledLength += batchLength;
+        if (refillPtr->stats != NULL) {
+            threadStatsAdd(
+                &refillPtr->stats->recordCount,
+                refillPtr->reader != NULL
+                    ? batchLength
+                    : countCompleteRecords(recordFormatPtr, &refillPtr->statsScan, batch, batchLength)
+            );
+        }
     }
-    safeMutexUnlock(&argPtr->syncMutex, "readFileCharactersThreadStart");
 
-    fclose(inFile);
+    return true;
+}
 
-    return NULL;
+/**
+ * Read the next bytes of the given refill's input as they are, for record formats that are scanned by the main thread.
+ *
+ * @returns The number of bytes read into the batch, or 0 at the end of the input.
+ */
+static size_t readInputBytes(struct RingRefill * const refillPtr, char * const batch, size_t const capacity) {
+    assert(refillPtr != NULL);
+    assert(batch != NULL);
+
+    uint64_t const readStartNanoseconds = refillPtr->stats != NULL ? getMonotonicNanoseconds() : 0;
+    size_t const readLength = safeFread(batch, 1, capacity, refillPtr->inFile, "readInputBytes");
+    if (refillPtr->stats != NULL) {
+        threadStatsAdd(&refillPtr->stats->byteCount, readLength);
+        threadStatsAdd(&refillPtr->stats->ioNanoseconds, getMonotonicNanoseconds() - readStartNanoseconds);
+    }
+    return readLength;
 }
@@ -0,0 +1,286 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/hw5/checkpoint.h"
+
+#include "../../include/util/memory.h"
+#include "../../include/util/file.h"
+#include "../../include/util/string.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static unsigned int const checkpointVersion = 2;
+
+static void scanCheckpointExact(
+    FILE *file,
+    char const *filePath,
+    unsigned int expectedMatchCount,
+    char const *format,
+    ...
+);
+
+/**
+ * Create a checkpoint of a run that has not started yet. If the operation fails, abort the program with an error
+ * message.
+ *
+ * @param inputCount The number of input files.
+ * @param recordFormatPtr The record format of the run.
+ * @param schedulePtr The schedule of the run, which must outlive the checkpoint.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The checkpoint. The caller is responsible for destroying it using hw5CheckpointDestroy.
+ */
+struct Hw5Checkpoint *hw5CheckpointCreate(
+    size_t const inputCount,
+    struct RecordFormat const * const recordFormatPtr,
+    struct InterleaveSchedule const * const schedulePtr,
+    char const * const callerDescription
+) {
+    guardNotNull(recordFormatPtr, "recordFormatPtr", "hw5CheckpointCreate");
+    guardNotNull(schedulePtr, "schedulePtr", "hw5CheckpointCreate");
+    guardNotNull(callerDescription, "callerDescription", "hw5CheckpointCreate");
+
+    struct Hw5Checkpoint * const checkpoint = safeMalloc(sizeof *checkpoint, callerDescription);
+    checkpoint->recordFormat = *recordFormatPtr;
+    checkpoint->schedule = schedulePtr;
+    checkpoint->roundCount = 0;
+    checkpoint->outputOffset = 0;
+    checkpoint->inputs = safeMalloc(sizeof *checkpoint->inputs * (inputCount > 0 ? inputCount : 1), callerDescription);
+    checkpoint->inputCount = inputCount;
+    for (size_t i = 0; i < inputCount; i += 1) {
+        checkpoint->inputs[i].fileLength = 0;
+        checkpoint->inputs[i].byteOffset = 0;
+        checkpoint->inputs[i].recordCount = 0;
+    }
+
+    return checkpoint;
+}
+
+/**
+ * Load the checkpoint saved in the given file, if there is one. It must have been saved by a run with the same number
+ * of inputs, the same record format and the same schedule as the given checkpoint. If the file cannot be read, is
+ * malformed or belongs to a different run, abort the program with an error message.
+ *
+ * @param checkpoint The checkpoint to load into.
+ * @param filePath The checkpoint file path.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns True if a checkpoint was loaded, or false if the file does not exist.
+ */
+bool hw5CheckpointTryLoad(
+    struct Hw5Checkpoint * const checkpoint,
+    char const * const filePath,
+    char const * const callerDescription
+) {
+    guardNotNull(checkpoint, "checkpoint", "hw5CheckpointTryLoad");
+    guardNotNull(filePath, "filePath", "hw5CheckpointTryLoad");
+    guardNotNull(callerDescription, "callerDescription", "hw5CheckpointTryLoad");
+
+    struct stat fileStatus;
+    if (stat(filePath, &fileStatus) != 0 && errno == ENOENT) {
+        return false;
+    }
+
+    FILE * const file = safeFopen(filePath, "r", callerDescription);
+
+    unsigned int version;
+    int kind;
+    unsigned int delimiter;
+    size_t length;
+    size_t slotCount;
+    size_t inputCount;
+    scanCheckpointExact(file, filePath, 1, "hw5-checkpoint %u", &version);
+    scanCheckpointExact(file, filePath, 3, " format %d %u %zu", &kind, &delimiter, &length);
+    scanCheckpointExact(file, filePath, 1, " schedule %zu", &slotCount);
+
+    struct InterleaveSchedule const * const schedulePtr = checkpoint->schedule;
+    bool sameSchedule = slotCount == schedulePtr->slotCount;
+    for (size_t slot = 0; slot < slotCount; slot += 1) {
+        unsigned int inputIndex;
+        scanCheckpointExact(file, filePath, 1, " %u", &inputIndex);
+        sameSchedule = sameSchedule && inputIndex == schedulePtr->slots[slot];
+    }
+
+    scanCheckpointExact(file, filePath, 1, " rounds %zu", &checkpoint->roundCount);
+    scanCheckpointExact(file, filePath, 1, " output %zu", &checkpoint->outputOffset);
+    scanCheckpointExact(file, filePath, 1, " inputs %zu", &inputCount);
+
+    struct RecordFormat const * const formatPtr = &checkpoint->recordFormat;
+    if (
+        version != checkpointVersion
+        || kind != (int)formatPtr->kind
+        || delimiter != (unsigned char)formatPtr->delimiter
+        || length != formatPtr->length
+        || !sameSchedule
+        || inputCount != checkpoint->inputCount
+    ) {
+        abortWithErrorFmt(
+            "%s: Checkpoint \"%s\" was saved by a different version, record format, schedule or number of inputs",
+            callerDescription,
+            filePath
+        );
+        return false;
+    }
+
+    for (size_t i = 0; i < inputCount; i += 1) {
+        struct Hw5CheckpointInput * const inputPtr = &checkpoint->inputs[i];
+        scanCheckpointExact(
+            file,
+            filePath,
+            3,
+            " %zu %zu %zu",
+            &inputPtr->fileLength,
+            &inputPtr->byteOffset,
+            &inputPtr->recordCount
+        );
+    }
+
+    fclose(file);
+    return true;
+}
+
+/**
+ * Save the given checkpoint to the given file, atomically: the checkpoint is written and synced to a temporary file
+ * which then replaces the file, so a crash at any point leaves either the previous checkpoint or this one. If the
+ * operation fails, abort the program with an error message.
+ *
+ * @param checkpoint The checkpoint.
+ * @param filePath The checkpoint file path.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void hw5CheckpointSave(
+    struct Hw5Checkpoint const * const checkpoint,
+    char const * const filePath,
+    char const * const callerDescription
+) {
+    guardNotNull(checkpoint, "checkpoint", "hw5CheckpointSave");
+    guardNotNull(filePath, "filePath", "hw5CheckpointSave");
+    guardNotNull(callerDescription, "callerDescription", "hw5CheckpointSave");
+
+    // Checkpoints are saved throughout a run, so the path comes from scratch memory rather than the heap
+    struct Arena * const scratchArena = getThreadScratchArena(callerDescription);
+    struct ArenaMark const scratchMark = arenaGetMark(scratchArena);
+    char * const temporaryFilePath = formatStringInArena(scratchArena, "%s.tmp", filePath);
+    FILE * const file = safeFopen(temporaryFilePath, "w", callerDescription);
+
+    struct RecordFormat const * const formatPtr = &checkpoint->recordFormat;
+    safeFprintf(file, callerDescription, "hw5-checkpoint %u\n", checkpointVersion);
+    safeFprintf(
+        file,
+        callerDescription,
+        "format %d %u %zu\n",
+        (int)formatPtr->kind,
+        (unsigned int)(unsigned char)formatPtr->delimiter,
+        formatPtr->length
+    );
+    struct InterleaveSchedule const * const schedulePtr = checkpoint->schedule;
+    safeFprintf(file, callerDescription, "schedule %zu", schedulePtr->slotCount);
+    for (size_t slot = 0; slot < schedulePtr->slotCount; slot += 1) {
+        safeFprintf(file, callerDescription, " %u", (unsigned int)schedulePtr->slots[slot]);
+    }
+    safeFprintf(file, callerDescription, "\n");
+    safeFprintf(file, callerDescription, "rounds %zu\n", checkpoint->roundCount);
+    safeFprintf(file, callerDescription, "output %zu\n", checkpoint->outputOffset);
+    safeFprintf(file, callerDescription, "inputs %zu\n", checkpoint->inputCount);
+    for (size_t i = 0; i < checkpoint->inputCount; i += 1) {
+        struct Hw5CheckpointInput const * const inputPtr = &checkpoint->inputs[i];
+        safeFprintf(
+            file,
+            callerDescription,
+            "%zu %zu %zu\n",
+            inputPtr->fileLength,
+            inputPtr->byteOffset,
+            inputPtr->recordCount
+        );
+    }
+
+    if (fflush(file) != 0) {
+        int const fflushErrorCode = errno;
+        char const * const fflushErrorMessage = strerror(fflushErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to write checkpoint \"%s\" using fflush (error code: %d; error message: \"%s\")",
+            callerDescription,
+            temporaryFilePath,
+            fflushErrorCode,
+            fflushErrorMessage
+        );
+        return;
+    }
+    safeFdatasync(fileno(file), callerDescription);
+    fclose(file);
+
+    // If the rename itself is lost in a crash, the previous checkpoint is still consistent: the output it describes
+    // only ever grows past its offset, and resuming truncates it back
+    safeRename(temporaryFilePath, filePath, callerDescription);
+    arenaResetToMark(scratchArena, scratchMark);
+}
+
+/**
+ * Destroy the given checkpoint.
+ *
+ * @param checkpoint The checkpoint.
+ */
+void hw5CheckpointDestroy(struct Hw5Checkpoint * const checkpoint) {
+    guardNotNull(checkpoint, "checkpoint", "hw5CheckpointDestroy");
+
+    free(checkpoint->inputs);
+    free(checkpoint);
+}
+
+/**
+ * Remove the given checkpoint file, if there is one. If the operation fails, abort the program with an error message.
+ *
+ * @param filePath The checkpoint file path.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void hw5CheckpointRemove(char const * const filePath, char const * const callerDescription) {
+    guardNotNull(filePath, "filePath", "hw5CheckpointRemove");
+    guardNotNull(callerDescription, "callerDescription", "hw5CheckpointRemove");
+
+    if (unlink(filePath) != 0 && errno != ENOENT) {
+        int const unlinkErrorCode = errno;
+        char const * const unlinkErrorMessage = strerror(unlinkErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to remove checkpoint \"%s\" using unlink (error code: %d; error message: \"%s\")",
+            callerDescription,
+            filePath,
+            unlinkErrorCode,
+            unlinkErrorMessage
+        );
+    }
+}
+
+/**
+ * Read values from the given checkpoint file using the given format, aborting the program with an error message if
+ * the file ends first.
+ */
+static void scanCheckpointExact(
+    FILE * const file,
+    char const * const filePath,
+    unsigned int const expectedMatchCount,
+    char const * const format,
+    ...
+) {
+    va_list formatArgs;
+    va_start(formatArgs, format);
+    bool const scanned = scanFileExactVA(file, expectedMatchCount, format, formatArgs);
+    va_end(formatArgs);
+
+    if (!scanned) {
+        abortWithErrorFmt("scanCheckpointExact: Checkpoint \"%s\" ended early", filePath);
+    }
+}
@@ -0,0 +1,530 @@
+#include "../../include/hw5/epoll.h"
+
+#include "../../include/util/memory.h"
+#include "../../include/util/file.h"
+#include "../../include/util/poll.h"
+#include "../../include/util/gzip.h"
+#include "../../include/util/record.h"
+#include "../../include/util/schedule.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <assert.h>
+
+/**
+ * One input and the bytes read from it that have not been consumed yet, which lie at [start, end) of its data. An
+ * uncompressed regular file's data is its mapping. Any other input has a buffer of its own, filled by non-blocking reads whenever
+ * the poller reports the input readable, and is removed from the poller while its buffer is full. Such an input is
+ * checked for the gzip magic bytes before any of it is consumed; if it is compressed, its reads go to a compressed
+ * buffer instead, and its buffer holds what has been decoded from it.
+ */
+struct PolledInput {
+    char const *inFilePath;
+    int fileDescriptor;
+    bool mapped;
+    struct MappedFile mappedFile;
+
+    bool pollable;
+    bool watched;
+    bool reachedEnd;
+
+    char *buffer;
+    char const *data;
+    size_t start;
+    size_t end;
+
+    bool sniffed;
+    struct GzipDecoder *decoder;
+    char *compressedBuffer;
+    size_t compressedStart;
+    size_t compressedEnd;
+
+    struct RecordScan recordScan;
+    bool finished;
+};
+
+/**
+ * The inputs, and the single poller through which every pollable input is read.
+ */
+struct PollEngine {
+    struct PolledInput *inputs;
+    size_t inputCount;
+    size_t bufferSize;
+
+    struct Poller *poller;
+    uint64_t *readyInputIndices;
+    size_t readyCapacity;
+};
+
+static size_t const inputBufferBudget = 67108864;
+static size_t const minInputBufferSize = 4096;
+static size_t const maxInputBufferSize = 65536;
+static size_t const maxReadyInputCount = 64;
+
+static void sniffInput(struct PollEngine *enginePtr, size_t inputIndex);
+static bool fillInput(struct PollEngine *enginePtr, size_t inputIndex);
+static bool decodeInput(struct PollEngine *enginePtr, size_t inputIndex);
+static void readReadyInputs(struct PollEngine *enginePtr);
+static void readPolledInput(struct PollEngine *enginePtr, size_t inputIndex);
+static bool takeCharacter(struct PollEngine *enginePtr, size_t inputIndex, char *characterOutPtr);
+static bool transferRecord(
+    struct PollEngine *enginePtr,
+    size_t inputIndex,
+    struct RecordFormat const *recordFormatPtr,
+    struct BufferedWriter *outWriter
+);
+
+/**
+ * Run HW5 on a single thread, with no reader threads. Regular input files are mapped. Every other input (e.g. a FIFO
+ * fed by a producer process) is opened non-blocking and read through one epoll instance into a buffer of its own, so
+ * while the calling thread waits for the next record of one input, whatever the other inputs' producers write is read
+ * as it arrives. Records are still written in the strict order of the schedule. Gzip-compressed inputs are detected by
+ * their magic bytes and decoded as their records are needed.
+ *
+ * A FIFO is opened without waiting for its writer. Its end is only detected once a writer has opened and closed it,
+ * since epoll reports nothing for a FIFO that has never had a writer.
+ *
+ * @param inFilePaths The input file paths.
+ * @param inFileCount The number of input files.
+ * @param outWriter The output writer, which the caller remains responsible for closing.
+ * @param recordFormatPtr The record format.
+ * @param schedulePtr The order in which records are taken from the inputs.
+ */
+void hw5Epoll(
+    char const * const * const inFilePaths,
+    size_t const inFileCount,
+    struct BufferedWriter * const outWriter,
+    struct RecordFormat const * const recordFormatPtr,
+    struct InterleaveSchedule const * const schedulePtr
+) {
+    guardNotNull(inFilePaths, "inFilePaths", "hw5Epoll");
+    guardNotNull(outWriter, "outWriter", "hw5Epoll");
+    guardNotNull(recordFormatPtr, "recordFormatPtr", "hw5Epoll");
+    guardNotNull(schedulePtr, "schedulePtr", "hw5Epoll");
+
+    bool const characterRecords = recordFormatPtr->kind == RECORD_KIND_CHARACTER;
+
+    size_t bufferSize = inFileCount > 0 ? inputBufferBudget / inFileCount : maxInputBufferSize;
+    if (bufferSize < minInputBufferSize) {
+        bufferSize = minInputBufferSize;
+    }
+    if (bufferSize > maxInputBufferSize) {
+        bufferSize = maxInputBufferSize;
+    }
+
+    size_t readyCapacity = inFileCount < maxReadyInputCount ? inFileCount : maxReadyInputCount;
+    if (readyCapacity == 0) {
+        readyCapacity = 1;
+    }
+    struct PollEngine engine = {
+        .inputs = safeMalloc(sizeof *engine.inputs * inFileCount, "hw5Epoll"),
+        .inputCount = inFileCount,
+        .bufferSize = bufferSize,
+        .poller = pollerCreate(readyCapacity, "hw5Epoll"),
+        .readyInputIndices = safeMalloc(sizeof *engine.readyInputIndices * readyCapacity, "hw5Epoll"),
+        .readyCapacity = readyCapacity
+    };
+
+    for (size_t i = 0; i < inFileCount; i += 1) {
+        struct PolledInput * const inputPtr = &engine.inputs[i];
+
+        inputPtr->inFilePath = inFilePaths[i];
+        recordScanInit(&inputPtr->recordScan);
+        inputPtr->finished = false;
+        inputPtr->start = 0;
+        inputPtr->decoder = NULL;
+        inputPtr->compressedBuffer = NULL;
+        inputPtr->compressedStart = 0;
+        inputPtr->compressedEnd = 0;
+
+        inputPtr->mapped = tryMapFile(inFilePaths[i], &inputPtr->mappedFile, "hw5Epoll");
+        if (inputPtr->mapped && hasGzipMagic(inputPtr->mappedFile.data, inputPtr->mappedFile.length)) {
+            // Read and decoded like a stream, with blocking reads since a regular file cannot be polled
+            unmapFile(&inputPtr->mappedFile, "hw5Epoll");
+            inputPtr->mapped = false;
+        }
+        if (inputPtr->mapped) {
+            inputPtr->fileDescriptor = -1;
+            inputPtr->pollable = false;
+            inputPtr->watched = false;
+            inputPtr->reachedEnd = true;
+            inputPtr->buffer = NULL;
+            inputPtr->data = inputPtr->mappedFile.data;
+            inputPtr->end = inputPtr->mappedFile.length;
+            inputPtr->sniffed = true;
+            continue;
+        }
+
+        // Opening a FIFO non-blocking does not wait for its writer
+        inputPtr->fileDescriptor = safeOpen(inFilePaths[i], O_RDONLY | O_NONBLOCK, 0, "hw5Epoll");
+        inputPtr->pollable = pollerTryAdd(engine.poller, inputPtr->fileDescriptor, i, "hw5Epoll");
+        inputPtr->watched = inputPtr->pollable;
+        if (!inputPtr->pollable) {
+            // Read with blocking reads when its records are needed instead
+            safeSetNonBlocking(inputPtr->fileDescriptor, false, "hw5Epoll");
+        }
+        inputPtr->reachedEnd = false;
+        inputPtr->buffer = safeMalloc(sizeof *inputPtr->buffer * bufferSize, "hw5Epoll");
+        inputPtr->data = inputPtr->buffer;
+        inputPtr->end = 0;
+        inputPtr->sniffed = false;
+    }
+
+    uint32_t const * const slots = schedulePtr->slots;
+    size_t const slotCount = schedulePtr->slotCount;
+    while (true) {
+        bool foundUnfinished = false;
+
+        for (size_t slot = 0; slot < slotCount; slot += 1) {
+            size_t const i = slots[slot];
+            if (!characterRecords) {
+                foundUnfinished = transferRecord(&engine, i, recordFormatPtr, outWriter) || foundUnfinished;
+                continue;
+            }
+
+            char readCharacter;
+            if (!takeCharacter(&engine, i, &readCharacter)) {
+                continue;
+            }
+            foundUnfinished = true;
+
+            char const record[] = { readCharacter, '\n' };
+            bufferedWriterWrite(outWriter, record, sizeof record, "hw5Epoll");
+        }
+
+        if (!foundUnfinished) {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < inFileCount; i += 1) {
+        struct PolledInput * const inputPtr = &engine.inputs[i];
+
+        if (inputPtr->mapped) {
+            unmapFile(&inputPtr->mappedFile, "hw5Epoll");
+            continue;
+        }
+
+        if (inputPtr->watched) {
+            pollerRemove(engine.poller, inputPtr->fileDescriptor, "hw5Epoll");
+        }
+        safeClose(inputPtr->fileDescriptor, "hw5Epoll");
+        free(inputPtr->buffer);
+        if (inputPtr->decoder != NULL) {
+            gzipDecoderDestroy(inputPtr->decoder);
+            free(inputPtr->compressedBuffer);
+        }
+    }
+    pollerDestroy(engine.poller, "hw5Epoll");
+    free(engine.readyInputIndices);
+    free(engine.inputs);
+}
+
+/**
+ * Determine whether the given input, none of which has been consumed yet, is gzip-compressed, first waiting until it
+ * holds enough bytes to tell or has ended. A compressed input's bytes are moved to its compressed buffer, to be decoded
+ * into its buffer as its records are needed. Meanwhile every other pollable input that becomes readable is read into
+ * its buffer.
+ */
+static void sniffInput(struct PollEngine * const enginePtr, size_t const inputIndex) {
+    struct PolledInput * const inputPtr = &enginePtr->inputs[inputIndex];
+    assert(!inputPtr->mapped && inputPtr->start == 0);
+
+    size_t const magicLength = 2;
+    while (inputPtr->end < magicLength && !inputPtr->reachedEnd) {
+        if (!inputPtr->pollable) {
+            size_t const readLength = safeRead(
+                inputPtr->fileDescriptor,
+                &inputPtr->buffer[inputPtr->end],
+                enginePtr->bufferSize - inputPtr->end,
+                "sniffInput"
+            );
+            inputPtr->end += readLength;
+            inputPtr->reachedEnd = readLength == 0;
+            continue;
+        }
+
+        readReadyInputs(enginePtr);
+    }
+    inputPtr->sniffed = true;
+
+    if (!hasGzipMagic(inputPtr->buffer, inputPtr->end)) {
+        return;
+    }
+
+    // The compressed buffer is as full as the buffer was, so whether the input is watched stays right
+    inputPtr->decoder = gzipDecoderCreate(inputPtr->inFilePath, "sniffInput");
+    inputPtr->compressedBuffer = safeMalloc(sizeof *inputPtr->compressedBuffer * enginePtr->bufferSize, "sniffInput");
+    memcpy(inputPtr->compressedBuffer, inputPtr->buffer, inputPtr->end);
+    inputPtr->compressedStart = 0;
+    inputPtr->compressedEnd = inputPtr->end;
+    inputPtr->end = 0;
+}
+
+/**
+ * Wait until the given input, whose data has all been consumed, has more data or has ended. Meanwhile every other
+ * pollable input that becomes readable is read into its buffer.
+ *
+ * @returns True if the input has more data, or false if it has ended.
+ */
+static bool fillInput(struct PollEngine * const enginePtr, size_t const inputIndex) {
+    struct PolledInput * const inputPtr = &enginePtr->inputs[inputIndex];
+    assert(inputPtr->start == inputPtr->end);
+
+    if (inputPtr->mapped) {
+        return false;
+    }
+    if (inputPtr->decoder != NULL) {
+        return decodeInput(enginePtr, inputIndex);
+    }
+
+    inputPtr->start = 0;
+    inputPtr->end = 0;
+
+    if (!inputPtr->pollable) {
+        size_t const readLength = safeRead(
+            inputPtr->fileDescriptor,
+            inputPtr->buffer,
+            enginePtr->bufferSize,
+            "fillInput"
+        );
+        inputPtr->end = readLength;
+        inputPtr->reachedEnd = readLength == 0;
+        return readLength > 0;
+    }
+
+    // The input was removed from the poller if its buffer filled up; the buffer is empty now
+    if (!inputPtr->watched && !inputPtr->reachedEnd) {
+        pollerTryAdd(enginePtr->poller, inputPtr->fileDescriptor, inputIndex, "fillInput");
+        inputPtr->watched = true;
+    }
+
+    while (inputPtr->start == inputPtr->end && !inputPtr->reachedEnd) {
+        readReadyInputs(enginePtr);
+    }
+    return inputPtr->start < inputPtr->end;
+}
+
+/**
+ * Decode more of the given compressed input into its buffer, whose data has all been consumed, first waiting for more
+ * of the compressed input if everything read from it so far has been decoded. Meanwhile every other pollable input
+ * that becomes readable is read into its buffer.
+ *
+ * @returns True if the input has more data, or false if it has ended.
+ */
+static bool decodeInput(struct PollEngine * const enginePtr, size_t const inputIndex) {
+    struct PolledInput * const inputPtr = &enginePtr->inputs[inputIndex];
+
+    inputPtr->start = 0;
+    inputPtr->end = 0;
+    while (true) {
+        if (inputPtr->compressedStart < inputPtr->compressedEnd) {
+            size_t consumedLength;
+            inputPtr->end = gzipDecoderDecode(
+                inputPtr->decoder,
+                &inputPtr->compressedBuffer[inputPtr->compressedStart],
+                inputPtr->compressedEnd - inputPtr->compressedStart,
+                &consumedLength,
+                inputPtr->buffer,
+                enginePtr->bufferSize,
+                "decodeInput"
+            );
+            inputPtr->compressedStart += consumedLength;
+            if (inputPtr->end > 0) {
+                return true;
+            }
+            continue;
+        }
+
+        if (inputPtr->reachedEnd) {
+            gzipDecoderFinish(inputPtr->decoder, "decodeInput");
+            return false;
+        }
+
+        inputPtr->compressedStart = 0;
+        inputPtr->compressedEnd = 0;
+        if (!inputPtr->pollable) {
+            size_t const readLength = safeRead(
+                inputPtr->fileDescriptor,
+                inputPtr->compressedBuffer,
+                enginePtr->bufferSize,
+                "decodeInput"
+            );
+            inputPtr->compressedEnd = readLength;
+            inputPtr->reachedEnd = readLength == 0;
+            continue;
+        }
+
+        // The input was removed from the poller if its compressed buffer filled up; that buffer is empty now
+        if (!inputPtr->watched) {
+            pollerTryAdd(enginePtr->poller, inputPtr->fileDescriptor, inputIndex, "decodeInput");
+            inputPtr->watched = true;
+        }
+        while (inputPtr->compressedStart == inputPtr->compressedEnd && !inputPtr->reachedEnd) {
+            readReadyInputs(enginePtr);
+        }
+    }
+}
+
+/**
+ * Wait until at least one pollable input is readable, then read every readable input.
+ */
+static void readReadyInputs(struct PollEngine * const enginePtr) {
+    size_t const readyCount = pollerWait(
+        enginePtr->poller,
+        enginePtr->readyInputIndices,
+        enginePtr->readyCapacity,
+        "readReadyInputs"
+    );
+    for (size_t i = 0; i < readyCount; i += 1) {
+        readPolledInput(enginePtr, (size_t)enginePtr->readyInputIndices[i]);
+    }
+}
+
+/**
+ * Read what is available of the given readable input into the free space of its buffer (its compressed buffer, if it is
+ * compressed), first moving its unconsumed bytes to the front of that buffer if there is no space after them. An input
+ * whose buffer is full, or that has ended, is removed from the poller.
+ */
+static void readPolledInput(struct PollEngine * const enginePtr, size_t const inputIndex) {
+    struct PolledInput * const inputPtr = &enginePtr->inputs[inputIndex];
+    size_t const bufferSize = enginePtr->bufferSize;
+
+    bool const compressed = inputPtr->decoder != NULL;
+    char * const buffer = compressed ? inputPtr->compressedBuffer : inputPtr->buffer;
+    size_t * const startPtr = compressed ? &inputPtr->compressedStart : &inputPtr->start;
+    size_t * const endPtr = compressed ? &inputPtr->compressedEnd : &inputPtr->end;
+
+    if (*endPtr == bufferSize && *startPtr > 0) {
+        memmove(buffer, &buffer[*startPtr], *endPtr - *startPtr);
+        *endPtr -= *startPtr;
+        *startPtr = 0;
+    }
+
+    if (*endPtr < bufferSize) {
+        size_t readLength;
+        if (
+            !safeTryRead(
+                inputPtr->fileDescriptor,
+                &buffer[*endPtr],
+                bufferSize - *endPtr,
+                &readLength,
+                inputPtr->inFilePath
+            )
+        ) {
+            return;
+        }
+
+        *endPtr += readLength;
+        inputPtr->reachedEnd = readLength == 0;
+        if (!inputPtr->reachedEnd && *endPtr < bufferSize) {
+            return;
+        }
+    }
+
+    pollerRemove(enginePtr->poller, inputPtr->fileDescriptor, "readPolledInput");
+    inputPtr->watched = false;
+}
+
+/**
+ * Take the next `"%c\n"` record from the given input.
+ *
+ * @returns True if a record was taken, or false if the input has been exhausted.
+ */
+static bool takeCharacter(
+    struct PollEngine * const enginePtr,
+    size_t const inputIndex,
+    char * const characterOutPtr
+) {
+    struct PolledInput * const inputPtr = &enginePtr->inputs[inputIndex];
+    if (!inputPtr->sniffed) {
+        sniffInput(enginePtr, inputIndex);
+    }
+
+    while (!inputPtr->finished) {
+        while (inputPtr->start < inputPtr->end) {
+            char const character = inputPtr->data[inputPtr->start];
+            inputPtr->start += 1;
+
+            if (inputPtr->recordScan.skippingWhitespace && isScanfWhitespace(character)) {
+                continue;
+            }
+
+            inputPtr->recordScan.skippingWhitespace = true;
+            *characterOutPtr = character;
+            return true;
+        }
+
+        inputPtr->finished = !fillInput(enginePtr, inputIndex);
+    }
+
+    return false;
+}
+
+/**
+ * Write the next record of the given input to the output, a piece at a time if it spans refills of the input's buffer.
+ *
+ * @returns True if a record was written, or false if the input has been exhausted.
+ */
+static bool transferRecord(
+    struct PollEngine * const enginePtr,
+    size_t const inputIndex,
+    struct RecordFormat const * const recordFormatPtr,
+    struct BufferedWriter * const outWriter
+) {
+    struct PolledInput * const inputPtr = &enginePtr->inputs[inputIndex];
+    if (!inputPtr->sniffed) {
+        sniffInput(enginePtr, inputIndex);
+    }
+
+    char terminator;
+    while (!inputPtr->finished) {
+        if (inputPtr->start == inputPtr->end) {
+            inputPtr->finished = !fillInput(enginePtr, inputIndex);
+            continue;
+        }
+
+        size_t pieceOffset;
+        size_t pieceLength;
+        bool complete;
+        size_t const scannedLength = scanRecordPiece(
+            recordFormatPtr,
+            &inputPtr->recordScan,
+            &inputPtr->data[inputPtr->start],
+            inputPtr->end - inputPtr->start,
+            &pieceOffset,
+            &pieceLength,
+            &complete
+        );
+        if (pieceLength > 0) {
+            bufferedWriterWrite(
+                outWriter,
+                &inputPtr->data[inputPtr->start + pieceOffset],
+                pieceLength,
+                "transferRecord"
+            );
+        }
+        inputPtr->start += scannedLength;
+
+        if (complete) {
+            if (getRecordTerminator(recordFormatPtr, true, &terminator)) {
+                bufferedWriterWrite(outWriter, &terminator, 1, "transferRecord");
+            }
+            return true;
+        }
+    }
+
+    // The input ended, possibly part way through a record
+    bool const incomplete = inputPtr->recordScan.recordLength > 0;
+    if (incomplete && getRecordTerminator(recordFormatPtr, false, &terminator)) {
+        bufferedWriterWrite(outWriter, &terminator, 1, "transferRecord");
+    }
+    recordScanInit(&inputPtr->recordScan);
+    return incomplete;
+}
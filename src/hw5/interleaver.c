@@ -0,0 +1,402 @@
+#include "../../include/hw5/interleaver.h"
+
+#include "../../include/util/memory.h"
+#include "../../include/util/file.h"
+#include "../../include/util/gzip.h"
+#include "../../include/util/interleave.h"
+#include "../../include/util/record.h"
+#include "../../include/util/schedule.h"
+#include "../../include/util/guard.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+/**
+ * One input and the bytes read from it that have not been consumed yet, which lie at [start, end) of its data. A
+ * regular file's data is its mapping. Any other input, and any gzip-compressed file, is read (and decoded) into a
+ * buffer of its own whenever its data has all been consumed.
+ */
+struct InterleaverInput {
+    char const *inFilePath;
+    bool mapped;
+    struct MappedFile mappedFile;
+    FILE *inFile;
+
+    char *buffer;
+    char const *data;
+    size_t start;
+    size_t end;
+
+    struct RecordScan recordScan;
+    bool finished;
+};
+
+/**
+ * The inputs, and how far the interleaving has got: the slot of the schedule whose record is next (or part way
+ * written), and a terminator still to be written after that slot's record if the caller's buffer filled up before it.
+ */
+struct Hw5Interleaver {
+    struct RecordFormat recordFormat;
+    struct InterleaverInput *inputs;
+    size_t inputCount;
+
+    struct InterleaveSchedule const *schedule;
+    struct InterleaveSchedule *roundRobinSchedule;
+    size_t slot;
+    bool terminatorPending;
+    char terminator;
+
+    size_t roundCount;
+    bool roundHadRecord;
+    bool finished;
+
+    /**
+     * The data of every input, if every input is mapped and holds RECORD_KIND_CHARACTER records taken round robin, so
+     * whole rounds of two-byte records can be interleaved at once. Null otherwise, or once the inputs turn out not to
+     * hold two-byte records.
+     */
+    char const **twoByteInputs;
+};
+
+static size_t const inputBufferSize = 65536;
+
+static bool fillInput(struct InterleaverInput *inputPtr);
+static size_t interleaveTwoByteRounds(struct Hw5Interleaver *interleaver, char *buffer, size_t bufferLength);
+static size_t transferRecord(struct Hw5Interleaver *interleaver, char *buffer, size_t bufferLength);
+static void endRecord(struct Hw5Interleaver *interleaver, bool hadRecord, bool complete);
+static void advanceSlot(struct Hw5Interleaver *interleaver);
+
+/**
+ * Create an interleaver over the given input files, from which the output of hw5 is pulled in batches by
+ * hw5InterleaverRead instead of being written to a file. This lets the interleaving be embedded in another process
+ * with no output file in between.
+ *
+ * The interleaving runs on the calling thread, in hw5InterleaverRead. Regular input files are mapped; every other
+ * input (e.g. a FIFO), and every gzip-compressed input, is read into a buffer of its own as its records are needed.
+ *
+ * @param inFilePaths The input file paths.
+ * @param inFileCount The number of input files.
+ * @param recordFormatPtr How records are read from each input and written to the output, or null for
+ *                        characterRecordFormat().
+ * @param schedulePtr The order in which records are taken from the inputs, which must be for inFileCount inputs, or
+ *                    null to take one record from each input in turn. The schedule must outlive the interleaver.
+ *
+ * @returns The interleaver, which must be destroyed with hw5InterleaverDestroy.
+ */
+struct Hw5Interleaver *hw5InterleaverCreate(
+    char const * const * const inFilePaths,
+    size_t const inFileCount,
+    struct RecordFormat const * const recordFormatPtr,
+    struct InterleaveSchedule const * const schedulePtr
+) {
+    guardNotNull(inFilePaths, "inFilePaths", "hw5InterleaverCreate");
+    guard(
+        schedulePtr == NULL || schedulePtr->inputCount == inFileCount,
+        "hw5InterleaverCreate: The schedule must be for inFileCount inputs"
+    );
+
+    struct Hw5Interleaver * const interleaver = safeMalloc(sizeof *interleaver, "hw5InterleaverCreate");
+    interleaver->recordFormat = recordFormatPtr != NULL ? *recordFormatPtr : characterRecordFormat();
+    interleaver->inputs = safeMalloc(sizeof *interleaver->inputs * inFileCount, "hw5InterleaverCreate");
+    interleaver->inputCount = inFileCount;
+    interleaver->roundRobinSchedule = (
+        schedulePtr == NULL ? interleaveScheduleCreate(inFileCount, "hw5InterleaverCreate") : NULL
+    );
+    interleaver->schedule = schedulePtr != NULL ? schedulePtr : interleaver->roundRobinSchedule;
+    interleaver->slot = 0;
+    interleaver->terminatorPending = false;
+    interleaver->terminator = '\0';
+    interleaver->roundCount = 0;
+    interleaver->roundHadRecord = false;
+    interleaver->finished = inFileCount == 0;
+
+    bool allMapped = true;
+    for (size_t i = 0; i < inFileCount; i += 1) {
+        struct InterleaverInput * const inputPtr = &interleaver->inputs[i];
+
+        inputPtr->inFilePath = inFilePaths[i];
+        recordScanInit(&inputPtr->recordScan);
+        inputPtr->finished = false;
+        inputPtr->start = 0;
+
+        inputPtr->mapped = tryMapFile(inFilePaths[i], &inputPtr->mappedFile, "hw5InterleaverCreate");
+        if (inputPtr->mapped && hasGzipMagic(inputPtr->mappedFile.data, inputPtr->mappedFile.length)) {
+            unmapFile(&inputPtr->mappedFile, "hw5InterleaverCreate");
+            inputPtr->mapped = false;
+        }
+        if (inputPtr->mapped) {
+            inputPtr->inFile = NULL;
+            inputPtr->buffer = NULL;
+            inputPtr->data = inputPtr->mappedFile.data;
+            inputPtr->end = inputPtr->mappedFile.length;
+            continue;
+        }
+
+        allMapped = false;
+        inputPtr->inFile = safeFopenDecoded(inFilePaths[i], "hw5InterleaverCreate");
+        inputPtr->buffer = safeMalloc(sizeof *inputPtr->buffer * inputBufferSize, "hw5InterleaverCreate");
+        inputPtr->data = inputPtr->buffer;
+        inputPtr->end = 0;
+    }
+
+    interleaver->twoByteInputs = NULL;
+    bool const roundRobin = interleaver->schedule->roundRobin;
+    if (allMapped && roundRobin && inFileCount > 0 && interleaver->recordFormat.kind == RECORD_KIND_CHARACTER) {
+        interleaver->twoByteInputs = safeMalloc(
+            sizeof *interleaver->twoByteInputs * inFileCount,
+            "hw5InterleaverCreate"
+        );
+        for (size_t i = 0; i < inFileCount; i += 1) {
+            interleaver->twoByteInputs[i] = interleaver->inputs[i].mappedFile.data;
+        }
+    }
+
+    return interleaver;
+}
+
+/**
+ * Pull the next bytes of the output into the given buffer: records in the order of the schedule, byte for byte what
+ * hw5 would write to its output file. The buffer is filled as far as the output allows, so a record may be
+ * split between consecutive calls.
+ *
+ * @param interleaver The interleaver.
+ * @param buffer The buffer into which to write.
+ * @param bufferLength The number of bytes the buffer holds. Must be positive.
+ *
+ * @returns The number of bytes written, which is less than bufferLength only at the end of the output, and 0 once the
+ *          output has all been read.
+ */
+size_t hw5InterleaverRead(struct Hw5Interleaver * const interleaver, char * const buffer, size_t const bufferLength) {
+    guardNotNull(interleaver, "interleaver", "hw5InterleaverRead");
+    guardNotNull(buffer, "buffer", "hw5InterleaverRead");
+    guard(bufferLength > 0, "hw5InterleaverRead: bufferLength must be positive");
+
+    size_t length = 0;
+    while (length < bufferLength && !interleaver->finished) {
+        if (interleaver->terminatorPending) {
+            buffer[length] = interleaver->terminator;
+            length += 1;
+            interleaver->terminatorPending = false;
+            advanceSlot(interleaver);
+            continue;
+        }
+
+        if (interleaver->twoByteInputs != NULL && interleaver->slot == 0) {
+            size_t const interleavedLength = interleaveTwoByteRounds(
+                interleaver,
+                &buffer[length],
+                bufferLength - length
+            );
+            if (interleavedLength > 0) {
+                length += interleavedLength;
+                continue;
+            }
+        }
+
+        length += transferRecord(interleaver, &buffer[length], bufferLength - length);
+    }
+
+    return length;
+}
+
+/**
+ * Destroy the given interleaver, whether or not its output has all been read.
+ *
+ * @param interleaver The interleaver.
+ */
+void hw5InterleaverDestroy(struct Hw5Interleaver * const interleaver) {
+    guardNotNull(interleaver, "interleaver", "hw5InterleaverDestroy");
+
+    for (size_t i = 0; i < interleaver->inputCount; i += 1) {
+        struct InterleaverInput * const inputPtr = &interleaver->inputs[i];
+
+        if (inputPtr->mapped) {
+            unmapFile(&inputPtr->mappedFile, "hw5InterleaverDestroy");
+            continue;
+        }
+
+        fclose(inputPtr->inFile);
+        free(inputPtr->buffer);
+    }
+    if (interleaver->roundRobinSchedule != NULL) {
+        interleaveScheduleDestroy(interleaver->roundRobinSchedule);
+    }
+    free(interleaver->twoByteInputs);
+    free(interleaver->inputs);
+    free(interleaver);
+}
+
+/**
+ * Read the next bytes of the given input, whose data has all been consumed, into its buffer.
+ *
+ * @returns True if the input has more data, or false if it has ended.
+ */
+static bool fillInput(struct InterleaverInput * const inputPtr) {
+    assert(inputPtr->start == inputPtr->end);
+
+    if (inputPtr->mapped) {
+        return false;
+    }
+
+    size_t const readLength = safeFread(inputPtr->buffer, 1, inputBufferSize, inputPtr->inFile, inputPtr->inFilePath);
+    inputPtr->start = 0;
+    inputPtr->end = readLength;
+    return readLength > 0;
+}
+
+/**
+ * Interleave as many whole rounds of two-byte records (see isTwoByteCharacterRecordLayout) as fit in the given buffer,
+ * starting at a round boundary. Once the records of the next rounds turn out not to be two-byte records, or an earlier
+ * record was not, every later round is left to transferRecord.
+ *
+ * @returns The number of bytes written, or 0 if no whole round could be interleaved.
+ */
+static size_t interleaveTwoByteRounds(
+    struct Hw5Interleaver * const interleaver,
+    char * const buffer,
+    size_t const bufferLength
+) {
+    assert(interleaver->slot == 0);
+    assert(!interleaver->terminatorPending);
+
+    size_t const inputCount = interleaver->inputCount;
+    size_t const startRound = interleaver->roundCount;
+
+    size_t endRound = SIZE_MAX;
+    for (size_t i = 0; i < inputCount; i += 1) {
+        struct InterleaverInput const * const inputPtr = &interleaver->inputs[i];
+        if (inputPtr->start != startRound * 2) {
+            free(interleaver->twoByteInputs);
+            interleaver->twoByteInputs = NULL;
+            return 0;
+        }
+
+        size_t const recordCount = inputPtr->end / 2;
+        if (recordCount < endRound) {
+            endRound = recordCount;
+        }
+    }
+
+    size_t const roundSize = inputCount * 2;
+    size_t roundCount = bufferLength / roundSize;
+    if (endRound <= startRound || roundCount == 0) {
+        return 0;
+    }
+    if (roundCount > endRound - startRound) {
+        roundCount = endRound - startRound;
+    }
+
+    for (size_t i = 0; i < inputCount; i += 1) {
+        if (!isTwoByteCharacterRecordLayout(&interleaver->twoByteInputs[i][startRound * 2], roundCount * 2)) {
+            free(interleaver->twoByteInputs);
+            interleaver->twoByteInputs = NULL;
+            return 0;
+        }
+    }
+
+    interleaveTwoByteRecords(interleaver->twoByteInputs, inputCount, startRound, roundCount, buffer);
+
+    // Having consumed "X\n" records, each parse resumes at the next record while skipping whitespace
+    for (size_t i = 0; i < inputCount; i += 1) {
+        struct InterleaverInput * const inputPtr = &interleaver->inputs[i];
+        inputPtr->start += roundCount * 2;
+        inputPtr->recordScan.skippingWhitespace = true;
+    }
+    interleaver->roundCount += roundCount;
+    return roundCount * roundSize;
+}
+
+/**
+ * Write what fits in the given buffer of the next record of the current slot's input, moving on to the next slot once
+ * the record has been written (but for its terminator, if the buffer filled up first) or the input turns out to have
+ * ended.
+ *
+ * @returns The number of bytes written.
+ */
+static size_t transferRecord(
+    struct Hw5Interleaver * const interleaver,
+    char * const buffer,
+    size_t const bufferLength
+) {
+    struct InterleaverInput * const inputPtr = &interleaver->inputs[interleaver->schedule->slots[interleaver->slot]];
+
+    size_t length = 0;
+    while (length < bufferLength) {
+        if (inputPtr->start == inputPtr->end) {
+            if (!inputPtr->finished) {
+                inputPtr->finished = !fillInput(inputPtr);
+                continue;
+            }
+
+            // The input ended, possibly part way through a record
+            bool const incomplete = inputPtr->recordScan.recordLength > 0;
+            recordScanInit(&inputPtr->recordScan);
+            endRecord(interleaver, incomplete, false);
+            return length;
+        }
+
+        // No more is scanned than fits, so the piece always fits
+        size_t const availableLength = inputPtr->end - inputPtr->start;
+        size_t const remainingLength = bufferLength - length;
+        size_t pieceOffset;
+        size_t pieceLength;
+        bool complete;
+        size_t const scannedLength = scanRecordPiece(
+            &interleaver->recordFormat,
+            &inputPtr->recordScan,
+            &inputPtr->data[inputPtr->start],
+            availableLength < remainingLength ? availableLength : remainingLength,
+            &pieceOffset,
+            &pieceLength,
+            &complete
+        );
+        memcpy(&buffer[length], &inputPtr->data[inputPtr->start + pieceOffset], pieceLength);
+        length += pieceLength;
+        inputPtr->start += scannedLength;
+
+        if (complete) {
+            endRecord(interleaver, true, true);
+            return length;
+        }
+    }
+
+    return length;
+}
+
+/**
+ * Finish the current slot's turn in the round, leaving its record's terminator (if any) pending.
+ */
+static void endRecord(struct Hw5Interleaver * const interleaver, bool const hadRecord, bool const complete) {
+    if (hadRecord) {
+        interleaver->roundHadRecord = true;
+        interleaver->terminatorPending = getRecordTerminator(
+            &interleaver->recordFormat,
+            complete,
+            &interleaver->terminator
+        );
+        if (interleaver->terminatorPending) {
+            return;
+        }
+    }
+
+    advanceSlot(interleaver);
+}
+
+/**
+ * Move on to the next slot, finishing the output after a round in which no input had a record.
+ */
+static void advanceSlot(struct Hw5Interleaver * const interleaver) {
+    interleaver->slot += 1;
+    if (interleaver->slot < interleaver->schedule->slotCount) {
+        return;
+    }
+
+    interleaver->slot = 0;
+    interleaver->finished = !interleaver->roundHadRecord;
+    interleaver->roundHadRecord = false;
+    interleaver->roundCount += 1;
+}
@@ -0,0 +1,503 @@
+#include "../../include/hw5/partitioned.h"
+
+#include "../../include/util/memory.h"
+#include "../../include/util/thread.h"
+#include "../../include/util/file.h"
+#include "../../include/util/interleave.h"
+#include "../../include/util/guard.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <assert.h>
+
+/**
+ * A mapped input and its record-count index: the number of records that start before each fixed-size block. This is
+ * enough to find the byte position of any record by scanning at most one block.
+ */
+struct IndexedInput {
+    struct MappedFile mappedFile;
+
+    size_t blockCount;
+    size_t *recordCountBeforeBlock; // blockCount + 1 entries; the last is the input's record count
+};
+
+struct CountBlockTask {
+    size_t inputIndex;
+    size_t blockIndex;
+};
+
+struct CountRecordsThreadStartArg {
+    struct IndexedInput *indexedInputs;
+    struct CountBlockTask const *tasks;
+    size_t taskCount;
+    atomic_size_t *nextTaskIndexPtr;
+};
+
+/**
+ * The output layout implied by the record counts. Round r contains one record from every input with more than r
+ * records, so the output offset of round r is 2 * sum(min(count_i, r)), computed from the sorted counts and their
+ * prefix sums.
+ */
+struct RoundLayout {
+    size_t inputCount;
+    size_t const *recordCounts;   // By input index
+    size_t *sortedRecordCounts;   // Ascending
+    size_t *sortedRecordCountSums; // inputCount + 1 entries; sortedRecordCountSums[j] = sum(sortedRecordCounts[0..j))
+    size_t roundCount;
+};
+
+struct WritePartitionThreadStartArg {
+    struct IndexedInput const *indexedInputs;
+    struct RoundLayout const *layout;
+    size_t firstRound;
+    size_t endRound;
+
+    int outFileDescriptor;
+};
+
+static size_t const indexBlockSize = 1048576;
+static size_t const partitionChunkSize = 1048576;
+
+static void indexInputs(
+    struct IndexedInput *indexedInputs,
+    size_t inputCount,
+    size_t threadCount,
+    struct ThreadSettings const *threadSettingsPtr
+);
+static void *countRecordsThreadStart(void * const argAsVoidPtr);
+
+static void initRoundLayout(struct RoundLayout *layoutOutPtr, size_t const *recordCounts, size_t inputCount);
+static void destroyRoundLayout(struct RoundLayout *layoutPtr);
+static size_t getRoundOffset(struct RoundLayout const *layoutPtr, size_t round);
+static size_t findRoundAtOffset(struct RoundLayout const *layoutPtr, size_t offset);
+static int compareSizes(void const *aPtr, void const *bPtr);
+
+static size_t findRecordPosition(struct IndexedInput const *indexedInputPtr, size_t record);
+static void *writePartitionThreadStart(void * const argAsVoidPtr);
+
+/**
+ * Run HW5 by splitting the output into contiguous ranges of rounds, one per worker thread, which each interleave their
+ * range independently and pwrite it straight into a pre-sized output file.
+ *
+ * Output offsets depend on how many records each input has, so a parallel counting pass first builds a record-count
+ * index of every input. From the counts, the offset of any round follows from a prefix sum, which lets the rounds be
+ * split into ranges of equal output size even when input lengths are heavily skewed. Within a range, runs of rounds
+ * whose records are verified to be in the canonical two-byte layout are written with the vectorized interleave kernel.
+ *
+ * @param inFilePaths The input file paths.
+ * @param inFileCount The number of input files.
+ * @param outFilePath The output file path.
+ * @param workerCount The number of worker threads, or 0 for one per online processor.
+ * @param threadSettingsPtr The stack size and processors of the worker threads, or null to use the defaults. Each
+ *                          worker is pinned to one of the processors, taking them in turn.
+ *
+ * @returns True if the output was written, or false if some input is not a regular file (and so cannot be indexed).
+ */
+bool hw5Partitioned(
+    char const * const * const inFilePaths,
+    size_t const inFileCount,
+    char const * const outFilePath,
+    size_t const workerCount,
+    struct ThreadSettings const * const threadSettingsPtr
+) {
+    guardNotNull(inFilePaths, "inFilePaths", "hw5Partitioned");
+    guardNotNull(outFilePath, "outFilePath", "hw5Partitioned");
+
+    struct IndexedInput * const indexedInputs = safeMalloc(sizeof *indexedInputs * inFileCount, "hw5Partitioned");
+    for (size_t i = 0; i < inFileCount; i += 1) {
+        if (!tryMapFile(inFilePaths[i], &indexedInputs[i].mappedFile, "hw5Partitioned")) {
+            for (size_t j = 0; j < i; j += 1) {
+                unmapFile(&indexedInputs[j].mappedFile, "hw5Partitioned");
+            }
+            free(indexedInputs);
+            return false;
+        }
+    }
+
+    size_t const threadCount = workerCount > 0 ? workerCount : getOnlineProcessorCount();
+    indexInputs(indexedInputs, inFileCount, threadCount, threadSettingsPtr);
+
+    size_t * const recordCounts = safeMalloc(sizeof *recordCounts * inFileCount, "hw5Partitioned");
+    for (size_t i = 0; i < inFileCount; i += 1) {
+        recordCounts[i] = indexedInputs[i].recordCountBeforeBlock[indexedInputs[i].blockCount];
+    }
+
+    struct RoundLayout layout;
+    initRoundLayout(&layout, recordCounts, inFileCount);
+    size_t const outFileLength = getRoundOffset(&layout, layout.roundCount);
+
+    int const outFileDescriptor = safeOpen(outFilePath, O_WRONLY | O_CREAT | O_TRUNC, 0666, "hw5Partitioned");
+    safeFtruncate(outFileDescriptor, outFileLength, "hw5Partitioned");
+
+    size_t const writeThreadCount = (
+        layout.roundCount == 0 ? 0 : threadCount < layout.roundCount ? threadCount : layout.roundCount
+    );
+    struct Arena * const scratchArena = getThreadScratchArena("hw5Partitioned");
+    struct ArenaMark const scratchMark = arenaGetMark(scratchArena);
+    struct WritePartitionThreadStartArg * const threadStartArgs = arenaAlloc(
+        scratchArena,
+        sizeof *threadStartArgs * (writeThreadCount + 1),
+        "hw5Partitioned"
+    );
+    pthread_t * const threadIds = arenaAlloc(
+        scratchArena,
+        sizeof *threadIds * (writeThreadCount + 1),
+        "hw5Partitioned"
+    );
+    for (size_t t = 0; t < writeThreadCount; t += 1) {
+        struct WritePartitionThreadStartArg * const threadStartArgPtr = &threadStartArgs[t];
+
+        // Split by output size rather than round count, since later rounds of skewed inputs hold fewer records
+        threadStartArgPtr->indexedInputs = indexedInputs;
+        threadStartArgPtr->layout = &layout;
+        threadStartArgPtr->firstRound = findRoundAtOffset(&layout, outFileLength / writeThreadCount * t);
+        threadStartArgPtr->endRound = (
+            t + 1 == writeThreadCount
+                ? layout.roundCount
+                : findRoundAtOffset(&layout, outFileLength / writeThreadCount * (t + 1))
+        );
+        threadStartArgPtr->outFileDescriptor = outFileDescriptor;
+
+        struct ThreadSettings const threadSettings = spreadThreadSettings(threadSettingsPtr, t);
+        threadIds[t] = safePthreadCreate(
+            &threadSettings,
+            writePartitionThreadStart,
+            threadStartArgPtr,
+            "hw5Partitioned"
+        );
+    }
+
+    for (size_t t = 0; t < writeThreadCount; t += 1) {
+        safePthreadJoin(threadIds[t], "hw5Partitioned");
+    }
+
+    arenaResetToMark(scratchArena, scratchMark);
+
+    safeClose(outFileDescriptor, "hw5Partitioned");
+
+    destroyRoundLayout(&layout);
+    free(recordCounts);
+    for (size_t i = 0; i < inFileCount; i += 1) {
+        unmapFile(&indexedInputs[i].mappedFile, "hw5Partitioned");
+        free(indexedInputs[i].recordCountBeforeBlock);
+    }
+    free(indexedInputs);
+
+    return true;
+}
+
+/**
+ * Build the record-count index of every input, counting blocks in parallel across all inputs so that one long input
+ * is spread over every thread.
+ */
+static void indexInputs(
+    struct IndexedInput * const indexedInputs,
+    size_t const inputCount,
+    size_t const threadCount,
+    struct ThreadSettings const * const threadSettingsPtr
+) {
+    size_t taskCount = 0;
+    for (size_t i = 0; i < inputCount; i += 1) {
+        struct IndexedInput * const indexedInputPtr = &indexedInputs[i];
+
+        indexedInputPtr->blockCount = (indexedInputPtr->mappedFile.length + indexBlockSize - 1) / indexBlockSize;
+        indexedInputPtr->recordCountBeforeBlock = safeMalloc(
+            sizeof *indexedInputPtr->recordCountBeforeBlock * (indexedInputPtr->blockCount + 1),
+            "indexInputs"
+        );
+        taskCount += indexedInputPtr->blockCount;
+    }
+
+    struct Arena * const scratchArena = getThreadScratchArena("indexInputs");
+    struct ArenaMark const scratchMark = arenaGetMark(scratchArena);
+    struct CountBlockTask * const tasks = arenaAlloc(scratchArena, sizeof *tasks * (taskCount + 1), "indexInputs");
+    size_t taskIndex = 0;
+    for (size_t i = 0; i < inputCount; i += 1) {
+        for (size_t b = 0; b < indexedInputs[i].blockCount; b += 1) {
+            tasks[taskIndex].inputIndex = i;
+            tasks[taskIndex].blockIndex = b;
+            taskIndex += 1;
+        }
+    }
+
+    atomic_size_t nextTaskIndex;
+    atomic_init(&nextTaskIndex, 0);
+
+    struct CountRecordsThreadStartArg threadStartArg = {
+        .indexedInputs = indexedInputs,
+        .tasks = tasks,
+        .taskCount = taskCount,
+        .nextTaskIndexPtr = &nextTaskIndex
+    };
+
+    size_t const countThreadCount = threadCount < taskCount ? threadCount : taskCount;
+    pthread_t * const threadIds = arenaAlloc(scratchArena, sizeof *threadIds * (countThreadCount + 1), "indexInputs");
+    for (size_t t = 0; t < countThreadCount; t += 1) {
+        struct ThreadSettings const threadSettings = spreadThreadSettings(threadSettingsPtr, t);
+        threadIds[t] = safePthreadCreate(&threadSettings, countRecordsThreadStart, &threadStartArg, "indexInputs");
+    }
+    for (size_t t = 0; t < countThreadCount; t += 1) {
+        safePthreadJoin(threadIds[t], "indexInputs");
+    }
+    arenaResetToMark(scratchArena, scratchMark);
+
+    // The threads stored per-block counts one entry ahead; turn them into prefix sums
+    for (size_t i = 0; i < inputCount; i += 1) {
+        struct IndexedInput * const indexedInputPtr = &indexedInputs[i];
+
+        indexedInputPtr->recordCountBeforeBlock[0] = 0;
+        for (size_t b = 1; b <= indexedInputPtr->blockCount; b += 1) {
+            indexedInputPtr->recordCountBeforeBlock[b] += indexedInputPtr->recordCountBeforeBlock[b - 1];
+        }
+    }
+}
+
+static void *countRecordsThreadStart(void * const argAsVoidPtr) {
+    assert(argAsVoidPtr != NULL);
+    struct CountRecordsThreadStartArg const * const argPtr = argAsVoidPtr;
+
+    while (true) {
+        size_t const taskIndex = atomic_fetch_add_explicit(argPtr->nextTaskIndexPtr, 1, memory_order_relaxed);
+        if (taskIndex >= argPtr->taskCount) {
+            break;
+        }
+
+        struct CountBlockTask const * const taskPtr = &argPtr->tasks[taskIndex];
+        struct IndexedInput * const indexedInputPtr = &argPtr->indexedInputs[taskPtr->inputIndex];
+
+        size_t const blockStart = taskPtr->blockIndex * indexBlockSize;
+        size_t const remainingLength = indexedInputPtr->mappedFile.length - blockStart;
+        indexedInputPtr->recordCountBeforeBlock[taskPtr->blockIndex + 1] = countCharacterRecords(
+            &indexedInputPtr->mappedFile.data[blockStart],
+            remainingLength < indexBlockSize ? remainingLength : indexBlockSize,
+            taskPtr->blockIndex == 0
+        );
+    }
+
+    return NULL;
+}
+
+static void initRoundLayout(
+    struct RoundLayout * const layoutOutPtr,
+    size_t const * const recordCounts,
+    size_t const inputCount
+) {
+    size_t * const sortedRecordCounts = safeMalloc(sizeof *sortedRecordCounts * (inputCount + 1), "initRoundLayout");
+    memcpy(sortedRecordCounts, recordCounts, sizeof *sortedRecordCounts * inputCount);
+    qsort(sortedRecordCounts, inputCount, sizeof *sortedRecordCounts, compareSizes);
+
+    size_t * const sortedRecordCountSums = safeMalloc(
+        sizeof *sortedRecordCountSums * (inputCount + 1),
+        "initRoundLayout"
+    );
+    sortedRecordCountSums[0] = 0;
+    for (size_t j = 0; j < inputCount; j += 1) {
+        sortedRecordCountSums[j + 1] = sortedRecordCountSums[j] + sortedRecordCounts[j];
+    }
+
+    layoutOutPtr->inputCount = inputCount;
+    layoutOutPtr->recordCounts = recordCounts;
+    layoutOutPtr->sortedRecordCounts = sortedRecordCounts;
+    layoutOutPtr->sortedRecordCountSums = sortedRecordCountSums;
+    layoutOutPtr->roundCount = inputCount > 0 ? sortedRecordCounts[inputCount - 1] : 0;
+}
+
+static void destroyRoundLayout(struct RoundLayout * const layoutPtr) {
+    free(layoutPtr->sortedRecordCounts);
+    free(layoutPtr->sortedRecordCountSums);
+}
+
+/**
+ * Get the output byte offset at which the given round starts.
+ */
+static size_t getRoundOffset(struct RoundLayout const * const layoutPtr, size_t const round) {
+    // Find the number of inputs with fewer than `round` records; each contributes all of its records
+    size_t low = 0;
+    size_t high = layoutPtr->inputCount;
+    while (low < high) {
+        size_t const middle = low + (high - low) / 2;
+        if (layoutPtr->sortedRecordCounts[middle] < round) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    size_t const recordCount = layoutPtr->sortedRecordCountSums[low] + round * (layoutPtr->inputCount - low);
+    return recordCount * 2;
+}
+
+/**
+ * Find the first round whose start offset is at least the given output byte offset.
+ */
+static size_t findRoundAtOffset(struct RoundLayout const * const layoutPtr, size_t const offset) {
+    size_t low = 0;
+    size_t high = layoutPtr->roundCount;
+    while (low < high) {
+        size_t const middle = low + (high - low) / 2;
+        if (getRoundOffset(layoutPtr, middle) < offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static int compareSizes(void const * const aPtr, void const * const bPtr) {
+    size_t const a = *(size_t const *)aPtr;
+    size_t const b = *(size_t const *)bPtr;
+    return (a > b) - (a < b);
+}
+
+/**
+ * Find the byte position at which the given record of the given input starts, using the record-count index to skip to
+ * the block that contains it.
+ */
+static size_t findRecordPosition(struct IndexedInput const * const indexedInputPtr, size_t const record) {
+    size_t const * const recordCountBeforeBlock = indexedInputPtr->recordCountBeforeBlock;
+
+    // Find the last block that starts with no more than `record` records before it
+    size_t low = 0;
+    size_t high = indexedInputPtr->blockCount - 1;
+    while (low < high) {
+        size_t const middle = low + (high - low + 1) / 2;
+        if (recordCountBeforeBlock[middle] <= record) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    char const * const data = indexedInputPtr->mappedFile.data;
+    size_t remainingRecordCount = record - recordCountBeforeBlock[low];
+    size_t position = low * indexBlockSize;
+    while (position == 0 ? false : isScanfWhitespace(data[position])) {
+        position += 1;
+    }
+    while (remainingRecordCount > 0) {
+        position += 1;
+        while (isScanfWhitespace(data[position])) {
+            position += 1;
+        }
+        remainingRecordCount -= 1;
+    }
+    return position;
+}
+
+static void *writePartitionThreadStart(void * const argAsVoidPtr) {
+    assert(argAsVoidPtr != NULL);
+    struct WritePartitionThreadStartArg const * const argPtr = argAsVoidPtr;
+    struct RoundLayout const * const layoutPtr = argPtr->layout;
+    size_t const inputCount = layoutPtr->inputCount;
+
+    // The inputs that still have records in the current round, in input order, and the position of each one's next
+    // record
+    size_t * const activeInputIndexes = safeMalloc(
+        sizeof *activeInputIndexes * (inputCount + 1),
+        "writePartitionThreadStart"
+    );
+    size_t * const positions = safeMalloc(sizeof *positions * (inputCount + 1), "writePartitionThreadStart");
+    char const ** const activeInputs = safeMalloc(sizeof *activeInputs * (inputCount + 1), "writePartitionThreadStart");
+    size_t const chunkCapacity = inputCount * 2 > partitionChunkSize ? inputCount * 2 : partitionChunkSize;
+    char * const chunk = safeMalloc(sizeof *chunk * chunkCapacity, "writePartitionThreadStart");
+
+    size_t activeInputCount = 0;
+    for (size_t i = 0; i < inputCount; i += 1) {
+        if (layoutPtr->recordCounts[i] > argPtr->firstRound) {
+            activeInputIndexes[activeInputCount] = i;
+            positions[activeInputCount] = findRecordPosition(&argPtr->indexedInputs[i], argPtr->firstRound);
+            activeInputCount += 1;
+        }
+    }
+
+    size_t chunkOffset = getRoundOffset(layoutPtr, argPtr->firstRound);
+    size_t chunkLength = 0;
+
+    size_t round = argPtr->firstRound;
+    while (round < argPtr->endRound) {
+        // Rounds until the next input runs out, during which the set of active inputs is fixed
+        size_t stableEndRound = argPtr->endRound;
+        for (size_t a = 0; a < activeInputCount; a += 1) {
+            size_t const recordCount = layoutPtr->recordCounts[activeInputIndexes[a]];
+            if (recordCount < stableEndRound) {
+                stableEndRound = recordCount;
+            }
+        }
+
+        size_t const roundSize = activeInputCount * 2;
+        while (round < stableEndRound) {
+            if (chunkCapacity - chunkLength < roundSize) {
+                safePwrite(argPtr->outFileDescriptor, chunk, chunkLength, chunkOffset, "writePartitionThreadStart");
+                chunkOffset += chunkLength;
+                chunkLength = 0;
+            }
+
+            size_t const fittingRoundCount = (chunkCapacity - chunkLength) / roundSize;
+            size_t const stepRoundCount = (
+                stableEndRound - round < fittingRoundCount ? stableEndRound - round : fittingRoundCount
+            );
+
+            // Use the vectorized kernel if this run of records is in the canonical two-byte layout in every input
+            bool verified = true;
+            for (size_t a = 0; a < activeInputCount && verified; a += 1) {
+                activeInputs[a] = &argPtr->indexedInputs[activeInputIndexes[a]].mappedFile.data[positions[a]];
+                verified = isTwoByteCharacterRecordLayout(activeInputs[a], stepRoundCount * 2);
+            }
+
+            if (verified) {
+                interleaveTwoByteRecords(activeInputs, activeInputCount, 0, stepRoundCount, &chunk[chunkLength]);
+                chunkLength += stepRoundCount * roundSize;
+                for (size_t a = 0; a < activeInputCount; a += 1) {
+                    positions[a] += stepRoundCount * 2;
+                }
+                round += stepRoundCount;
+                continue;
+            }
+
+            for (size_t r = 0; r < stepRoundCount; r += 1) {
+                for (size_t a = 0; a < activeInputCount; a += 1) {
+                    struct IndexedInput const * const indexedInputPtr = &argPtr->indexedInputs[activeInputIndexes[a]];
+                    char const * const data = indexedInputPtr->mappedFile.data;
+                    size_t const length = indexedInputPtr->mappedFile.length;
+
+                    size_t position = positions[a];
+                    chunk[chunkLength] = data[position];
+                    chunk[chunkLength + 1] = '\n';
+                    chunkLength += 2;
+
+                    position += 1;
+                    while (position < length && isScanfWhitespace(data[position])) {
+                        position += 1;
+                    }
+                    positions[a] = position;
+                }
+            }
+            round += stepRoundCount;
+        }
+
+        // Drop the inputs that ran out
+        size_t keptInputCount = 0;
+        for (size_t a = 0; a < activeInputCount; a += 1) {
+            if (layoutPtr->recordCounts[activeInputIndexes[a]] > round) {
+                activeInputIndexes[keptInputCount] = activeInputIndexes[a];
+                positions[keptInputCount] = positions[a];
+                keptInputCount += 1;
+            }
+        }
+        activeInputCount = keptInputCount;
+    }
+
+    safePwrite(argPtr->outFileDescriptor, chunk, chunkLength, chunkOffset, "writePartitionThreadStart");
+
+    free(activeInputIndexes);
+    free(positions);
+    free(activeInputs);
+    free(chunk);
+
+    return NULL;
+}
@@ -0,0 +1,307 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/hw5/stats.h"
+
+#include "../../include/util/memory.h"
+#include "../../include/util/thread.h"
+#include "../../include/util/file.h"
+#include "../../include/util/string.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <stdio.h>
+#include <signal.h>
+#include <pthread.h>
+#include <assert.h>
+
+/**
+ * A thread that writes the statistics as JSON whenever the process receives SIGUSR1. SIGUSR1 is blocked in the thread
+ * that starts the reporter (and so in every thread it starts afterward) and taken synchronously by the reporter using
+ * sigwait, so no work happens in a signal handler.
+ */
+struct Hw5StatsReporter {
+    struct Hw5Stats const *stats;
+    FILE *file;
+
+    pthread_t threadId;
+    sigset_t previousSignalMask;
+    atomic_bool stopping;
+};
+
+static void appendThreadStatsJson(
+    struct StringBuilder *json,
+    uint64_t recordCount,
+    uint64_t byteCount,
+    uint64_t waitCount,
+    uint64_t blockedNanoseconds,
+    uint64_t ioNanoseconds,
+    char const *callerDescription
+);
+static void *hw5StatsReporterThreadStart(void *argAsVoidPtr);
+static void getReportSignalSet(sigset_t *signalSetOutPtr);
+
+/**
+ * Create zeroed statistics for a run. If the operation fails, abort the program with an error message.
+ *
+ * @param readerCount The number of readers (one per input file).
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The statistics. The caller is responsible for destroying them using hw5StatsDestroy.
+ */
+struct Hw5Stats *hw5StatsCreate(size_t const readerCount, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "hw5StatsCreate");
+
+    struct Hw5Stats * const stats = safeAlignedMalloc(CACHE_LINE_SIZE, sizeof *stats, callerDescription);
+    threadStatsInit(&stats->writer);
+    stats->readers = safeAlignedMalloc(
+        CACHE_LINE_SIZE,
+        sizeof *stats->readers * (readerCount > 0 ? readerCount : 1),
+        callerDescription
+    );
+    stats->readerCount = readerCount;
+    for (size_t i = 0; i < readerCount; i += 1) {
+        threadStatsInit(&stats->readers[i]);
+    }
+
+    return stats;
+}
+
+/**
+ * Write the current statistics as a single line of JSON: the writer's counters, the sum of the readers' counters, and
+ * each reader's counters in input order. Counters may be read while the run is in progress, in which case each is
+ * individually up to date but they are not a consistent snapshot. If the operation fails, abort the program with an
+ * error message.
+ *
+ * @param stats The statistics.
+ * @param final Whether the run has finished.
+ * @param file The file to write to.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void hw5StatsWriteJson(
+    struct Hw5Stats const * const stats,
+    bool const final,
+    FILE * const file,
+    char const * const callerDescription
+) {
+    guardNotNull(stats, "stats", "hw5StatsWriteJson");
+    guardNotNull(file, "file", "hw5StatsWriteJson");
+    guardNotNull(callerDescription, "callerDescription", "hw5StatsWriteJson");
+
+    // Assembled in full and written at once, so a concurrent report never interleaves with this one mid-line
+    struct StringBuilder json;
+    stringBuilderInit(&json);
+
+    stringBuilderAppendString(&json, "{\"final\":", callerDescription);
+    stringBuilderAppendString(&json, final ? "true" : "false", callerDescription);
+    stringBuilderAppendString(&json, ",\"writer\":", callerDescription);
+    appendThreadStatsJson(
+        &json,
+        atomic_load_explicit(&stats->writer.recordCount, memory_order_relaxed),
+        atomic_load_explicit(&stats->writer.byteCount, memory_order_relaxed),
+        atomic_load_explicit(&stats->writer.waitCount, memory_order_relaxed),
+        atomic_load_explicit(&stats->writer.blockedNanoseconds, memory_order_relaxed),
+        atomic_load_explicit(&stats->writer.ioNanoseconds, memory_order_relaxed),
+        callerDescription
+    );
+
+    uint64_t totalRecordCount = 0;
+    uint64_t totalByteCount = 0;
+    uint64_t totalWaitCount = 0;
+    uint64_t totalBlockedNanoseconds = 0;
+    uint64_t totalIoNanoseconds = 0;
+    for (size_t i = 0; i < stats->readerCount; i += 1) {
+        struct ThreadStats const * const readerStats = &stats->readers[i];
+        totalRecordCount += atomic_load_explicit(&readerStats->recordCount, memory_order_relaxed);
+        totalByteCount += atomic_load_explicit(&readerStats->byteCount, memory_order_relaxed);
+        totalWaitCount += atomic_load_explicit(&readerStats->waitCount, memory_order_relaxed);
+        totalBlockedNanoseconds += atomic_load_explicit(&readerStats->blockedNanoseconds, memory_order_relaxed);
+        totalIoNanoseconds += atomic_load_explicit(&readerStats->ioNanoseconds, memory_order_relaxed);
+    }
+    stringBuilderAppendString(&json, ",\"readersTotal\":", callerDescription);
+    appendThreadStatsJson(
+        &json,
+        totalRecordCount,
+        totalByteCount,
+        totalWaitCount,
+        totalBlockedNanoseconds,
+        totalIoNanoseconds,
+        callerDescription
+    );
+
+    stringBuilderAppendString(&json, ",\"readers\":[", callerDescription);
+    for (size_t i = 0; i < stats->readerCount; i += 1) {
+        struct ThreadStats const * const readerStats = &stats->readers[i];
+        if (i > 0) {
+            stringBuilderAppendChar(&json, ',', callerDescription);
+        }
+        appendThreadStatsJson(
+            &json,
+            atomic_load_explicit(&readerStats->recordCount, memory_order_relaxed),
+            atomic_load_explicit(&readerStats->byteCount, memory_order_relaxed),
+            atomic_load_explicit(&readerStats->waitCount, memory_order_relaxed),
+            atomic_load_explicit(&readerStats->blockedNanoseconds, memory_order_relaxed),
+            atomic_load_explicit(&readerStats->ioNanoseconds, memory_order_relaxed),
+            callerDescription
+        );
+    }
+    stringBuilderAppendString(&json, "]}\n", callerDescription);
+
+    safeFwrite(json.data, sizeof *json.data, json.length, file, callerDescription);
+    fflush(file);
+    stringBuilderDestroy(&json);
+}
+
+/**
+ * Destroy the given statistics.
+ *
+ * @param stats The statistics.
+ */
+void hw5StatsDestroy(struct Hw5Stats * const stats) {
+    guardNotNull(stats, "stats", "hw5StatsDestroy");
+
+    free(stats->readers);
+    free(stats);
+}
+
+/**
+ * Start writing the given statistics as JSON (see hw5StatsWriteJson) each time the process receives SIGUSR1. This
+ * blocks SIGUSR1 in the calling thread until the reporter is stopped, so the reporter must be started before any
+ * threads that should not receive the signal, and stopped from the same thread. If the operation fails, abort the
+ * program with an error message.
+ *
+ * @param stats The statistics.
+ * @param file The file to write to.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The reporter. The caller is responsible for stopping it using hw5StatsReporterStop.
+ */
+struct Hw5StatsReporter *hw5StatsReporterStart(
+    struct Hw5Stats const * const stats,
+    FILE * const file,
+    char const * const callerDescription
+) {
+    guardNotNull(stats, "stats", "hw5StatsReporterStart");
+    guardNotNull(file, "file", "hw5StatsReporterStart");
+    guardNotNull(callerDescription, "callerDescription", "hw5StatsReporterStart");
+
+    struct Hw5StatsReporter * const reporter = safeMalloc(sizeof *reporter, callerDescription);
+    reporter->stats = stats;
+    reporter->file = file;
+    atomic_init(&reporter->stopping, false);
+
+    sigset_t signalSet;
+    getReportSignalSet(&signalSet);
+    int const sigmaskErrorCode = pthread_sigmask(SIG_BLOCK, &signalSet, &reporter->previousSignalMask);
+    if (sigmaskErrorCode != 0) {
+        abortWithErrorFmt(
+            "%s: Failed to block SIGUSR1 using pthread_sigmask (error code: %d; error message: \"%s\")",
+            callerDescription,
+            sigmaskErrorCode,
+            strerror(sigmaskErrorCode)
+        );
+    }
+
+    reporter->threadId = safePthreadCreate(NULL, hw5StatsReporterThreadStart, reporter, callerDescription);
+    return reporter;
+}
+
+/**
+ * Stop the given reporter and restore the calling thread's signal mask. If the operation fails, abort the program
+ * with an error message.
+ *
+ * @param reporter The reporter.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void hw5StatsReporterStop(struct Hw5StatsReporter * const reporter, char const * const callerDescription) {
+    guardNotNull(reporter, "reporter", "hw5StatsReporterStop");
+    guardNotNull(callerDescription, "callerDescription", "hw5StatsReporterStop");
+
+    atomic_store_explicit(&reporter->stopping, true, memory_order_release);
+    int const killErrorCode = pthread_kill(reporter->threadId, SIGUSR1);
+    if (killErrorCode != 0) {
+        abortWithErrorFmt(
+            "%s: Failed to signal the statistics reporter using pthread_kill (error code: %d; error message: \"%s\")",
+            callerDescription,
+            killErrorCode,
+            strerror(killErrorCode)
+        );
+    }
+    safePthreadJoin(reporter->threadId, callerDescription);
+
+    int const sigmaskErrorCode = pthread_sigmask(SIG_SETMASK, &reporter->previousSignalMask, NULL);
+    if (sigmaskErrorCode != 0) {
+        abortWithErrorFmt(
+            "%s: Failed to restore the signal mask using pthread_sigmask (error code: %d; error message: \"%s\")",
+            callerDescription,
+            sigmaskErrorCode,
+            strerror(sigmaskErrorCode)
+        );
+    }
+
+    free(reporter);
+}
+
+static void appendThreadStatsJson(
+    struct StringBuilder * const json,
+    uint64_t const recordCount,
+    uint64_t const byteCount,
+    uint64_t const waitCount,
+    uint64_t const blockedNanoseconds,
+    uint64_t const ioNanoseconds,
+    char const * const callerDescription
+) {
+    stringBuilderAppendString(json, "{\"records\":", callerDescription);
+    stringBuilderAppendUnsigned(json, recordCount, callerDescription);
+    stringBuilderAppendString(json, ",\"bytes\":", callerDescription);
+    stringBuilderAppendUnsigned(json, byteCount, callerDescription);
+    stringBuilderAppendString(json, ",\"waits\":", callerDescription);
+    stringBuilderAppendUnsigned(json, waitCount, callerDescription);
+    stringBuilderAppendString(json, ",\"blockedNanoseconds\":", callerDescription);
+    stringBuilderAppendUnsigned(json, blockedNanoseconds, callerDescription);
+    stringBuilderAppendString(json, ",\"ioNanoseconds\":", callerDescription);
+    stringBuilderAppendUnsigned(json, ioNanoseconds, callerDescription);
+    stringBuilderAppendChar(json, '}', callerDescription);
+}
+
+static void *hw5StatsReporterThreadStart(void * const argAsVoidPtr) {
+    assert(argAsVoidPtr != NULL);
+    struct Hw5StatsReporter * const reporter = argAsVoidPtr;
+
+    sigset_t signalSet;
+    getReportSignalSet(&signalSet);
+
+    while (true) {
+        int signalNumber;
+        int const sigwaitErrorCode = sigwait(&signalSet, &signalNumber);
+        if (sigwaitErrorCode != 0) {
+            abortWithErrorFmt(
+                "hw5StatsReporterThreadStart: Failed to wait for SIGUSR1 using sigwait (error code: %d; error message: "
+                    "\"%s\")",
+                sigwaitErrorCode,
+                strerror(sigwaitErrorCode)
+            );
+        }
+
+        if (atomic_load_explicit(&reporter->stopping, memory_order_acquire)) {
+            break;
+        }
+
+        hw5StatsWriteJson(reporter->stats, false, reporter->file, "hw5StatsReporterThreadStart");
+    }
+
+    return NULL;
+}
+
+static void getReportSignalSet(sigset_t * const signalSetOutPtr) {
+    sigemptyset(signalSetOutPtr);
+    sigaddset(signalSetOutPtr, SIGUSR1);
+}
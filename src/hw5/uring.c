@@ -0,0 +1,510 @@
+#define _GNU_SOURCE
+
+#include "../../include/hw5/uring.h"
+
+#include "../../include/util/memory.h"
+#include "../../include/util/file.h"
+#include "../../include/util/uring.h"
+#include "../../include/util/gzip.h"
+#include "../../include/util/record.h"
+#include "../../include/util/schedule.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <assert.h>
+
+/**
+ * One input with two read-ahead buffers: the main thread parses records out of the current buffer while a read into
+ * the other buffer is in flight. The input is checked for the gzip magic bytes when its first read completes; if it is
+ * compressed, records are parsed out of a buffer that the current read-ahead buffer is decoded into instead.
+ */
+struct ReadAheadInput {
+    char const *inFilePath;
+    int fileDescriptor;
+    bool seekable;
+    size_t nextReadOffset;
+
+    char *buffers[2];
+    size_t bufferLengths[2];
+    unsigned int currentBuffer;
+    bool readPending;
+
+    bool sniffed;
+    struct GzipDecoder *decoder;
+    char *decodedBuffer;
+    size_t compressedPosition;
+
+    // The bytes records are parsed out of: the current buffer, or the decoded buffer if the input is compressed
+    char const *data;
+    size_t dataLength;
+    size_t position;
+
+    struct RecordScan recordScan;
+    bool finished;
+};
+
+/**
+ * The reads of every input, issued through a single io_uring if available, or else performed synchronously with
+ * pread (or read, for non-seekable inputs) when they are started.
+ */
+struct ReadAheadEngine {
+    struct ReadAheadInput *inputs;
+    size_t inputCount;
+    size_t bufferSize;
+
+    struct Uring *ring;
+};
+
+static size_t const readAheadBudget = 67108864;
+static size_t const minReadAheadBufferSize = 4096;
+static size_t const maxReadAheadBufferSize = 262144;
+static unsigned int const maxRingEntryCount = 4096;
+
+static void startRead(struct ReadAheadEngine *enginePtr, size_t inputIndex);
+static void awaitRead(struct ReadAheadEngine *enginePtr, size_t inputIndex);
+static void completeRead(struct ReadAheadInput *inputPtr, int32_t result);
+static bool advanceBuffer(struct ReadAheadEngine *enginePtr, size_t inputIndex);
+static bool switchBuffer(struct ReadAheadEngine *enginePtr, size_t inputIndex);
+static void sniffInput(struct ReadAheadEngine *enginePtr, size_t inputIndex);
+static bool decodeInput(struct ReadAheadEngine *enginePtr, size_t inputIndex);
+static bool takeCharacter(struct ReadAheadEngine *enginePtr, size_t inputIndex, char *characterOutPtr);
+static bool transferRecord(
+    struct ReadAheadEngine *enginePtr,
+    size_t inputIndex,
+    struct RecordFormat const *recordFormatPtr,
+    struct BufferedWriter *outWriter
+);
+
+/**
+ * Run HW5 on a single thread, with no reader threads. Each input keeps a read-ahead buffer filled by reads submitted
+ * through io_uring, so all inputs are read concurrently by the kernel while the calling thread interleaves records.
+ * Where io_uring is unavailable, reads are performed with pread instead, producing the same output. Gzip-compressed
+ * inputs other than regular files are detected by their magic bytes and decoded as their records are needed.
+ *
+ * @param inFilePaths The input file paths.
+ * @param inFileCount The number of input files.
+ * @param outWriter The output writer, which the caller remains responsible for closing.
+ * @param recordFormatPtr The record format.
+ * @param schedulePtr The order in which records are taken from the inputs.
+ */
+void hw5Uring(
+    char const * const * const inFilePaths,
+    size_t const inFileCount,
+    struct BufferedWriter * const outWriter,
+    struct RecordFormat const * const recordFormatPtr,
+    struct InterleaveSchedule const * const schedulePtr
+) {
+    guardNotNull(inFilePaths, "inFilePaths", "hw5Uring");
+    guardNotNull(outWriter, "outWriter", "hw5Uring");
+    guardNotNull(recordFormatPtr, "recordFormatPtr", "hw5Uring");
+    guardNotNull(schedulePtr, "schedulePtr", "hw5Uring");
+
+    bool const characterRecords = recordFormatPtr->kind == RECORD_KIND_CHARACTER;
+
+    size_t bufferSize = inFileCount > 0 ? readAheadBudget / (inFileCount * 2) : maxReadAheadBufferSize;
+    if (bufferSize < minReadAheadBufferSize) {
+        bufferSize = minReadAheadBufferSize;
+    }
+    if (bufferSize > maxReadAheadBufferSize) {
+        bufferSize = maxReadAheadBufferSize;
+    }
+
+    unsigned int ringEntryCount = 1;
+    while (ringEntryCount < inFileCount && ringEntryCount < maxRingEntryCount) {
+        ringEntryCount <<= 1;
+    }
+
+    struct ReadAheadEngine engine = {
+        .inputs = safeMalloc(sizeof *engine.inputs * inFileCount, "hw5Uring"),
+        .inputCount = inFileCount,
+        .bufferSize = bufferSize,
+        .ring = tryUringCreate(ringEntryCount, "hw5Uring")
+    };
+
+    for (size_t i = 0; i < inFileCount; i += 1) {
+        struct ReadAheadInput * const inputPtr = &engine.inputs[i];
+
+        inputPtr->inFilePath = inFilePaths[i];
+        inputPtr->fileDescriptor = safeOpen(inFilePaths[i], O_RDONLY, 0, "hw5Uring");
+        inputPtr->seekable = lseek(inputPtr->fileDescriptor, 0, SEEK_CUR) >= 0;
+        inputPtr->nextReadOffset = 0;
+
+        inputPtr->buffers[0] = safeMalloc(sizeof *inputPtr->buffers[0] * bufferSize, "hw5Uring");
+        inputPtr->buffers[1] = safeMalloc(sizeof *inputPtr->buffers[1] * bufferSize, "hw5Uring");
+        inputPtr->bufferLengths[0] = 0;
+        inputPtr->bufferLengths[1] = 0;
+        inputPtr->readPending = false;
+
+        inputPtr->sniffed = false;
+        inputPtr->decoder = NULL;
+        inputPtr->decodedBuffer = NULL;
+        inputPtr->compressedPosition = 0;
+
+        recordScanInit(&inputPtr->recordScan);
+        inputPtr->finished = false;
+
+        // Start with an empty current buffer so the first record waits for the first read into the other buffer
+        inputPtr->currentBuffer = 1;
+        inputPtr->data = inputPtr->buffers[1];
+        inputPtr->dataLength = 0;
+        inputPtr->position = 0;
+        startRead(&engine, i);
+    }
+    if (engine.ring != NULL) {
+        uringSubmitAndWait(engine.ring, 0, "hw5Uring");
+    }
+
+    uint32_t const * const slots = schedulePtr->slots;
+    size_t const slotCount = schedulePtr->slotCount;
+    while (true) {
+        bool foundUnfinished = false;
+
+        for (size_t slot = 0; slot < slotCount; slot += 1) {
+            size_t const i = slots[slot];
+            if (!characterRecords) {
+                foundUnfinished = transferRecord(&engine, i, recordFormatPtr, outWriter) || foundUnfinished;
+                continue;
+            }
+
+            char readCharacter;
+            if (!takeCharacter(&engine, i, &readCharacter)) {
+                continue;
+            }
+            foundUnfinished = true;
+
+            char const record[] = { readCharacter, '\n' };
+            bufferedWriterWrite(outWriter, record, sizeof record, "hw5Uring");
+        }
+
+        if (!foundUnfinished) {
+            break;
+        }
+    }
+
+    if (engine.ring != NULL) {
+        uringDestroy(engine.ring, "hw5Uring");
+    }
+    for (size_t i = 0; i < inFileCount; i += 1) {
+        struct ReadAheadInput * const inputPtr = &engine.inputs[i];
+
+        safeClose(inputPtr->fileDescriptor, "hw5Uring");
+        free(inputPtr->buffers[0]);
+        free(inputPtr->buffers[1]);
+        if (inputPtr->decoder != NULL) {
+            gzipDecoderDestroy(inputPtr->decoder);
+            free(inputPtr->decodedBuffer);
+        }
+    }
+    free(engine.inputs);
+}
+
+/**
+ * Start reading the next block of the given input into its non-current buffer.
+ */
+static void startRead(struct ReadAheadEngine * const enginePtr, size_t const inputIndex) {
+    struct ReadAheadInput * const inputPtr = &enginePtr->inputs[inputIndex];
+    assert(!inputPtr->readPending);
+
+    unsigned int const targetBuffer = 1 - inputPtr->currentBuffer;
+    char * const buffer = inputPtr->buffers[targetBuffer];
+    inputPtr->readPending = true;
+
+    if (enginePtr->ring == NULL) {
+        size_t const readLength = (
+            inputPtr->seekable
+                ? safePread(
+                    inputPtr->fileDescriptor,
+                    buffer,
+                    enginePtr->bufferSize,
+                    inputPtr->nextReadOffset,
+                    inputPtr->inFilePath
+                )
+                : safeRead(inputPtr->fileDescriptor, buffer, enginePtr->bufferSize, inputPtr->inFilePath)
+        );
+        completeRead(inputPtr, (int32_t)readLength);
+        return;
+    }
+
+    int64_t const offset = inputPtr->seekable ? (int64_t)inputPtr->nextReadOffset : -1;
+    while (
+        !uringTryPrepareRead(
+            enginePtr->ring,
+            inputPtr->fileDescriptor,
+            buffer,
+            (unsigned int)enginePtr->bufferSize,
+            offset,
+            inputIndex
+        )
+    ) {
+        // The submission queue is full; hand its entries to the kernel to make room
+        uringSubmitAndWait(enginePtr->ring, 0, "startRead");
+    }
+}
+
+/**
+ * Wait for the given input's in-flight read to complete, recording any other completions that arrive meanwhile.
+ */
+static void awaitRead(struct ReadAheadEngine * const enginePtr, size_t const inputIndex) {
+    struct ReadAheadInput * const inputPtr = &enginePtr->inputs[inputIndex];
+
+    while (inputPtr->readPending) {
+        uint64_t completedInputIndex;
+        int32_t result;
+        if (!uringTryTakeCompletion(enginePtr->ring, &completedInputIndex, &result)) {
+            uringSubmitAndWait(enginePtr->ring, 1, "awaitRead");
+            continue;
+        }
+
+        struct ReadAheadInput * const completedInputPtr = &enginePtr->inputs[completedInputIndex];
+        if (result < 0) {
+            abortWithErrorFmt(
+                "awaitRead: Failed to read from file \"%s\" using io_uring (error code: %d; error message: \"%s\")",
+                completedInputPtr->inFilePath,
+                -result,
+                strerror(-result)
+            );
+            return;
+        }
+        completeRead(completedInputPtr, result);
+    }
+}
+
+static void completeRead(struct ReadAheadInput * const inputPtr, int32_t const result) {
+    size_t const readLength = (size_t)result;
+
+    inputPtr->bufferLengths[1 - inputPtr->currentBuffer] = readLength;
+    inputPtr->nextReadOffset += readLength;
+    inputPtr->readPending = false;
+}
+
+/**
+ * Move the given input on to its next bytes once the current ones have been consumed: its read-ahead buffer, or, if it
+ * is compressed, whatever more can be decoded.
+ *
+ * @returns True if the input has more data, or false if it has been exhausted.
+ */
+static bool advanceBuffer(struct ReadAheadEngine * const enginePtr, size_t const inputIndex) {
+    struct ReadAheadInput * const inputPtr = &enginePtr->inputs[inputIndex];
+
+    if (inputPtr->decoder == NULL) {
+        bool const filled = switchBuffer(enginePtr, inputIndex);
+
+        // The first switch may find the input compressed
+        if (inputPtr->decoder == NULL) {
+            inputPtr->data = inputPtr->buffers[inputPtr->currentBuffer];
+            inputPtr->dataLength = inputPtr->bufferLengths[inputPtr->currentBuffer];
+            inputPtr->position = 0;
+            inputPtr->finished = !filled;
+            return filled;
+        }
+    }
+
+    bool const decoded = decodeInput(enginePtr, inputIndex);
+    inputPtr->finished = !decoded;
+    return decoded;
+}
+
+/**
+ * Switch the given input to its read-ahead buffer, waiting for the read into it to complete, and start the following
+ * read. The first switch also determines whether the input is compressed.
+ *
+ * @returns True if the new current buffer holds bytes, or false if the input has ended.
+ */
+static bool switchBuffer(struct ReadAheadEngine * const enginePtr, size_t const inputIndex) {
+    struct ReadAheadInput * const inputPtr = &enginePtr->inputs[inputIndex];
+
+    awaitRead(enginePtr, inputIndex);
+    inputPtr->currentBuffer = 1 - inputPtr->currentBuffer;
+    inputPtr->compressedPosition = 0;
+
+    if (!inputPtr->sniffed) {
+        sniffInput(enginePtr, inputIndex);
+    }
+    if (inputPtr->bufferLengths[inputPtr->currentBuffer] == 0) {
+        return false;
+    }
+
+    startRead(enginePtr, inputIndex);
+    if (enginePtr->ring != NULL) {
+        uringSubmitAndWait(enginePtr->ring, 0, "switchBuffer");
+    }
+    return true;
+}
+
+/**
+ * Determine whether the given input, whose first read has just completed into its current buffer, is gzip-compressed.
+ * A short first read (e.g. of a pipe) may not hold both magic bytes, so the buffer is first topped up with synchronous
+ * reads, which is safe because no read of the input is in flight.
+ */
+static void sniffInput(struct ReadAheadEngine * const enginePtr, size_t const inputIndex) {
+    struct ReadAheadInput * const inputPtr = &enginePtr->inputs[inputIndex];
+    assert(!inputPtr->readPending);
+
+    char * const buffer = inputPtr->buffers[inputPtr->currentBuffer];
+    size_t * const bufferLengthPtr = &inputPtr->bufferLengths[inputPtr->currentBuffer];
+    size_t const magicLength = 2;
+    size_t readLength = *bufferLengthPtr;
+    while (*bufferLengthPtr < magicLength && readLength > 0) {
+        size_t const freeLength = enginePtr->bufferSize - *bufferLengthPtr;
+        readLength = (
+            inputPtr->seekable
+                ? safePread(
+                    inputPtr->fileDescriptor,
+                    &buffer[*bufferLengthPtr],
+                    freeLength,
+                    inputPtr->nextReadOffset,
+                    inputPtr->inFilePath
+                )
+                : safeRead(inputPtr->fileDescriptor, &buffer[*bufferLengthPtr], freeLength, inputPtr->inFilePath)
+        );
+        *bufferLengthPtr += readLength;
+        inputPtr->nextReadOffset += readLength;
+    }
+    inputPtr->sniffed = true;
+
+    if (!hasGzipMagic(buffer, *bufferLengthPtr)) {
+        return;
+    }
+
+    inputPtr->decoder = gzipDecoderCreate(inputPtr->inFilePath, "sniffInput");
+    inputPtr->decodedBuffer = safeMalloc(sizeof *inputPtr->decodedBuffer * enginePtr->bufferSize, "sniffInput");
+}
+
+/**
+ * Decode more of the given compressed input into its decoded buffer, whose data has all been consumed, switching
+ * read-ahead buffers whenever the current one has all been decoded.
+ *
+ * @returns True if the input has more data, or false if it has ended.
+ */
+static bool decodeInput(struct ReadAheadEngine * const enginePtr, size_t const inputIndex) {
+    struct ReadAheadInput * const inputPtr = &enginePtr->inputs[inputIndex];
+
+    inputPtr->data = inputPtr->decodedBuffer;
+    inputPtr->dataLength = 0;
+    inputPtr->position = 0;
+    while (true) {
+        char const * const buffer = inputPtr->buffers[inputPtr->currentBuffer];
+        size_t const bufferLength = inputPtr->bufferLengths[inputPtr->currentBuffer];
+
+        if (inputPtr->compressedPosition < bufferLength) {
+            size_t consumedLength;
+            inputPtr->dataLength = gzipDecoderDecode(
+                inputPtr->decoder,
+                &buffer[inputPtr->compressedPosition],
+                bufferLength - inputPtr->compressedPosition,
+                &consumedLength,
+                inputPtr->decodedBuffer,
+                enginePtr->bufferSize,
+                "decodeInput"
+            );
+            inputPtr->compressedPosition += consumedLength;
+            if (inputPtr->dataLength > 0) {
+                return true;
+            }
+            continue;
+        }
+
+        if (!switchBuffer(enginePtr, inputIndex)) {
+            gzipDecoderFinish(inputPtr->decoder, "decodeInput");
+            return false;
+        }
+    }
+}
+
+/**
+ * Take the next `"%c\n"` record from the given input.
+ *
+ * @returns True if a record was taken, or false if the input has been exhausted.
+ */
+static bool takeCharacter(
+    struct ReadAheadEngine * const enginePtr,
+    size_t const inputIndex,
+    char * const characterOutPtr
+) {
+    struct ReadAheadInput * const inputPtr = &enginePtr->inputs[inputIndex];
+
+    while (!inputPtr->finished) {
+        char const * const data = inputPtr->data;
+        size_t const dataLength = inputPtr->dataLength;
+
+        while (inputPtr->position < dataLength) {
+            char const character = data[inputPtr->position];
+            inputPtr->position += 1;
+
+            if (inputPtr->recordScan.skippingWhitespace && isScanfWhitespace(character)) {
+                continue;
+            }
+
+            inputPtr->recordScan.skippingWhitespace = true;
+            *characterOutPtr = character;
+            return true;
+        }
+
+        advanceBuffer(enginePtr, inputIndex);
+    }
+
+    return false;
+}
+
+/**
+ * Write the next record of the given input to the output, a piece at a time if it spans read-ahead buffers.
+ *
+ * @returns True if a record was written, or false if the input has been exhausted.
+ */
+static bool transferRecord(
+    struct ReadAheadEngine * const enginePtr,
+    size_t const inputIndex,
+    struct RecordFormat const * const recordFormatPtr,
+    struct BufferedWriter * const outWriter
+) {
+    struct ReadAheadInput * const inputPtr = &enginePtr->inputs[inputIndex];
+
+    char terminator;
+    while (!inputPtr->finished) {
+        char const * const data = inputPtr->data;
+        size_t const dataLength = inputPtr->dataLength;
+
+        if (inputPtr->position == dataLength) {
+            advanceBuffer(enginePtr, inputIndex);
+            continue;
+        }
+
+        size_t pieceOffset;
+        size_t pieceLength;
+        bool complete;
+        size_t const scannedLength = scanRecordPiece(
+            recordFormatPtr,
+            &inputPtr->recordScan,
+            &data[inputPtr->position],
+            dataLength - inputPtr->position,
+            &pieceOffset,
+            &pieceLength,
+            &complete
+        );
+        if (pieceLength > 0) {
+            bufferedWriterWrite(outWriter, &data[inputPtr->position + pieceOffset], pieceLength, "transferRecord");
+        }
+        inputPtr->position += scannedLength;
+
+        if (complete) {
+            if (getRecordTerminator(recordFormatPtr, true, &terminator)) {
+                bufferedWriterWrite(outWriter, &terminator, 1, "transferRecord");
+            }
+            return true;
+        }
+    }
+
+    // The input ended, possibly part way through a record
+    bool const incomplete = inputPtr->recordScan.recordLength > 0;
+    if (incomplete && getRecordTerminator(recordFormatPtr, false, &terminator)) {
+        bufferedWriterWrite(outWriter, &terminator, 1, "transferRecord");
+    }
+    recordScanInit(&inputPtr->recordScan);
+    return incomplete;
+}
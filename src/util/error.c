@@ -12,7 +12,7 @@
  *
  * @param errorMessage The error message, not terminated by a newline.
  */
-void abortWithError(char const * const errorMessage) {
+_Noreturn void abortWithError(char const * const errorMessage) {
     guardNotNull(errorMessage, "errorMessage", "abortWithError");
 
     fputs(errorMessage, stderr);
@@ -26,7 +26,7 @@ void abortWithError(char const * const errorMessage) {
  * @param errorMessage The error message format (printf), not terminated by a newline.
  * @param ... The error message format arguments (printf).
  */
-void abortWithErrorFmt(char const * const errorMessageFormat, ...) {
+_Noreturn void abortWithErrorFmt(char const * const errorMessageFormat, ...) {
     va_list errorMessageFormatArgs;
     va_start(errorMessageFormatArgs, errorMessageFormat);
     abortWithErrorFmtVA(errorMessageFormat, errorMessageFormatArgs);
@@ -39,10 +39,12 @@ void abortWithErrorFmt(char const * const errorMessageFormat, ...) {
  * @param errorMessage The error message format (printf), not terminated by a newline.
  * @param errorMessageFormatArgs The error message format arguments (printf).
  */
-void abortWithErrorFmtVA(char const * const errorMessageFormat, va_list errorMessageFormatArgs) {
+_Noreturn void abortWithErrorFmtVA(char const * const errorMessageFormat, va_list errorMessageFormatArgs) {
     guardNotNull(errorMessageFormat, "errorMessageFormat", "abortWithErrorFmtVA");
 
-    char * const errorMessage = formatStringVA(errorMessageFormat, errorMessageFormatArgs);
-    abortWithError(errorMessage);
-    free(errorMessage);
+    // Built on the stack so that short messages need no allocation, which may be what failed
+    struct StringBuilder errorMessage;
+    stringBuilderInit(&errorMessage);
+    stringBuilderAppendFmtVA(&errorMessage, "abortWithErrorFmtVA", errorMessageFormat, errorMessageFormatArgs);
+    abortWithError(errorMessage.data);
 }
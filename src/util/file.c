@@ -1,13 +1,33 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "../../include/util/file.h"
 
+#include "../../include/util/memory.h"
+#include "../../include/util/stats.h"
+#include "../../include/util/gzip.h"
 #include "../../include/util/guard.h"
 #include "../../include/util/error.h"
 
+#include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <stdarg.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FILE_X86 1
+#include <immintrin.h>
+#else
+#define FILE_X86 0
+#endif
 
 /**
  * Open the file using fopen. If the operation fails, abort the program with an error message.
@@ -43,6 +63,367 @@ FILE *safeFopen(char const * const filePath, char const * const modes, char cons
     return file;
 }
 
+/**
+ * Open the file using open. If the operation fails, abort the program with an error message.
+ *
+ * @param filePath The file path.
+ * @param flags The open flags.
+ * @param mode The permissions with which to create the file, if O_CREAT is among the flags.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The file descriptor.
+ */
+int safeOpen(char const * const filePath, int const flags, mode_t const mode, char const * const callerDescription) {
+    guardNotNull(filePath, "filePath", "safeOpen");
+    guardNotNull(callerDescription, "callerDescription", "safeOpen");
+
+    int const fileDescriptor = open(filePath, flags, mode);
+    if (fileDescriptor < 0) {
+        int const openErrorCode = errno;
+        char const * const openErrorMessage = strerror(openErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to open file \"%s\" with flags %#x using open (error code: %d; error message: \"%s\")",
+            callerDescription,
+            filePath,
+            (unsigned int)flags,
+            openErrorCode,
+            openErrorMessage
+        );
+        return -1;
+    }
+
+    return fileDescriptor;
+}
+
+/**
+ * Close the given file descriptor. If the operation fails (which can mean previously written data was lost), abort the
+ * program with an error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeClose(int const fileDescriptor, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeClose");
+
+    if (close(fileDescriptor) != 0) {
+        int const closeErrorCode = errno;
+        char const * const closeErrorMessage = strerror(closeErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to close file descriptor %d using close (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            closeErrorCode,
+            closeErrorMessage
+        );
+    }
+}
+
+/**
+ * Make reads of the given file descriptor return immediately, rather than block, when no data is available, or undo
+ * this. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param nonBlocking Whether reads should not block.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeSetNonBlocking(int const fileDescriptor, bool const nonBlocking, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeSetNonBlocking");
+
+    int const flags = fcntl(fileDescriptor, F_GETFL);
+    int const newFlags = nonBlocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK;
+    if (flags < 0 || (newFlags != flags && fcntl(fileDescriptor, F_SETFL, newFlags) != 0)) {
+        int const fcntlErrorCode = errno;
+        char const * const fcntlErrorMessage = strerror(fcntlErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to set file descriptor %d flags using fcntl (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            fcntlErrorCode,
+            fcntlErrorMessage
+        );
+    }
+}
+
+/**
+ * Set the length of the given file, extending it with zero bytes or discarding its tail as necessary. If the operation
+ * fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor, open for writing.
+ * @param length The new length of the file, in bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeFtruncate(int const fileDescriptor, size_t const length, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeFtruncate");
+
+    if (ftruncate(fileDescriptor, (off_t)length) != 0) {
+        int const ftruncateErrorCode = errno;
+        char const * const ftruncateErrorMessage = strerror(ftruncateErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to set file length to %zu bytes using ftruncate (error code: %d; error message: \"%s\")",
+            callerDescription,
+            length,
+            ftruncateErrorCode,
+            ftruncateErrorMessage
+        );
+    }
+}
+
+/**
+ * Wait until the given file's data has reached the storage device, so that it survives a crash. If the operation
+ * fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeFdatasync(int const fileDescriptor, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeFdatasync");
+
+    if (fdatasync(fileDescriptor) != 0) {
+        int const fdatasyncErrorCode = errno;
+        char const * const fdatasyncErrorMessage = strerror(fdatasyncErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to sync file descriptor %d using fdatasync (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            fdatasyncErrorCode,
+            fdatasyncErrorMessage
+        );
+    }
+}
+
+/**
+ * Rename the given file, atomically replacing any file at the new path. If the operation fails, abort the program with
+ * an error message.
+ *
+ * @param oldFilePath The current file path.
+ * @param newFilePath The new file path.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeRename(char const * const oldFilePath, char const * const newFilePath, char const * const callerDescription) {
+    guardNotNull(oldFilePath, "oldFilePath", "safeRename");
+    guardNotNull(newFilePath, "newFilePath", "safeRename");
+    guardNotNull(callerDescription, "callerDescription", "safeRename");
+
+    if (rename(oldFilePath, newFilePath) != 0) {
+        int const renameErrorCode = errno;
+        char const * const renameErrorMessage = strerror(renameErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to rename file \"%s\" to \"%s\" using rename (error code: %d; error message: \"%s\")",
+            callerDescription,
+            oldFilePath,
+            newFilePath,
+            renameErrorCode,
+            renameErrorMessage
+        );
+    }
+}
+
+/**
+ * Read up to the given number of bytes from the given file's current position using read, retrying after
+ * interruptions. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor, open for reading.
+ * @param buffer The buffer into which to read.
+ * @param length The maximum number of bytes to read.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of bytes read, or 0 at the end of the file.
+ */
+size_t safeRead(
+    int const fileDescriptor,
+    char * const buffer,
+    size_t const length,
+    char const * const callerDescription
+) {
+    guardNotNull(buffer, "buffer", "safeRead");
+    guardNotNull(callerDescription, "callerDescription", "safeRead");
+
+    while (true) {
+        ssize_t const readResult = read(fileDescriptor, buffer, length);
+        if (readResult >= 0) {
+            return (size_t)readResult;
+        }
+
+        int const readErrorCode = errno;
+        if (readErrorCode == EINTR) {
+            continue;
+        }
+        char const * const readErrorMessage = strerror(readErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to read %zu bytes using read (error code: %d; error message: \"%s\")",
+            callerDescription,
+            length,
+            readErrorCode,
+            readErrorMessage
+        );
+        return 0;
+    }
+}
+
+/**
+ * Read up to the given number of bytes from the given non-blocking file's current position using read, retrying after
+ * interruptions. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor, open for non-blocking reading.
+ * @param buffer The buffer into which to read.
+ * @param length The maximum number of bytes to read.
+ * @param readLengthOutPtr Where to store the number of bytes read, which is 0 at the end of the file.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns True if the read completed, or false if no bytes are available yet.
+ */
+bool safeTryRead(
+    int const fileDescriptor,
+    char * const buffer,
+    size_t const length,
+    size_t * const readLengthOutPtr,
+    char const * const callerDescription
+) {
+    guardNotNull(buffer, "buffer", "safeTryRead");
+    guardNotNull(readLengthOutPtr, "readLengthOutPtr", "safeTryRead");
+    guardNotNull(callerDescription, "callerDescription", "safeTryRead");
+
+    while (true) {
+        ssize_t const readResult = read(fileDescriptor, buffer, length);
+        if (readResult >= 0) {
+            *readLengthOutPtr = (size_t)readResult;
+            return true;
+        }
+
+        int const readErrorCode = errno;
+        if (readErrorCode == EINTR) {
+            continue;
+        }
+        if (readErrorCode == EAGAIN) {
+            return false;
+        }
+        char const * const readErrorMessage = strerror(readErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to read %zu bytes using read (error code: %d; error message: \"%s\")",
+            callerDescription,
+            length,
+            readErrorCode,
+            readErrorMessage
+        );
+        return false;
+    }
+}
+
+/**
+ * Read up to the given number of bytes from the given file at the given offset using pread, retrying after
+ * interruptions. The file offset is not changed. If the operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor, open for reading.
+ * @param buffer The buffer into which to read.
+ * @param length The maximum number of bytes to read.
+ * @param offset The file offset at which to read.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of bytes read, or 0 at the end of the file.
+ */
+size_t safePread(
+    int const fileDescriptor,
+    char * const buffer,
+    size_t const length,
+    size_t const offset,
+    char const * const callerDescription
+) {
+    guardNotNull(buffer, "buffer", "safePread");
+    guardNotNull(callerDescription, "callerDescription", "safePread");
+
+    while (true) {
+        ssize_t const preadResult = pread(fileDescriptor, buffer, length, (off_t)offset);
+        if (preadResult >= 0) {
+            return (size_t)preadResult;
+        }
+
+        int const preadErrorCode = errno;
+        if (preadErrorCode == EINTR) {
+            continue;
+        }
+        char const * const preadErrorMessage = strerror(preadErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to read %zu bytes at offset %zu using pread (error code: %d; error message: \"%s\")",
+            callerDescription,
+            length,
+            offset,
+            preadErrorCode,
+            preadErrorMessage
+        );
+        return 0;
+    }
+}
+
+/**
+ * Write all of the given bytes to the given file at the given offset using pwrite, retrying after partial writes and
+ * interruptions. The file offset is not changed, so multiple threads may write to the same file concurrently. If the
+ * operation fails, abort the program with an error message.
+ *
+ * @param fileDescriptor The file descriptor, open for writing.
+ * @param data The bytes to write.
+ * @param length The number of bytes to write.
+ * @param offset The file offset at which to write.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safePwrite(
+    int const fileDescriptor,
+    char const * const data,
+    size_t const length,
+    size_t const offset,
+    char const * const callerDescription
+) {
+    guardNotNull(data, "data", "safePwrite");
+    guardNotNull(callerDescription, "callerDescription", "safePwrite");
+
+    size_t writtenLength = 0;
+    while (writtenLength < length) {
+        ssize_t const pwriteResult = pwrite(
+            fileDescriptor,
+            &data[writtenLength],
+            length - writtenLength,
+            (off_t)(offset + writtenLength)
+        );
+        if (pwriteResult < 0) {
+            int const pwriteErrorCode = errno;
+            if (pwriteErrorCode == EINTR) {
+                continue;
+            }
+            char const * const pwriteErrorMessage = strerror(pwriteErrorCode);
+
+            abortWithErrorFmt(
+                "%s: Failed to write %zu bytes at offset %zu using pwrite (error code: %d; error message: \"%s\")",
+                callerDescription,
+                length - writtenLength,
+                offset + writtenLength,
+                pwriteErrorCode,
+                pwriteErrorMessage
+            );
+            return;
+        }
+
+        writtenLength += (size_t)pwriteResult;
+    }
+}
+
 /**
  * Print a formatted string to the given file. If the operation fails, abort the program with an error message.
  *
@@ -106,6 +487,90 @@ unsigned int safeVfprintf(
     return (unsigned int)printedCharCount;
 }
 
+/**
+ * Write elementCount elements of the given size from the given buffer to the given file using fwrite. If the operation
+ * fails, abort the program with an error message.
+ *
+ * @param buffer The buffer from which to write.
+ * @param elementSize The size of each element, in bytes.
+ * @param elementCount The number of elements to write.
+ * @param file The file to write to.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeFwrite(
+    void const * const buffer,
+    size_t const elementSize,
+    size_t const elementCount,
+    FILE * const file,
+    char const * const callerDescription
+) {
+    guardNotNull(buffer, "buffer", "safeFwrite");
+    guardNotNull(file, "file", "safeFwrite");
+    guardNotNull(callerDescription, "callerDescription", "safeFwrite");
+
+    size_t const writtenCount = fwrite(buffer, elementSize, elementCount, file);
+    if (writtenCount != elementCount) {
+        int const fwriteErrorCode = errno;
+        char const * const fwriteErrorMessage = strerror(fwriteErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to write %zu elements of %zu bytes to file using fwrite"
+            " (error code: %d; error message: \"%s\")",
+            callerDescription,
+            elementCount,
+            elementSize,
+            fwriteErrorCode,
+            fwriteErrorMessage
+        );
+    }
+}
+
+/**
+ * Read up to elementCount elements of the given size from the given file into the given buffer using fread. If the
+ * operation fails, abort the program with an error message.
+ *
+ * @param buffer The buffer into which to read.
+ * @param elementSize The size of each element, in bytes.
+ * @param elementCount The maximum number of elements to read.
+ * @param file The file to read from.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of elements read. This is less than elementCount only if the end of the file was reached.
+ */
+size_t safeFread(
+    void * const buffer,
+    size_t const elementSize,
+    size_t const elementCount,
+    FILE * const file,
+    char const * const callerDescription
+) {
+    guardNotNull(buffer, "buffer", "safeFread");
+    guardNotNull(file, "file", "safeFread");
+    guardNotNull(callerDescription, "callerDescription", "safeFread");
+
+    size_t const readCount = fread(buffer, elementSize, elementCount, file);
+    bool const freadError = ferror(file);
+    if (freadError) {
+        int const freadErrorCode = errno;
+        char const * const freadErrorMessage = strerror(freadErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to read %zu elements of %zu bytes from file using fread"
+            " (error code: %d; error message: \"%s\")",
+            callerDescription,
+            elementCount,
+            elementSize,
+            freadErrorCode,
+            freadErrorMessage
+        );
+        return 0;
+    }
+
+    return readCount;
+}
+
 /**
  * Read characters from the given file into the given buffer. Stop as soon as one of the following conditions has been
  * met: (A) `bufferLength - 1` characters have been read, (B) a newline is encountered, or (C) the end of the file is
@@ -287,3 +752,1009 @@ bool scanFileExactVA(
 
     return true;
 }
+
+/**
+ * A reader that parses `"%c\n"` records from a file a block at a time, rather than calling fscanf once per record.
+ */
+struct CharacterRecordReader {
+    FILE *file;
+    bool skippingWhitespace;
+    bool reachedEnd;
+
+    char *block;
+    size_t blockSize;
+    size_t blockLength;
+    size_t blockPosition;
+
+    struct ThreadStats *stats;
+};
+
+/**
+ * Map the given file into memory, read-only, if it is a regular file. Other kinds of files (pipes, FIFOs, character
+ * devices, etc.) cannot be mapped and must be read as streams instead; they are detected without opening them so that
+ * no data is consumed. If the file cannot be opened, abort the program with an error message.
+ *
+ * @param filePath The file path.
+ * @param mappedFileOutPtr Where to store the mapping. An empty file is mapped as a null data pointer with zero length.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns True if the file was mapped, or false if it must be read as a stream. The caller is responsible for
+ *          unmapping a mapped file using unmapFile.
+ */
+bool tryMapFile(
+    char const * const filePath,
+    struct MappedFile * const mappedFileOutPtr,
+    char const * const callerDescription
+) {
+    guardNotNull(filePath, "filePath", "tryMapFile");
+    guardNotNull(mappedFileOutPtr, "mappedFileOutPtr", "tryMapFile");
+    guardNotNull(callerDescription, "callerDescription", "tryMapFile");
+
+    struct stat pathStatus;
+    if (stat(filePath, &pathStatus) != 0 || !S_ISREG(pathStatus.st_mode)) {
+        return false;
+    }
+
+    int const fileDescriptor = safeOpen(filePath, O_RDONLY, 0, callerDescription);
+
+    struct stat fileStatus;
+    if (
+        fstat(fileDescriptor, &fileStatus) != 0
+        || !S_ISREG(fileStatus.st_mode)
+        || (uintmax_t)fileStatus.st_size > SIZE_MAX
+    ) {
+        close(fileDescriptor);
+        return false;
+    }
+
+    size_t const fileLength = (size_t)fileStatus.st_size;
+    if (fileLength == 0) {
+        close(fileDescriptor);
+        mappedFileOutPtr->data = NULL;
+        mappedFileOutPtr->length = 0;
+        return true;
+    }
+
+    void * const data = mmap(NULL, fileLength, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    close(fileDescriptor);
+    if (data == MAP_FAILED) {
+        // Some file systems do not support mapping
+        return false;
+    }
+
+    // Only a hint, so failure is harmless
+    posix_madvise(data, fileLength, POSIX_MADV_SEQUENTIAL);
+
+    mappedFileOutPtr->data = data;
+    mappedFileOutPtr->length = fileLength;
+    return true;
+}
+
+/**
+ * Unmap the given file mapping. If the operation fails, abort the program with an error message.
+ *
+ * @param mappedFilePtr A pointer to the mapping created by tryMapFile.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void unmapFile(struct MappedFile * const mappedFilePtr, char const * const callerDescription) {
+    guardNotNull(mappedFilePtr, "mappedFilePtr", "unmapFile");
+    guardNotNull(callerDescription, "callerDescription", "unmapFile");
+
+    if (mappedFilePtr->data == NULL) {
+        return;
+    }
+
+    if (munmap((void *)(uintptr_t)mappedFilePtr->data, mappedFilePtr->length) != 0) {
+        int const munmapErrorCode = errno;
+        char const * const munmapErrorMessage = strerror(munmapErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to unmap %zu bytes using munmap (error code: %d; error message: \"%s\")",
+            callerDescription,
+            mappedFilePtr->length,
+            munmapErrorCode,
+            munmapErrorMessage
+        );
+        return;
+    }
+
+    mappedFilePtr->data = NULL;
+    mappedFilePtr->length = 0;
+}
+
+/*
+ * Every `"%c\n"` record after an input's first starts at a byte that is not whitespace, so finding records reduces to
+ * classifying bytes. The vector kernels below classify a block of bytes at a time into a bit mask and walk or count its
+ * set bits; the instruction set is chosen at runtime, and the bytes left over after the last whole block are scanned
+ * by a scalar loop.
+ */
+
+#if FILE_X86
+static size_t findNonWhitespaceSse2(
+    char const *data,
+    size_t dataLength,
+    size_t position,
+    size_t *offsetsOut,
+    size_t offsetsCapacity,
+    size_t *offsetCountPtr
+);
+static size_t findNonWhitespaceAvx2(
+    char const *data,
+    size_t dataLength,
+    size_t position,
+    size_t *offsetsOut,
+    size_t offsetsCapacity,
+    size_t *offsetCountPtr
+);
+static size_t countNonWhitespaceSse2(char const *data, size_t dataLength, size_t *scannedLengthOutPtr);
+static size_t countNonWhitespaceAvx2(char const *data, size_t dataLength, size_t *scannedLengthOutPtr);
+static unsigned int getWhitespaceMaskSse2(__m128i bytes);
+static unsigned int getWhitespaceMaskAvx2(__m256i bytes);
+#endif
+
+/**
+ * Determine whether the given character is skipped by a whitespace directive in a scanf format. The program never
+ * changes its locale, so this is the "C" locale's isspace set.
+ *
+ * @param character The character.
+ *
+ * @returns Whether the character is whitespace.
+ */
+bool isScanfWhitespace(char const character) {
+    return character == ' ' || (character >= '\t' && character <= '\r');
+}
+
+/**
+ * Count the `"%c\n"` records that start within the given bytes (see scanCharacterRecords). Because any whitespace after
+ * a record is skipped, a record starts at the first byte of the input and at every later byte that is not whitespace.
+ * Counts over consecutive ranges of an input can therefore be computed independently and summed.
+ *
+ * @param data The bytes.
+ * @param dataLength The number of bytes.
+ * @param atInputStart Whether the bytes begin at the start of the input.
+ *
+ * @returns The number of records starting within the bytes.
+ */
+size_t countCharacterRecords(char const * const data, size_t const dataLength, bool const atInputStart) {
+    hotGuard(data != NULL || dataLength == 0, "countCharacterRecords: data must not be null");
+
+    if (dataLength == 0) {
+        return 0;
+    }
+
+    size_t recordCount = atInputStart && isScanfWhitespace(data[0]) ? 1 : 0;
+    size_t position = 0;
+#if FILE_X86
+    recordCount += (
+        __builtin_cpu_supports("avx2")
+            ? countNonWhitespaceAvx2(data, dataLength, &position)
+            : countNonWhitespaceSse2(data, dataLength, &position)
+    );
+#endif
+    for (; position < dataLength; position += 1) {
+        if (!isScanfWhitespace(data[position])) {
+            recordCount += 1;
+        }
+    }
+    return recordCount;
+}
+
+/**
+ * Find where the `"%c\n"` records within the given bytes start (see scanCharacterRecords), at close to memory bandwidth
+ * for large buffers. Finding can be resumed across consecutive buffers by passing the same skippingWhitespace flag,
+ * which must start out false at the beginning of the input.
+ *
+ * @param data The bytes to scan.
+ * @param dataLength The number of bytes to scan.
+ * @param skippingWhitespacePtr A pointer to the parse state: whether the previous byte completed a record, such that
+ *                              whitespace is currently being skipped. Updated on return.
+ * @param offsetsOut The buffer into which to store the offset of each record from the start of data, in ascending
+ *                   order.
+ * @param offsetsCapacity The maximum number of records to find.
+ * @param scannedLengthOutPtr Where to store the number of bytes consumed. This is less than dataLength only if
+ *                            offsetsCapacity records were found.
+ *
+ * @returns The number of records found.
+ */
+size_t findCharacterRecordStarts(
+    char const * const data,
+    size_t const dataLength,
+    bool * const skippingWhitespacePtr,
+    size_t * const offsetsOut,
+    size_t const offsetsCapacity,
+    size_t * const scannedLengthOutPtr
+) {
+    hotGuard(data != NULL || dataLength == 0, "findCharacterRecordStarts: data must not be null");
+    hotGuardNotNull(skippingWhitespacePtr, "skippingWhitespacePtr", "findCharacterRecordStarts");
+    hotGuard(offsetsOut != NULL || offsetsCapacity == 0, "findCharacterRecordStarts: offsetsOut must not be null");
+    hotGuardNotNull(scannedLengthOutPtr, "scannedLengthOutPtr", "findCharacterRecordStarts");
+
+    size_t offsetCount = 0;
+    size_t position = 0;
+
+    // The first byte of the input is a record even if it is whitespace; every later record is not
+    if (!*skippingWhitespacePtr && dataLength > 0 && offsetsCapacity > 0) {
+        offsetsOut[0] = 0;
+        offsetCount = 1;
+        position = 1;
+        *skippingWhitespacePtr = true;
+    }
+
+#if FILE_X86
+    if (offsetCount < offsetsCapacity) {
+        position = (
+            __builtin_cpu_supports("avx2")
+                ? findNonWhitespaceAvx2(data, dataLength, position, offsetsOut, offsetsCapacity, &offsetCount)
+                : findNonWhitespaceSse2(data, dataLength, position, offsetsOut, offsetsCapacity, &offsetCount)
+        );
+    }
+#endif
+    while (position < dataLength && offsetCount < offsetsCapacity) {
+        if (!isScanfWhitespace(data[position])) {
+            offsetsOut[offsetCount] = position;
+            offsetCount += 1;
+        }
+        position += 1;
+    }
+
+    *scannedLengthOutPtr = position;
+    return offsetCount;
+}
+
+/**
+ * Parse records from the given bytes with the same semantics as repeatedly scanning them with the fscanf format
+ * `"%c\n"`: each record is a single byte (which may itself be whitespace), and any run of whitespace following a record
+ * is skipped. Parsing can be resumed across consecutive buffers by passing the same skippingWhitespace flag, which must
+ * start out false at the beginning of the input.
+ *
+ * @param data The bytes to parse.
+ * @param dataLength The number of bytes to parse.
+ * @param skippingWhitespacePtr A pointer to the parse state: whether the previous byte completed a record, such that
+ *                              whitespace is currently being skipped. Updated on return.
+ * @param recordsOut The buffer into which to store the parsed records.
+ * @param recordsCapacity The maximum number of records to parse.
+ * @param scannedLengthOutPtr Where to store the number of bytes consumed. This is less than dataLength only if
+ *                            recordsCapacity records were parsed.
+ *
+ * @returns The number of records parsed.
+ */
+size_t scanCharacterRecords(
+    char const * const data,
+    size_t const dataLength,
+    bool * const skippingWhitespacePtr,
+    char * const recordsOut,
+    size_t const recordsCapacity,
+    size_t * const scannedLengthOutPtr
+) {
+    hotGuardNotNull(data, "data", "scanCharacterRecords");
+    hotGuardNotNull(skippingWhitespacePtr, "skippingWhitespacePtr", "scanCharacterRecords");
+    hotGuardNotNull(recordsOut, "recordsOut", "scanCharacterRecords");
+    hotGuardNotNull(scannedLengthOutPtr, "scannedLengthOutPtr", "scanCharacterRecords");
+
+    // Record starts are found a bounded run at a time, then gathered
+    size_t recordStarts[64];
+    size_t recordCount = 0;
+    size_t position = 0;
+    while (position < dataLength && recordCount < recordsCapacity) {
+        size_t const remainingCapacity = recordsCapacity - recordCount;
+        size_t scannedLength;
+        size_t const startCount = findCharacterRecordStarts(
+            &data[position],
+            dataLength - position,
+            skippingWhitespacePtr,
+            recordStarts,
+            remainingCapacity < 64 ? remainingCapacity : 64,
+            &scannedLength
+        );
+
+        for (size_t i = 0; i < startCount; i += 1) {
+            recordsOut[recordCount + i] = data[position + recordStarts[i]];
+        }
+        recordCount += startCount;
+        position += scannedLength;
+    }
+
+    *scannedLengthOutPtr = position;
+    return recordCount;
+}
+
+/**
+ * Create a reader that parses `"%c\n"` records from the given file in blocks. The file should not be read from by any
+ * other means while the reader exists. If the operation fails, abort the program with an error message.
+ *
+ * @param file The file.
+ * @param blockSize The number of bytes to read from the file at once.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The reader. The caller is responsible for destroying it using characterRecordReaderDestroy.
+ */
+struct CharacterRecordReader *characterRecordReaderCreate(
+    FILE * const file,
+    size_t const blockSize,
+    char const * const callerDescription
+) {
+    guardNotNull(file, "file", "characterRecordReaderCreate");
+    guard(blockSize > 0, "characterRecordReaderCreate: blockSize must be positive");
+    guardNotNull(callerDescription, "callerDescription", "characterRecordReaderCreate");
+
+    struct CharacterRecordReader * const reader = safeMalloc(sizeof *reader, callerDescription);
+    reader->file = file;
+    reader->skippingWhitespace = false;
+    reader->reachedEnd = false;
+    reader->block = safeMalloc(sizeof *reader->block * blockSize, callerDescription);
+    reader->blockSize = blockSize;
+    reader->blockLength = 0;
+    reader->blockPosition = 0;
+    reader->stats = NULL;
+    return reader;
+}
+
+/**
+ * Count the bytes the reader reads from its file, and the time spent reading them, in the given counters.
+ *
+ * @param reader The reader.
+ * @param stats The counters, or null to stop counting.
+ */
+void characterRecordReaderSetStats(struct CharacterRecordReader * const reader, struct ThreadStats * const stats) {
+    guardNotNull(reader, "reader", "characterRecordReaderSetStats");
+
+    reader->stats = stats;
+}
+
+/**
+ * Read a batch of `"%c\n"` records. Blocks are read from the file only as needed, and the call returns as soon as at
+ * least one record is available rather than waiting to fill the whole batch. If the operation fails, abort the program
+ * with an error message.
+ *
+ * @param reader The reader.
+ * @param recordsOut The buffer into which to store the records.
+ * @param recordsCapacity The maximum number of records to read. Must be positive.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of records read, or 0 if the end of the file has been reached.
+ */
+size_t characterRecordReaderRead(
+    struct CharacterRecordReader * const reader,
+    char * const recordsOut,
+    size_t const recordsCapacity,
+    char const * const callerDescription
+) {
+    hotGuardNotNull(reader, "reader", "characterRecordReaderRead");
+    hotGuardNotNull(recordsOut, "recordsOut", "characterRecordReaderRead");
+    hotGuard(recordsCapacity > 0, "characterRecordReaderRead: recordsCapacity must be positive");
+    hotGuardNotNull(callerDescription, "callerDescription", "characterRecordReaderRead");
+
+    size_t recordCount = 0;
+    while (recordCount < recordsCapacity) {
+        if (reader->blockPosition == reader->blockLength) {
+            if (recordCount > 0 || reader->reachedEnd) {
+                break;
+            }
+
+            uint64_t const readStartNanoseconds = reader->stats != NULL ? getMonotonicNanoseconds() : 0;
+            reader->blockLength = safeFread(reader->block, 1, reader->blockSize, reader->file, callerDescription);
+            reader->blockPosition = 0;
+            if (reader->stats != NULL) {
+                threadStatsAdd(&reader->stats->byteCount, reader->blockLength);
+                threadStatsAdd(&reader->stats->ioNanoseconds, getMonotonicNanoseconds() - readStartNanoseconds);
+            }
+            if (reader->blockLength == 0) {
+                reader->reachedEnd = true;
+                break;
+            }
+        }
+
+        size_t scannedLength;
+        recordCount += scanCharacterRecords(
+            &reader->block[reader->blockPosition],
+            reader->blockLength - reader->blockPosition,
+            &reader->skippingWhitespace,
+            &recordsOut[recordCount],
+            recordsCapacity - recordCount,
+            &scannedLength
+        );
+        reader->blockPosition += scannedLength;
+    }
+
+    return recordCount;
+}
+
+/**
+ * Destroy the given reader. The underlying file is not closed.
+ *
+ * @param reader The reader.
+ */
+void characterRecordReaderDestroy(struct CharacterRecordReader * const reader) {
+    guardNotNull(reader, "reader", "characterRecordReaderDestroy");
+
+    free(reader->block);
+    free(reader);
+}
+
+/**
+ * A writer that collects output in a large buffer and flushes it straight to a file descriptor with write/writev,
+ * bypassing stdio's per-call format parsing and locking.
+ */
+struct BufferedWriter {
+    int fileDescriptor;
+    char *filePath;
+
+    char *buffer;
+    size_t bufferSize;
+    size_t bufferLength;
+
+    // The number of bytes written before those in the buffer
+    size_t flushedLength;
+
+    struct ThreadStats *stats;
+
+    // Null unless the output is compressed, in which case every byte goes through it on its way to the file
+    struct ParallelGzipWriter *compressor;
+};
+
+static size_t const gzipBlockSize = 131072;
+
+static struct BufferedWriter *createBufferedWriter(
+    int fileDescriptor,
+    char const *filePath,
+    size_t bufferSize,
+    char const *callerDescription
+);
+static void writeBufferedVectors(
+    struct BufferedWriter const *writer,
+    struct iovec *vectors,
+    int vectorCount,
+    char const *callerDescription
+);
+static void writeCompressedBytes(void *writerAsVoidPtr, char const *data, size_t length);
+static void writeAllVectors(
+    struct BufferedWriter const *writer,
+    struct iovec *vectors,
+    int vectorCount,
+    char const *callerDescription
+);
+
+/**
+ * Open (create or truncate) the given file for buffered writing. If the operation fails, abort the program with an
+ * error message.
+ *
+ * @param filePath The file path.
+ * @param bufferSize The size of the write buffer, in bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The writer. The caller is responsible for closing it using bufferedWriterClose.
+ */
+struct BufferedWriter *bufferedWriterOpen(
+    char const * const filePath,
+    size_t const bufferSize,
+    char const * const callerDescription
+) {
+    guardNotNull(filePath, "filePath", "bufferedWriterOpen");
+    guard(bufferSize > 0, "bufferedWriterOpen: bufferSize must be positive");
+    guardNotNull(callerDescription, "callerDescription", "bufferedWriterOpen");
+
+    int const fileDescriptor = safeOpen(filePath, O_WRONLY | O_CREAT | O_TRUNC, 0666, callerDescription);
+    return createBufferedWriter(fileDescriptor, filePath, bufferSize, callerDescription);
+}
+
+/**
+ * Open (creating if necessary) the given file for buffered writing after its first bytes, discarding the rest of the
+ * file. Used to resume output that was cut short. If the file is shorter than the given offset, or the operation fails,
+ * abort the program with an error message.
+ *
+ * @param filePath The file path.
+ * @param offset The number of leading bytes of the file to keep. The writer's offset starts here.
+ * @param bufferSize The size of the write buffer, in bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The writer. The caller is responsible for closing it using bufferedWriterClose.
+ */
+struct BufferedWriter *bufferedWriterOpenAt(
+    char const * const filePath,
+    size_t const offset,
+    size_t const bufferSize,
+    char const * const callerDescription
+) {
+    guardNotNull(filePath, "filePath", "bufferedWriterOpenAt");
+    guard(bufferSize > 0, "bufferedWriterOpenAt: bufferSize must be positive");
+    guardNotNull(callerDescription, "callerDescription", "bufferedWriterOpenAt");
+
+    int const fileDescriptor = safeOpen(filePath, O_WRONLY | O_CREAT, 0666, callerDescription);
+
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0 || (uintmax_t)fileStatus.st_size < (uintmax_t)offset) {
+        abortWithErrorFmt(
+            "%s: File \"%s\" is shorter than the %zu bytes to keep, or could not be inspected using fstat",
+            callerDescription,
+            filePath,
+            offset
+        );
+        return NULL;
+    }
+    safeFtruncate(fileDescriptor, offset, callerDescription);
+    if (lseek(fileDescriptor, (off_t)offset, SEEK_SET) < 0) {
+        int const lseekErrorCode = errno;
+        char const * const lseekErrorMessage = strerror(lseekErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to seek file \"%s\" to offset %zu using lseek (error code: %d; error message: \"%s\")",
+            callerDescription,
+            filePath,
+            offset,
+            lseekErrorCode,
+            lseekErrorMessage
+        );
+        return NULL;
+    }
+
+    struct BufferedWriter * const writer = createBufferedWriter(
+        fileDescriptor,
+        filePath,
+        bufferSize,
+        callerDescription
+    );
+    writer->flushedLength = offset;
+    return writer;
+}
+
+/**
+ * Open (create or truncate) the given file for buffered writing of a gzip stream, compressed on a pool of threads in
+ * independent blocks (see parallelGzipWriterCreate). The bytes written to the writer are the uncompressed bytes; stats
+ * count the compressed bytes written to the file. If the operation fails, abort the program with an error message.
+ *
+ * @param filePath The file path.
+ * @param bufferSize The size of the write buffer, in bytes.
+ * @param threadCount The number of compression threads. Must be positive.
+ * @param level The zlib compression level: 0 (none) to 9 (best), or -1 for zlib's default.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The writer. The caller is responsible for closing it using bufferedWriterClose.
+ */
+struct BufferedWriter *bufferedWriterOpenGzip(
+    char const * const filePath,
+    size_t const bufferSize,
+    size_t const threadCount,
+    int const level,
+    char const * const callerDescription
+) {
+    struct BufferedWriter * const writer = bufferedWriterOpen(filePath, bufferSize, callerDescription);
+    writer->compressor = parallelGzipWriterCreate(
+        gzipBlockSize,
+        threadCount,
+        level,
+        writeCompressedBytes,
+        writer,
+        callerDescription
+    );
+    return writer;
+}
+
+/**
+ * Count the bytes the writer writes to its file, and the time spent writing them, in the given counters.
+ *
+ * @param writer The writer.
+ * @param stats The counters, or null to stop counting.
+ */
+void bufferedWriterSetStats(struct BufferedWriter * const writer, struct ThreadStats * const stats) {
+    guardNotNull(writer, "writer", "bufferedWriterSetStats");
+
+    writer->stats = stats;
+}
+
+/**
+ * Write the given bytes. Small writes are copied into the buffer; a write that does not fit is sent to the file
+ * together with the buffered bytes in a single writev, without copying. If the operation fails, abort the program with
+ * an error message.
+ *
+ * @param writer The writer.
+ * @param data The bytes to write.
+ * @param length The number of bytes to write.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void bufferedWriterWrite(
+    struct BufferedWriter * const writer,
+    char const * const data,
+    size_t const length,
+    char const * const callerDescription
+) {
+    hotGuardNotNull(writer, "writer", "bufferedWriterWrite");
+    hotGuardNotNull(data, "data", "bufferedWriterWrite");
+    hotGuardNotNull(callerDescription, "callerDescription", "bufferedWriterWrite");
+
+    if (length <= writer->bufferSize - writer->bufferLength) {
+        memcpy(&writer->buffer[writer->bufferLength], data, length);
+        writer->bufferLength += length;
+        return;
+    }
+
+    struct iovec vectors[] = {
+        { .iov_base = writer->buffer, .iov_len = writer->bufferLength },
+        { .iov_base = (void *)(uintptr_t)data, .iov_len = length }
+    };
+    writeBufferedVectors(writer, vectors, 2, callerDescription);
+    writer->flushedLength += writer->bufferLength + length;
+    writer->bufferLength = 0;
+}
+
+/**
+ * Reserve space for the given number of bytes at the end of the buffer, flushing first if necessary, so that the
+ * caller can produce output in place. The bytes are not written until committed using bufferedWriterCommit. If the
+ * operation fails, abort the program with an error message.
+ *
+ * @param writer The writer.
+ * @param length The number of bytes to reserve. Must not exceed the buffer size.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns A pointer to the reserved space.
+ */
+char *bufferedWriterReserve(
+    struct BufferedWriter * const writer,
+    size_t const length,
+    char const * const callerDescription
+) {
+    hotGuardNotNull(writer, "writer", "bufferedWriterReserve");
+    hotGuardFmt(
+        length <= writer->bufferSize,
+        "bufferedWriterReserve: length must not exceed the buffer size (length: %zu; buffer size: %zu)",
+        length,
+        writer->bufferSize
+    );
+    hotGuardNotNull(callerDescription, "callerDescription", "bufferedWriterReserve");
+
+    if (length > writer->bufferSize - writer->bufferLength) {
+        bufferedWriterFlush(writer, callerDescription);
+    }
+
+    return &writer->buffer[writer->bufferLength];
+}
+
+/**
+ * Commit bytes produced in space reserved using bufferedWriterReserve.
+ *
+ * @param writer The writer.
+ * @param length The number of bytes to commit. Must not exceed the reserved length.
+ */
+void bufferedWriterCommit(struct BufferedWriter * const writer, size_t const length) {
+    hotGuardNotNull(writer, "writer", "bufferedWriterCommit");
+    hotGuard(
+        length <= writer->bufferSize - writer->bufferLength,
+        "bufferedWriterCommit: length must not exceed the reserved length"
+    );
+
+    writer->bufferLength += length;
+}
+
+/**
+ * Write all buffered bytes to the file. If the operation fails, abort the program with an error message.
+ *
+ * @param writer The writer.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void bufferedWriterFlush(struct BufferedWriter * const writer, char const * const callerDescription) {
+    guardNotNull(writer, "writer", "bufferedWriterFlush");
+    guardNotNull(callerDescription, "callerDescription", "bufferedWriterFlush");
+
+    if (writer->bufferLength == 0) {
+        return;
+    }
+
+    struct iovec vectors[] = {
+        { .iov_base = writer->buffer, .iov_len = writer->bufferLength }
+    };
+    writeBufferedVectors(writer, vectors, 1, callerDescription);
+    writer->flushedLength += writer->bufferLength;
+    writer->bufferLength = 0;
+}
+
+/**
+ * Get the number of bytes written to the writer so far, including those still buffered (and those kept by
+ * bufferedWriterOpenAt). For a compressing writer, this counts the bytes before compression.
+ *
+ * @param writer The writer.
+ *
+ * @returns The number of bytes.
+ */
+size_t bufferedWriterGetOffset(struct BufferedWriter const * const writer) {
+    hotGuardNotNull(writer, "writer", "bufferedWriterGetOffset");
+
+    return writer->flushedLength + writer->bufferLength;
+}
+
+/**
+ * Flush the writer and wait until every byte written so far has reached the storage device. Not supported by
+ * compressing writers, whose output lags behind their input. If the operation fails, abort the program with an error
+ * message.
+ *
+ * @param writer The writer.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void bufferedWriterSync(struct BufferedWriter * const writer, char const * const callerDescription) {
+    guardNotNull(writer, "writer", "bufferedWriterSync");
+    guard(writer->compressor == NULL, "bufferedWriterSync: A compressing writer cannot be synced");
+    guardNotNull(callerDescription, "callerDescription", "bufferedWriterSync");
+
+    bufferedWriterFlush(writer, callerDescription);
+    safeFdatasync(writer->fileDescriptor, callerDescription);
+}
+
+/**
+ * Flush the writer, close its file and free it. Unlike fclose, a failure to write the final bytes or to close the file
+ * is not silently lost: the program is aborted with an error message.
+ *
+ * @param writer The writer.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void bufferedWriterClose(struct BufferedWriter * const writer, char const * const callerDescription) {
+    guardNotNull(writer, "writer", "bufferedWriterClose");
+    guardNotNull(callerDescription, "callerDescription", "bufferedWriterClose");
+
+    bufferedWriterFlush(writer, callerDescription);
+    if (writer->compressor != NULL) {
+        parallelGzipWriterFinish(writer->compressor, callerDescription);
+    }
+
+    if (close(writer->fileDescriptor) != 0) {
+        int const closeErrorCode = errno;
+        char const * const closeErrorMessage = strerror(closeErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to close file \"%s\" using close (error code: %d; error message: \"%s\")",
+            callerDescription,
+            writer->filePath,
+            closeErrorCode,
+            closeErrorMessage
+        );
+        return;
+    }
+
+    free(writer->buffer);
+    free(writer->filePath);
+    free(writer);
+}
+
+static struct BufferedWriter *createBufferedWriter(
+    int const fileDescriptor,
+    char const * const filePath,
+    size_t const bufferSize,
+    char const * const callerDescription
+) {
+    size_t const filePathLength = strlen(filePath);
+
+    struct BufferedWriter * const writer = safeMalloc(sizeof *writer, callerDescription);
+    writer->fileDescriptor = fileDescriptor;
+    writer->filePath = safeMalloc(sizeof *writer->filePath * (filePathLength + 1), callerDescription);
+    memcpy(writer->filePath, filePath, filePathLength + 1);
+    writer->buffer = safeMalloc(sizeof *writer->buffer * bufferSize, callerDescription);
+    writer->bufferSize = bufferSize;
+    writer->bufferLength = 0;
+    writer->flushedLength = 0;
+    writer->stats = NULL;
+    writer->compressor = NULL;
+    return writer;
+}
+
+/**
+ * Write every byte described by the given vectors, through the writer's compressor if it has one. If the operation
+ * fails, abort the program with an error message.
+ */
+static void writeBufferedVectors(
+    struct BufferedWriter const * const writer,
+    struct iovec * const vectors,
+    int const vectorCount,
+    char const * const callerDescription
+) {
+    if (writer->compressor == NULL) {
+        writeAllVectors(writer, vectors, vectorCount, callerDescription);
+        return;
+    }
+
+    for (int i = 0; i < vectorCount; i += 1) {
+        parallelGzipWriterWrite(writer->compressor, vectors[i].iov_base, vectors[i].iov_len, callerDescription);
+    }
+}
+
+/**
+ * The sink of a writer's compressor: write the given compressed bytes to the file.
+ */
+static void writeCompressedBytes(void * const writerAsVoidPtr, char const * const data, size_t const length) {
+    struct BufferedWriter const * const writer = writerAsVoidPtr;
+
+    struct iovec vectors[] = {
+        { .iov_base = (void *)(uintptr_t)data, .iov_len = length }
+    };
+    writeAllVectors(writer, vectors, 1, "writeCompressedBytes");
+}
+
+/**
+ * Write every byte described by the given vectors, retrying after partial writes and interruptions. The vectors are
+ * modified. If the operation fails, abort the program with an error message.
+ */
+static void writeAllVectors(
+    struct BufferedWriter const * const writer,
+    struct iovec *vectors,
+    int vectorCount,
+    char const * const callerDescription
+) {
+    while (vectorCount > 0) {
+        if (vectors->iov_len == 0) {
+            vectors += 1;
+            vectorCount -= 1;
+            continue;
+        }
+
+        uint64_t const writeStartNanoseconds = writer->stats != NULL ? getMonotonicNanoseconds() : 0;
+        ssize_t const writevResult = writev(writer->fileDescriptor, vectors, vectorCount);
+        if (writer->stats != NULL && writevResult > 0) {
+            threadStatsAdd(&writer->stats->byteCount, (uint64_t)writevResult);
+            threadStatsAdd(&writer->stats->ioNanoseconds, getMonotonicNanoseconds() - writeStartNanoseconds);
+        }
+        if (writevResult < 0) {
+            int const writevErrorCode = errno;
+            if (writevErrorCode == EINTR) {
+                continue;
+            }
+            char const * const writevErrorMessage = strerror(writevErrorCode);
+
+            abortWithErrorFmt(
+                "%s: Failed to write to file \"%s\" using writev (error code: %d; error message: \"%s\")",
+                callerDescription,
+                writer->filePath,
+                writevErrorCode,
+                writevErrorMessage
+            );
+            return;
+        }
+
+        size_t writtenLength = (size_t)writevResult;
+        while (vectorCount > 0 && writtenLength >= vectors->iov_len) {
+            writtenLength -= vectors->iov_len;
+            vectors += 1;
+            vectorCount -= 1;
+        }
+        if (vectorCount > 0) {
+            vectors->iov_base = (char *)vectors->iov_base + writtenLength;
+            vectors->iov_len -= writtenLength;
+        }
+    }
+}
+
+#if FILE_X86
+static size_t findNonWhitespaceSse2(
+    char const * const data,
+    size_t const dataLength,
+    size_t const position,
+    size_t * const offsetsOut,
+    size_t const offsetsCapacity,
+    size_t * const offsetCountPtr
+) {
+    size_t offsetCount = *offsetCountPtr;
+    size_t blockPosition = position;
+    for (; blockPosition + 16 <= dataLength; blockPosition += 16) {
+        __m128i const bytes = _mm_loadu_si128((__m128i const *)&data[blockPosition]);
+        unsigned int recordMask = ~getWhitespaceMaskSse2(bytes) & 0xFFFFu;
+
+        while (recordMask != 0) {
+            size_t const offset = blockPosition + (size_t)__builtin_ctz(recordMask);
+            offsetsOut[offsetCount] = offset;
+            offsetCount += 1;
+            recordMask &= recordMask - 1;
+
+            if (offsetCount == offsetsCapacity) {
+                *offsetCountPtr = offsetCount;
+                return offset + 1;
+            }
+        }
+    }
+
+    *offsetCountPtr = offsetCount;
+    return blockPosition;
+}
+
+__attribute__((target("avx2")))
+static size_t findNonWhitespaceAvx2(
+    char const * const data,
+    size_t const dataLength,
+    size_t const position,
+    size_t * const offsetsOut,
+    size_t const offsetsCapacity,
+    size_t * const offsetCountPtr
+) {
+    size_t offsetCount = *offsetCountPtr;
+    size_t blockPosition = position;
+    for (; blockPosition + 32 <= dataLength; blockPosition += 32) {
+        __m256i const bytes = _mm256_loadu_si256((__m256i const *)&data[blockPosition]);
+        unsigned int recordMask = ~getWhitespaceMaskAvx2(bytes);
+
+        while (recordMask != 0) {
+            size_t const offset = blockPosition + (size_t)__builtin_ctz(recordMask);
+            offsetsOut[offsetCount] = offset;
+            offsetCount += 1;
+            recordMask &= recordMask - 1;
+
+            if (offsetCount == offsetsCapacity) {
+                *offsetCountPtr = offsetCount;
+                return offset + 1;
+            }
+        }
+    }
+
+    *offsetCountPtr = offsetCount;
+    return blockPosition;
+}
+
+static size_t countNonWhitespaceSse2(
+    char const * const data,
+    size_t const dataLength,
+    size_t * const scannedLengthOutPtr
+) {
+    size_t count = 0;
+    size_t position = 0;
+    for (; position + 16 <= dataLength; position += 16) {
+        __m128i const bytes = _mm_loadu_si128((__m128i const *)&data[position]);
+        count += 16 - (size_t)__builtin_popcount(getWhitespaceMaskSse2(bytes));
+    }
+
+    *scannedLengthOutPtr = position;
+    return count;
+}
+
+__attribute__((target("avx2")))
+static size_t countNonWhitespaceAvx2(
+    char const * const data,
+    size_t const dataLength,
+    size_t * const scannedLengthOutPtr
+) {
+    size_t count = 0;
+    size_t position = 0;
+    for (; position + 32 <= dataLength; position += 32) {
+        __m256i const bytes = _mm256_loadu_si256((__m256i const *)&data[position]);
+        count += 32 - (size_t)__builtin_popcount(getWhitespaceMaskAvx2(bytes));
+    }
+
+    *scannedLengthOutPtr = position;
+    return count;
+}
+
+/**
+ * Get the mask of which of the given 16 bytes are whitespace (see isScanfWhitespace), one bit per byte.
+ */
+static unsigned int getWhitespaceMaskSse2(__m128i const bytes) {
+    // Unsigned (byte - '\t') <= ('\r' - '\t') selects '\t' through '\r'
+    __m128i const offsetFromTab = _mm_sub_epi8(bytes, _mm_set1_epi8('\t'));
+    __m128i const isControlWhitespace = _mm_cmpeq_epi8(
+        _mm_min_epu8(offsetFromTab, _mm_set1_epi8('\r' - '\t')),
+        offsetFromTab
+    );
+    __m128i const isWhitespace = _mm_or_si128(isControlWhitespace, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')));
+    return (unsigned int)_mm_movemask_epi8(isWhitespace);
+}
+
+/**
+ * Get the mask of which of the given 32 bytes are whitespace (see isScanfWhitespace), one bit per byte.
+ */
+__attribute__((target("avx2")))
+static unsigned int getWhitespaceMaskAvx2(__m256i const bytes) {
+    __m256i const offsetFromTab = _mm256_sub_epi8(bytes, _mm256_set1_epi8('\t'));
+    __m256i const isControlWhitespace = _mm256_cmpeq_epi8(
+        _mm256_min_epu8(offsetFromTab, _mm256_set1_epi8('\r' - '\t')),
+        offsetFromTab
+    );
+    __m256i const isWhitespace = _mm256_or_si256(
+        isControlWhitespace,
+        _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '))
+    );
+    return (unsigned int)_mm256_movemask_epi8(isWhitespace);
+}
+#endif
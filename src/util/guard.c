@@ -12,68 +12,66 @@
  * message.
  *
  * @param expression The expression to verify is true.
- * @param errorMessage The error message.
+ * @param errorMessageFormat The error message format (printf).
+ * @param errorMessageFormatArgs The error message format arguments (printf).
  */
-void guard(bool const expression, char const * const errorMessage) {
-    if (errorMessage == NULL) {
-        abortWithError("guard: errorMessage must not be null");
-        return;
+void guardFmtVA(bool const expression, char const * const errorMessageFormat, va_list errorMessageFormatArgs) {
+    if (errorMessageFormat == NULL) {
+        abortWithError("guardFmtVA: errorMessageFormat must not be null");
     }
 
     if (expression) {
         return;
     }
 
-    abortWithError(errorMessage);
+    abortWithErrorFmtVA(errorMessageFormat, errorMessageFormatArgs);
 }
 
 /**
- * Ensure that the given expression involving a parameter is true. If it is false, abort the program with an error
- * message.
+ * Abort the program with the error message of a failed guard.
  *
- * @param expression The expression to verify is true.
- * @param errorMessageFormat The error message format (printf).
- * @param ... The error message format arguments (printf).
+ * @param errorMessage The error message.
  */
-void guardFmt(bool const expression, char const * const errorMessageFormat, ...) {
-    va_list errorMessageFormatArgs;
-    va_start(errorMessageFormatArgs, errorMessageFormat);
-    guardFmtVA(expression, errorMessageFormat, errorMessageFormatArgs);
-    va_end(errorMessageFormatArgs);
+void guardFailed(char const * const errorMessage) {
+    if (errorMessage == NULL) {
+        abortWithError("guardFailed: errorMessage must not be null");
+    }
+
+    abortWithError(errorMessage);
 }
 
 /**
- * Ensure that the given expression involving a parameter is true. If it is false, abort the program with an error
- * message.
+ * Abort the program with the error message of a failed guardFmt.
  *
- * @param expression The expression to verify is true.
  * @param errorMessageFormat The error message format (printf).
- * @param errorMessageFormatArgs The error message format arguments (printf).
+ * @param ... The error message format arguments (printf).
  */
-void guardFmtVA(bool const expression, char const * const errorMessageFormat, va_list errorMessageFormatArgs) {
+void guardFmtFailed(char const * const errorMessageFormat, ...) {
     if (errorMessageFormat == NULL) {
-        abortWithError("guardFmtVA: errorMessageFormat must not be null");
-        return;
+        abortWithError("guardFmtFailed: errorMessageFormat must not be null");
     }
 
-    if (expression) {
-        return;
-    }
-
-    abortWithErrorFmtVA(errorMessageFormat, errorMessageFormatArgs);
+    // Formatted here rather than by abortWithErrorFmtVA, which never returns, so that the arguments can be ended first.
+    // Built on the stack as abortWithErrorFmtVA does, since short messages then need no allocation
+    struct StringBuilder errorMessage;
+    stringBuilderInit(&errorMessage);
+    va_list errorMessageFormatArgs;
+    va_start(errorMessageFormatArgs, errorMessageFormat);
+    stringBuilderAppendFmtVA(&errorMessage, "guardFmtFailed", errorMessageFormat, errorMessageFormatArgs);
+    va_end(errorMessageFormatArgs);
+    abortWithError(errorMessage.data);
 }
 
 /**
- * Ensure that the given object supplied by a parameter is not null. If it is null, abort the program with an error
- * message.
+ * Abort the program with the error message of a failed guardNotNull.
  *
- * @param object The object to verify is not null.
- * @param paramName The name of the parameter supplying the object.
+ * @param paramName The name of the parameter that supplied a null object.
  * @param callerName The name of the calling function.
  */
-void guardNotNull(void const * const object, char const * const paramName, char const * const callerName) {
-    guard(paramName != NULL, "guardNotNull: paramName must not be null");
-    guard(callerName != NULL, "guardNotNull: callerName must not be null");
+void guardNotNullFailed(char const * const paramName, char const * const callerName) {
+    if (paramName == NULL || callerName == NULL) {
+        abortWithError("guardNotNullFailed: paramName and callerName must not be null");
+    }
 
-    guardFmt(object != NULL, "%s: %s must not be null", callerName, paramName);
+    abortWithErrorFmt("%s: %s must not be null", callerName, paramName);
 }
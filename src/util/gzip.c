@@ -0,0 +1,643 @@
+#define _GNU_SOURCE
+#define ZLIB_CONST
+
+#include "../../include/util/gzip.h"
+
+#include "../../include/util/memory.h"
+#include "../../include/util/file.h"
+#include "../../include/util/thread.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include <zlib.h>
+
+/**
+ * The state behind a stream opened by safeFopenDecoded.
+ */
+struct DecodedFile {
+    char const *filePath;
+    gzFile file;
+};
+
+/**
+ * A decoder for a gzip stream that arrives a piece at a time, such as the reads of a pipe.
+ */
+struct GzipDecoder {
+    char const *filePath;
+    z_stream stream;
+
+    // Whether the decoder is part way through a member, rather than before the first or after the last one decoded
+    bool inMember;
+
+    // Whether the stream has been found to end with bytes that do not begin another member
+    bool ignoringRest;
+};
+
+/**
+ * One block of a ParallelGzipWriter's input and the gzip member it is compressed into. A block is filled by the
+ * writer's thread, compressed by a pool task, and then handed to the sink by the writer's thread, so it is only ever
+ * touched by one thread at a time.
+ */
+struct GzipBlock {
+    struct ParallelGzipWriter *writer;
+
+    char *input;
+    size_t inputLength;
+
+    char *output;
+    size_t outputCapacity;
+    size_t outputLength;
+
+    // Reused for every member compressed in this block
+    z_stream stream;
+
+    // Whether the block has been submitted for compression and not yet handed to the sink
+    bool busy;
+    struct Event compressed;
+};
+
+/**
+ * A writer that compresses its input in fixed-size blocks on a pool of threads, each block into an independent gzip
+ * member (as pigz does), and hands the members to a sink in order. Concatenated gzip members are a valid gzip stream.
+ */
+struct ParallelGzipWriter {
+    size_t blockSize;
+    int level;
+
+    GzipOutputSink sink;
+    void *sinkArg;
+
+    struct WorkerPool *pool;
+
+    struct GzipBlock *blocks;
+    size_t blockCount;
+    size_t fillingBlockIndex;
+    size_t oldestBlockIndex;
+    bool anyBlockSubmitted;
+};
+
+static unsigned int const decodedFileBufferSize = 131072;
+static size_t const gzipBlocksPerThread = 2;
+
+static ssize_t readDecodedFile(void *cookie, char *buffer, size_t length);
+static int closeDecodedFile(void *cookie);
+static size_t inflateGzipPiece(
+    struct GzipDecoder *decoder,
+    char const *input,
+    size_t inputLength,
+    size_t *consumedLengthOutPtr,
+    char *output,
+    size_t outputCapacity,
+    char const *callerDescription
+);
+static void submitGzipBlock(struct ParallelGzipWriter *writer, char const *callerDescription);
+static void sinkOldestGzipBlock(struct ParallelGzipWriter *writer, bool wait, char const *callerDescription);
+static void compressGzipBlockTask(void *blockAsVoidPtr);
+
+/**
+ * Determine whether the given bytes begin with the gzip magic bytes.
+ *
+ * @param data The bytes.
+ * @param dataLength The number of bytes.
+ *
+ * @returns True if the bytes begin like a gzip file, or false otherwise.
+ */
+bool hasGzipMagic(char const * const data, size_t const dataLength) {
+    guard(data != NULL || dataLength == 0, "hasGzipMagic: data must not be null");
+
+    return dataLength >= 2 && (unsigned char)data[0] == 0x1fu && (unsigned char)data[1] == 0x8bu;
+}
+
+/**
+ * Determine whether the given file is a regular file that begins with the gzip magic bytes. Other files (pipes, FIFOs,
+ * devices, etc.) are not opened, so that no data is consumed, and are reported as not gzip files. If the file cannot be
+ * opened, abort the program with an error message.
+ *
+ * @param filePath The file path.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns True if the file is a regular gzip file, or false otherwise.
+ */
+bool isGzipFile(char const * const filePath, char const * const callerDescription) {
+    guardNotNull(filePath, "filePath", "isGzipFile");
+    guardNotNull(callerDescription, "callerDescription", "isGzipFile");
+
+    struct stat pathStatus;
+    if (stat(filePath, &pathStatus) != 0 || !S_ISREG(pathStatus.st_mode)) {
+        return false;
+    }
+
+    int const fileDescriptor = safeOpen(filePath, O_RDONLY, 0, callerDescription);
+    char magic[2];
+    size_t const magicLength = safePread(fileDescriptor, magic, sizeof magic, 0, callerDescription);
+    safeClose(fileDescriptor, callerDescription);
+
+    return hasGzipMagic(magic, magicLength);
+}
+
+/**
+ * Open the file for reading, decoding it with zlib if it is gzip-compressed. Whether it is is detected from its first
+ * bytes, so this works for pipes and FIFOs as well; any other file is read as is. Concatenated gzip members are decoded
+ * one after another. If the operation fails, or the file later turns out to be corrupt, abort the program with an error
+ * message.
+ *
+ * @param filePath The file path, which must remain valid until the file is closed.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The file, from which the decoded bytes are read. The caller is responsible for closing it using fclose.
+ */
+FILE *safeFopenDecoded(char const * const filePath, char const * const callerDescription) {
+    guardNotNull(filePath, "filePath", "safeFopenDecoded");
+    guardNotNull(callerDescription, "callerDescription", "safeFopenDecoded");
+
+    int const fileDescriptor = safeOpen(filePath, O_RDONLY, 0, callerDescription);
+
+    gzFile const gzipFile = gzdopen(fileDescriptor, "rb");
+    if (gzipFile == NULL) {
+        safeClose(fileDescriptor, callerDescription);
+        abortWithErrorFmt(
+            "%s: Failed to open file \"%s\" for decoding using gzdopen",
+            callerDescription,
+            filePath
+        );
+        return NULL;
+    }
+    // Fewer, larger reads; only fails if called after the first read
+    gzbuffer(gzipFile, decodedFileBufferSize);
+
+    struct DecodedFile * const decodedFile = safeMalloc(sizeof *decodedFile, callerDescription);
+    decodedFile->filePath = filePath;
+    decodedFile->file = gzipFile;
+
+    cookie_io_functions_t const functions = {
+        .read = readDecodedFile,
+        .write = NULL,
+        .seek = NULL,
+        .close = closeDecodedFile
+    };
+    FILE * const file = fopencookie(decodedFile, "r", functions);
+    if (file == NULL) {
+        int const fopencookieErrorCode = errno;
+        char const * const fopencookieErrorMessage = strerror(fopencookieErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to open file \"%s\" using fopencookie (error code: %d; error message: \"%s\")",
+            callerDescription,
+            filePath,
+            fopencookieErrorCode,
+            fopencookieErrorMessage
+        );
+        return NULL;
+    }
+
+    return file;
+}
+
+static ssize_t readDecodedFile(void * const cookie, char * const buffer, size_t const length) {
+    struct DecodedFile * const decodedFile = cookie;
+
+    unsigned int const readCapacity = length < INT_MAX ? (unsigned int)length : (unsigned int)INT_MAX;
+    int const readLength = gzread(decodedFile->file, buffer, readCapacity);
+
+    // A truncated gzip file reads as ending early, with the error only recorded for the final, empty read
+    int gzipErrorCode = Z_OK;
+    char const * const gzipErrorMessage = readLength <= 0 ? gzerror(decodedFile->file, &gzipErrorCode) : NULL;
+    if (readLength < 0 || gzipErrorCode != Z_OK) {
+        abortWithErrorFmt(
+            "readDecodedFile: Failed to decode file \"%s\" using gzread (error code: %d; error message: \"%s\")",
+            decodedFile->filePath,
+            gzipErrorCode,
+            gzipErrorMessage
+        );
+        return -1;
+    }
+
+    return (ssize_t)readLength;
+}
+
+static int closeDecodedFile(void * const cookie) {
+    struct DecodedFile * const decodedFile = cookie;
+
+    int const closeResult = gzclose_r(decodedFile->file);
+    free(decodedFile);
+    return closeResult == Z_OK ? 0 : -1;
+}
+
+/**
+ * Create a decoder for a gzip stream that is handed to it a piece at a time, for inputs that cannot be read through
+ * safeFopenDecoded (e.g. a FIFO read with non-blocking reads). The stream must begin with the gzip magic bytes.
+ * Concatenated gzip members are decoded one after another, and, as gzread does, anything after a member that does not
+ * begin another member is ignored. If the operation fails, abort the program with an error message.
+ *
+ * @param filePath The path of the file the stream is read from, which must remain valid until the decoder is
+ *                 destroyed. Only used in error messages.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The decoder. The caller is responsible for destroying it using gzipDecoderDestroy.
+ */
+struct GzipDecoder *gzipDecoderCreate(char const * const filePath, char const * const callerDescription) {
+    guardNotNull(filePath, "filePath", "gzipDecoderCreate");
+    guardNotNull(callerDescription, "callerDescription", "gzipDecoderCreate");
+
+    struct GzipDecoder * const decoder = safeMalloc(sizeof *decoder, callerDescription);
+    decoder->filePath = filePath;
+    decoder->stream.zalloc = Z_NULL;
+    decoder->stream.zfree = Z_NULL;
+    decoder->stream.opaque = Z_NULL;
+    decoder->stream.next_in = Z_NULL;
+    decoder->stream.avail_in = 0;
+    // 16 more window bits accepts only the gzip wrapper
+    int const initResult = inflateInit2(&decoder->stream, MAX_WBITS + 16);
+    if (initResult != Z_OK) {
+        abortWithErrorFmt(
+            "%s: Failed to initialize decoding of file \"%s\" using inflateInit2 (error code: %d)",
+            callerDescription,
+            filePath,
+            initResult
+        );
+        return NULL;
+    }
+    decoder->inMember = false;
+    decoder->ignoringRest = false;
+    return decoder;
+}
+
+/**
+ * Decode as much of the given piece of the stream as fits in the output. Bytes that are consumed without producing
+ * output (e.g. member headers) are still reported as consumed, so the caller should call again with the rest of the
+ * piece while any remains. If the stream is corrupt, abort the program with an error message.
+ *
+ * @param decoder The decoder.
+ * @param input The next piece of the stream.
+ * @param inputLength The length of the piece.
+ * @param consumedLengthOutPtr Where to store the number of bytes of the piece that were consumed.
+ * @param output The buffer to decode into.
+ * @param outputCapacity The capacity of the buffer.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of decoded bytes stored in the buffer.
+ */
+size_t gzipDecoderDecode(
+    struct GzipDecoder * const decoder,
+    char const * const input,
+    size_t const inputLength,
+    size_t * const consumedLengthOutPtr,
+    char * const output,
+    size_t const outputCapacity,
+    char const * const callerDescription
+) {
+    guardNotNull(decoder, "decoder", "gzipDecoderDecode");
+    guard(input != NULL || inputLength == 0, "gzipDecoderDecode: input must not be null");
+    guardNotNull(consumedLengthOutPtr, "consumedLengthOutPtr", "gzipDecoderDecode");
+    guard(output != NULL || outputCapacity == 0, "gzipDecoderDecode: output must not be null");
+    guardNotNull(callerDescription, "callerDescription", "gzipDecoderDecode");
+
+    size_t consumedLength = 0;
+    size_t decodedLength = 0;
+    while (consumedLength < inputLength && decodedLength < outputCapacity && !decoder->ignoringRest) {
+        size_t const remainingLength = inputLength - consumedLength;
+        if (!decoder->inMember) {
+            // A lone 0x1f may yet begin another member; inflate checks the rest of its header
+            bool const beginsMember = (
+                hasGzipMagic(&input[consumedLength], remainingLength)
+                || (remainingLength == 1 && (unsigned char)input[consumedLength] == 0x1fu)
+            );
+            if (!beginsMember) {
+                decoder->ignoringRest = true;
+                break;
+            }
+            inflateReset(&decoder->stream);
+            decoder->inMember = true;
+        }
+
+        size_t pieceConsumedLength;
+        decodedLength += inflateGzipPiece(
+            decoder,
+            &input[consumedLength],
+            remainingLength,
+            &pieceConsumedLength,
+            &output[decodedLength],
+            outputCapacity - decodedLength,
+            callerDescription
+        );
+        consumedLength += pieceConsumedLength;
+    }
+
+    *consumedLengthOutPtr = decoder->ignoringRest ? inputLength : consumedLength;
+    return decodedLength;
+}
+
+/**
+ * Check that the stream did not end part way through a member, once all of it has been handed to the decoder. If it
+ * did, abort the program with an error message.
+ *
+ * @param decoder The decoder.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void gzipDecoderFinish(struct GzipDecoder * const decoder, char const * const callerDescription) {
+    guardNotNull(decoder, "decoder", "gzipDecoderFinish");
+    guardNotNull(callerDescription, "callerDescription", "gzipDecoderFinish");
+
+    if (decoder->inMember) {
+        abortWithErrorFmt(
+            "%s: Failed to decode file \"%s\" using inflate: the file ends part way through a gzip member",
+            callerDescription,
+            decoder->filePath
+        );
+    }
+}
+
+/**
+ * Destroy the decoder.
+ *
+ * @param decoder The decoder.
+ */
+void gzipDecoderDestroy(struct GzipDecoder * const decoder) {
+    guardNotNull(decoder, "decoder", "gzipDecoderDestroy");
+
+    inflateEnd(&decoder->stream);
+    free(decoder);
+}
+
+/**
+ * Decode the given bytes of the member being decoded until the member ends, the bytes run out, or the output is full.
+ *
+ * @returns The number of decoded bytes stored in the output.
+ */
+static size_t inflateGzipPiece(
+    struct GzipDecoder * const decoder,
+    char const * const input,
+    size_t const inputLength,
+    size_t * const consumedLengthOutPtr,
+    char * const output,
+    size_t const outputCapacity,
+    char const * const callerDescription
+) {
+    z_stream * const streamPtr = &decoder->stream;
+    uInt const availableInput = inputLength < UINT_MAX ? (uInt)inputLength : UINT_MAX;
+    uInt const availableOutput = outputCapacity < UINT_MAX ? (uInt)outputCapacity : UINT_MAX;
+    streamPtr->next_in = (Bytef const *)input;
+    streamPtr->avail_in = availableInput;
+    streamPtr->next_out = (Bytef *)output;
+    streamPtr->avail_out = availableOutput;
+
+    // Both buffers have room, so inflate always makes progress
+    int const inflateResult = inflate(streamPtr, Z_NO_FLUSH);
+    if (inflateResult != Z_OK && inflateResult != Z_STREAM_END) {
+        abortWithErrorFmt(
+            "%s: Failed to decode file \"%s\" using inflate (error code: %d; error message: \"%s\")",
+            callerDescription,
+            decoder->filePath,
+            inflateResult,
+            streamPtr->msg != NULL ? streamPtr->msg : zError(inflateResult)
+        );
+        return 0;
+    }
+    if (inflateResult == Z_STREAM_END) {
+        decoder->inMember = false;
+    }
+
+    *consumedLengthOutPtr = availableInput - streamPtr->avail_in;
+    return availableOutput - streamPtr->avail_out;
+}
+
+/**
+ * Create a writer that compresses its input into a gzip stream on a pool of threads. The input is split into blocks of
+ * the given size, and each block is compressed independently into a gzip member, so compression scales with the number
+ * of threads at the cost of a slightly worse ratio than compressing the whole input as one member. Compressed members
+ * are handed to the sink on the calling thread, in order. If the operation fails, abort the program with an error
+ * message.
+ *
+ * @param blockSize The number of input bytes compressed into each member. Must be positive.
+ * @param threadCount The number of compression threads. Must be positive.
+ * @param level The zlib compression level: 0 (none) to 9 (best), or Z_DEFAULT_COMPRESSION.
+ * @param sink The function to which the compressed bytes are handed, in order.
+ * @param sinkArg The first argument to pass to the sink.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The writer. The caller is responsible for finishing it using parallelGzipWriterFinish.
+ */
+struct ParallelGzipWriter *parallelGzipWriterCreate(
+    size_t const blockSize,
+    size_t const threadCount,
+    int const level,
+    GzipOutputSink const sink,
+    void * const sinkArg,
+    char const * const callerDescription
+) {
+    guard(blockSize > 0 && blockSize <= UINT_MAX, "parallelGzipWriterCreate: blockSize is out of range");
+    guard(threadCount > 0, "parallelGzipWriterCreate: threadCount must be positive");
+    guard(
+        level == Z_DEFAULT_COMPRESSION || (level >= 0 && level <= 9),
+        "parallelGzipWriterCreate: level is out of range"
+    );
+    guard(sink != NULL, "parallelGzipWriterCreate: sink must not be null");
+    guardNotNull(callerDescription, "callerDescription", "parallelGzipWriterCreate");
+
+    struct ParallelGzipWriter * const writer = safeMalloc(sizeof *writer, callerDescription);
+    writer->blockSize = blockSize;
+    writer->level = level;
+    writer->sink = sink;
+    writer->sinkArg = sinkArg;
+    writer->pool = workerPoolCreate(threadCount, NULL, callerDescription);
+
+    // Enough blocks that every thread has one to compress while the calling thread fills and sinks others
+    writer->blockCount = threadCount * gzipBlocksPerThread;
+    writer->blocks = safeMalloc(sizeof *writer->blocks * writer->blockCount, callerDescription);
+    for (size_t i = 0; i < writer->blockCount; i += 1) {
+        struct GzipBlock * const blockPtr = &writer->blocks[i];
+
+        blockPtr->writer = writer;
+        blockPtr->stream.zalloc = Z_NULL;
+        blockPtr->stream.zfree = Z_NULL;
+        blockPtr->stream.opaque = Z_NULL;
+        // 16 more window bits selects the gzip wrapper rather than zlib's
+        int const initResult = deflateInit2(
+            &blockPtr->stream,
+            level,
+            Z_DEFLATED,
+            MAX_WBITS + 16,
+            8,
+            Z_DEFAULT_STRATEGY
+        );
+        if (initResult != Z_OK) {
+            abortWithErrorFmt(
+                "%s: Failed to initialize compression using deflateInit2 (error code: %d)",
+                callerDescription,
+                initResult
+            );
+            return NULL;
+        }
+
+        blockPtr->input = safeMalloc(sizeof *blockPtr->input * blockSize, callerDescription);
+        blockPtr->inputLength = 0;
+        blockPtr->outputCapacity = deflateBound(&blockPtr->stream, (uLong)blockSize);
+        blockPtr->output = safeMalloc(sizeof *blockPtr->output * blockPtr->outputCapacity, callerDescription);
+        blockPtr->outputLength = 0;
+        blockPtr->busy = false;
+        eventInit(&blockPtr->compressed);
+    }
+    writer->fillingBlockIndex = 0;
+    writer->oldestBlockIndex = 0;
+    writer->anyBlockSubmitted = false;
+    return writer;
+}
+
+/**
+ * Write the given bytes, submitting each block for compression as it fills. Blocks already compressed are handed to
+ * the sink along the way. Only waits for compression when every block is in use. If the operation fails, abort the
+ * program with an error message.
+ *
+ * @param writer The writer.
+ * @param data The bytes to write.
+ * @param length The number of bytes to write.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void parallelGzipWriterWrite(
+    struct ParallelGzipWriter * const writer,
+    char const * const data,
+    size_t const length,
+    char const * const callerDescription
+) {
+    guardNotNull(writer, "writer", "parallelGzipWriterWrite");
+    guard(data != NULL || length == 0, "parallelGzipWriterWrite: data must not be null");
+    guardNotNull(callerDescription, "callerDescription", "parallelGzipWriterWrite");
+
+    size_t writtenLength = 0;
+    while (writtenLength < length) {
+        struct GzipBlock * const blockPtr = &writer->blocks[writer->fillingBlockIndex];
+
+        size_t const freeLength = writer->blockSize - blockPtr->inputLength;
+        size_t const copyLength = length - writtenLength < freeLength ? length - writtenLength : freeLength;
+        memcpy(&blockPtr->input[blockPtr->inputLength], &data[writtenLength], copyLength);
+        blockPtr->inputLength += copyLength;
+        writtenLength += copyLength;
+
+        if (blockPtr->inputLength == writer->blockSize) {
+            submitGzipBlock(writer, callerDescription);
+        }
+    }
+}
+
+/**
+ * Compress the remaining bytes, hand every remaining member to the sink, and free the writer. Even no input at all
+ * produces one (empty) member, so the output is always a valid gzip stream. If the operation fails, abort the program
+ * with an error message.
+ *
+ * @param writer The writer.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void parallelGzipWriterFinish(struct ParallelGzipWriter * const writer, char const * const callerDescription) {
+    guardNotNull(writer, "writer", "parallelGzipWriterFinish");
+    guardNotNull(callerDescription, "callerDescription", "parallelGzipWriterFinish");
+
+    if (writer->blocks[writer->fillingBlockIndex].inputLength > 0 || !writer->anyBlockSubmitted) {
+        submitGzipBlock(writer, callerDescription);
+    }
+    while (writer->blocks[writer->oldestBlockIndex].busy) {
+        sinkOldestGzipBlock(writer, true, callerDescription);
+    }
+
+    workerPoolDestroy(writer->pool, callerDescription);
+
+    for (size_t i = 0; i < writer->blockCount; i += 1) {
+        struct GzipBlock * const blockPtr = &writer->blocks[i];
+
+        deflateEnd(&blockPtr->stream);
+        free(blockPtr->input);
+        free(blockPtr->output);
+    }
+    free(writer->blocks);
+    free(writer);
+}
+
+/**
+ * Submit the block being filled for compression and move on to the next block, first handing the oldest member to the
+ * sink if that block is still in use, along with any other members that are already compressed.
+ */
+static void submitGzipBlock(struct ParallelGzipWriter * const writer, char const * const callerDescription) {
+    struct GzipBlock * const blockPtr = &writer->blocks[writer->fillingBlockIndex];
+
+    blockPtr->busy = true;
+    writer->anyBlockSubmitted = true;
+    workerPoolSubmit(writer->pool, compressGzipBlockTask, blockPtr, callerDescription);
+
+    writer->fillingBlockIndex = (writer->fillingBlockIndex + 1) % writer->blockCount;
+    if (writer->blocks[writer->fillingBlockIndex].busy) {
+        // Every block is in use, and the next one to fill is the oldest
+        sinkOldestGzipBlock(writer, true, callerDescription);
+    }
+    while (
+        writer->blocks[writer->oldestBlockIndex].busy
+        && eventTryWait(&writer->blocks[writer->oldestBlockIndex].compressed)
+    ) {
+        sinkOldestGzipBlock(writer, false, callerDescription);
+    }
+}
+
+/**
+ * Hand the oldest block's member to the sink and free the block up for filling, first waiting for it to be compressed
+ * unless the caller already has.
+ */
+static void sinkOldestGzipBlock(
+    struct ParallelGzipWriter * const writer,
+    bool const wait,
+    char const * const callerDescription
+) {
+    struct GzipBlock * const blockPtr = &writer->blocks[writer->oldestBlockIndex];
+    assert(blockPtr->busy);
+
+    if (wait) {
+        eventWait(&blockPtr->compressed, callerDescription);
+    }
+    writer->sink(writer->sinkArg, blockPtr->output, blockPtr->outputLength);
+    blockPtr->inputLength = 0;
+    blockPtr->busy = false;
+    writer->oldestBlockIndex = (writer->oldestBlockIndex + 1) % writer->blockCount;
+}
+
+static void compressGzipBlockTask(void * const blockAsVoidPtr) {
+    assert(blockAsVoidPtr != NULL);
+    struct GzipBlock * const blockPtr = blockAsVoidPtr;
+
+    z_stream * const streamPtr = &blockPtr->stream;
+    int const resetResult = deflateReset(streamPtr);
+    streamPtr->next_in = (Bytef *)blockPtr->input;
+    streamPtr->avail_in = (uInt)blockPtr->inputLength;
+    streamPtr->next_out = (Bytef *)blockPtr->output;
+    streamPtr->avail_out = (uInt)blockPtr->outputCapacity;
+
+    // The output is sized by deflateBound, so the whole member is produced in one call
+    int const deflateResult = resetResult == Z_OK ? deflate(streamPtr, Z_FINISH) : resetResult;
+    if (deflateResult != Z_STREAM_END) {
+        abortWithErrorFmt(
+            "compressGzipBlockTask: Failed to compress %zu bytes using deflate (error code: %d)",
+            blockPtr->inputLength,
+            deflateResult
+        );
+        return;
+    }
+    blockPtr->outputLength = blockPtr->outputCapacity - streamPtr->avail_out;
+
+    eventSet(&blockPtr->compressed, "compressGzipBlockTask");
+}
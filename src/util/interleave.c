@@ -0,0 +1,338 @@
+#include "../../include/util/interleave.h"
+
+#include "../../include/util/guard.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define INTERLEAVE_X86 1
+#include <immintrin.h>
+#else
+#define INTERLEAVE_X86 0
+#endif
+
+/*
+ * A two-byte record is a non-whitespace character followed by a newline, which is exactly what `"%c\n"` reads and what
+ * hw5 writes. When every input consists of such records, interleaving them is a transpose of 16-bit units: record r of
+ * input i lands at unit (r * inputCount + i) of the output. The kernels below perform that transpose with vector
+ * shuffles for the common input counts and fall back to a scalar unit copy otherwise.
+ */
+
+static void interleaveTwoByteRecordsScalar(
+    char const * const *inputs,
+    size_t inputCount,
+    size_t recordOffset,
+    size_t recordCount,
+    char *output
+);
+
+#if INTERLEAVE_X86
+static bool isTwoByteCharacterRecordLayoutSse2(char const *data, size_t length);
+
+static size_t interleaveTwoInputsSse2(char const *input0, char const *input1, size_t recordCount, char *output);
+static size_t interleaveTwoInputsAvx2(char const *input0, char const *input1, size_t recordCount, char *output);
+static size_t interleaveThreeInputsSsse3(char const * const *inputs, size_t recordCount, char *output);
+static size_t interleaveFourInputsSse2(char const * const *inputs, size_t recordCount, char *output);
+static size_t interleaveFourInputsAvx2(char const * const *inputs, size_t recordCount, char *output);
+static void storeFourInputRoundsAvx2(__m256i units01, __m256i units23, char *output);
+#endif
+
+/**
+ * Determine whether the given bytes consist entirely of two-byte records: a non-whitespace character followed by a
+ * newline. Such bytes parse with `"%c\n"` to exactly one record per two bytes.
+ *
+ * @param data The bytes.
+ * @param length The number of bytes.
+ *
+ * @returns Whether the layout was verified.
+ */
+bool isTwoByteCharacterRecordLayout(char const * const data, size_t const length) {
+    guard(data != NULL || length == 0, "isTwoByteCharacterRecordLayout: data must not be null");
+
+    if (length % 2 != 0) {
+        return false;
+    }
+
+#if INTERLEAVE_X86
+    return isTwoByteCharacterRecordLayoutSse2(data, length);
+#else
+    for (size_t position = 0; position < length; position += 2) {
+        char const character = data[position];
+        if (character == ' ' || (character >= '\t' && character <= '\r') || data[position + 1] != '\n') {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
+/**
+ * Interleave verified two-byte records from each input, writing one record from each input in turn. The instruction
+ * set is chosen at runtime, so the same binary runs on CPUs without AVX2 (or without any vector extension).
+ *
+ * @param inputs The inputs, each of which must contain at least recordOffset + recordCount two-byte records (see
+ *               isTwoByteCharacterRecordLayout).
+ * @param inputCount The number of inputs.
+ * @param recordOffset The index of the first record to interleave from each input.
+ * @param recordCount The number of records to interleave from each input.
+ * @param output The buffer into which to write, which must hold 2 * inputCount * recordCount bytes.
+ */
+void interleaveTwoByteRecords(
+    char const * const * const inputs,
+    size_t const inputCount,
+    size_t const recordOffset,
+    size_t const recordCount,
+    char * const output
+) {
+    guardNotNull(inputs, "inputs", "interleaveTwoByteRecords");
+    guardNotNull(output, "output", "interleaveTwoByteRecords");
+
+    size_t vectorRecordCount = 0;
+
+#if INTERLEAVE_X86
+    if (inputCount == 2) {
+        char const * const input0 = &inputs[0][recordOffset * 2];
+        char const * const input1 = &inputs[1][recordOffset * 2];
+        vectorRecordCount = (
+            __builtin_cpu_supports("avx2")
+                ? interleaveTwoInputsAvx2(input0, input1, recordCount, output)
+                : interleaveTwoInputsSse2(input0, input1, recordCount, output)
+        );
+    } else if (inputCount == 3 && __builtin_cpu_supports("ssse3")) {
+        char const * const offsetInputs[] = {
+            &inputs[0][recordOffset * 2],
+            &inputs[1][recordOffset * 2],
+            &inputs[2][recordOffset * 2]
+        };
+        vectorRecordCount = interleaveThreeInputsSsse3(offsetInputs, recordCount, output);
+    } else if (inputCount == 4) {
+        char const * const offsetInputs[] = {
+            &inputs[0][recordOffset * 2],
+            &inputs[1][recordOffset * 2],
+            &inputs[2][recordOffset * 2],
+            &inputs[3][recordOffset * 2]
+        };
+        vectorRecordCount = (
+            __builtin_cpu_supports("avx2")
+                ? interleaveFourInputsAvx2(offsetInputs, recordCount, output)
+                : interleaveFourInputsSse2(offsetInputs, recordCount, output)
+        );
+    }
+#endif
+
+    interleaveTwoByteRecordsScalar(
+        inputs,
+        inputCount,
+        recordOffset + vectorRecordCount,
+        recordCount - vectorRecordCount,
+        &output[vectorRecordCount * inputCount * 2]
+    );
+}
+
+static void interleaveTwoByteRecordsScalar(
+    char const * const * const inputs,
+    size_t const inputCount,
+    size_t const recordOffset,
+    size_t const recordCount,
+    char * const output
+) {
+    char *outputPosition = output;
+    for (size_t record = recordOffset; record < recordOffset + recordCount; record += 1) {
+        for (size_t i = 0; i < inputCount; i += 1) {
+            memcpy(outputPosition, &inputs[i][record * 2], 2);
+            outputPosition += 2;
+        }
+    }
+}
+
+#if INTERLEAVE_X86
+static bool isTwoByteCharacterRecordLayoutSse2(char const * const data, size_t const length) {
+    __m128i const newlines = _mm_set1_epi8('\n');
+    __m128i const spaces = _mm_set1_epi8(' ');
+    __m128i const tabs = _mm_set1_epi8('\t');
+    __m128i const controlWhitespaceRange = _mm_set1_epi8('\r' - '\t');
+
+    size_t position = 0;
+    for (; position + 16 <= length; position += 16) {
+        __m128i const bytes = _mm_loadu_si128((__m128i const *)&data[position]);
+
+        // Unsigned (byte - '\t') <= ('\r' - '\t') selects '\t' through '\r'
+        __m128i const offsetFromTab = _mm_sub_epi8(bytes, tabs);
+        __m128i const isControlWhitespace = _mm_cmpeq_epi8(
+            _mm_min_epu8(offsetFromTab, controlWhitespaceRange),
+            offsetFromTab
+        );
+        __m128i const isWhitespace = _mm_or_si128(isControlWhitespace, _mm_cmpeq_epi8(bytes, spaces));
+        __m128i const isNewline = _mm_cmpeq_epi8(bytes, newlines);
+
+        // Even bytes must not be whitespace; odd bytes must be newlines
+        if ((_mm_movemask_epi8(isWhitespace) & 0x5555) != 0 || (_mm_movemask_epi8(isNewline) & 0xAAAA) != 0xAAAA) {
+            return false;
+        }
+    }
+
+    for (; position < length; position += 2) {
+        char const character = data[position];
+        if (character == ' ' || (character >= '\t' && character <= '\r') || data[position + 1] != '\n') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t interleaveTwoInputsSse2(
+    char const * const input0,
+    char const * const input1,
+    size_t const recordCount,
+    char * const output
+) {
+    size_t record = 0;
+    for (; record + 8 <= recordCount; record += 8) {
+        __m128i const units0 = _mm_loadu_si128((__m128i const *)&input0[record * 2]);
+        __m128i const units1 = _mm_loadu_si128((__m128i const *)&input1[record * 2]);
+
+        _mm_storeu_si128((__m128i *)&output[record * 4], _mm_unpacklo_epi16(units0, units1));
+        _mm_storeu_si128((__m128i *)&output[record * 4 + 16], _mm_unpackhi_epi16(units0, units1));
+    }
+    return record;
+}
+
+__attribute__((target("avx2")))
+static size_t interleaveTwoInputsAvx2(
+    char const * const input0,
+    char const * const input1,
+    size_t const recordCount,
+    char * const output
+) {
+    size_t record = 0;
+    for (; record + 16 <= recordCount; record += 16) {
+        __m256i const units0 = _mm256_loadu_si256((__m256i const *)&input0[record * 2]);
+        __m256i const units1 = _mm256_loadu_si256((__m256i const *)&input1[record * 2]);
+
+        // The unpacks work within 128-bit lanes, so the lane halves are recombined afterwards
+        __m256i const low = _mm256_unpacklo_epi16(units0, units1);
+        __m256i const high = _mm256_unpackhi_epi16(units0, units1);
+
+        _mm256_storeu_si256((__m256i *)&output[record * 4], _mm256_permute2x128_si256(low, high, 0x20));
+        _mm256_storeu_si256((__m256i *)&output[record * 4 + 32], _mm256_permute2x128_si256(low, high, 0x31));
+    }
+    return record;
+}
+
+__attribute__((target("ssse3")))
+static size_t interleaveThreeInputsSsse3(
+    char const * const * const inputs,
+    size_t const recordCount,
+    char * const output
+) {
+    // masks[v][i] moves the units of input i that belong in output vector v into place, zeroing the rest
+    static signed char const masks[3][3][16] = {
+        {
+            { 0,  1, -1, -1, -1, -1,  2,  3, -1, -1, -1, -1,  4,  5, -1, -1 },
+            {-1, -1,  0,  1, -1, -1, -1, -1,  2,  3, -1, -1, -1, -1,  4,  5 },
+            {-1, -1, -1, -1,  0,  1, -1, -1, -1, -1,  2,  3, -1, -1, -1, -1 }
+        },
+        {
+            {-1, -1,  6,  7, -1, -1, -1, -1,  8,  9, -1, -1, -1, -1, 10, 11 },
+            {-1, -1, -1, -1,  6,  7, -1, -1, -1, -1,  8,  9, -1, -1, -1, -1 },
+            { 4,  5, -1, -1, -1, -1,  6,  7, -1, -1, -1, -1,  8,  9, -1, -1 }
+        },
+        {
+            {-1, -1, -1, -1, 12, 13, -1, -1, -1, -1, 14, 15, -1, -1, -1, -1 },
+            {10, 11, -1, -1, -1, -1, 12, 13, -1, -1, -1, -1, 14, 15, -1, -1 },
+            {-1, -1, 10, 11, -1, -1, -1, -1, 12, 13, -1, -1, -1, -1, 14, 15 }
+        }
+    };
+
+    __m128i shuffles[3][3];
+    for (size_t v = 0; v < 3; v += 1) {
+        for (size_t i = 0; i < 3; i += 1) {
+            shuffles[v][i] = _mm_loadu_si128((__m128i const *)masks[v][i]);
+        }
+    }
+
+    size_t record = 0;
+    for (; record + 8 <= recordCount; record += 8) {
+        __m128i const units0 = _mm_loadu_si128((__m128i const *)&inputs[0][record * 2]);
+        __m128i const units1 = _mm_loadu_si128((__m128i const *)&inputs[1][record * 2]);
+        __m128i const units2 = _mm_loadu_si128((__m128i const *)&inputs[2][record * 2]);
+
+        for (size_t v = 0; v < 3; v += 1) {
+            __m128i const vector = _mm_or_si128(
+                _mm_or_si128(_mm_shuffle_epi8(units0, shuffles[v][0]), _mm_shuffle_epi8(units1, shuffles[v][1])),
+                _mm_shuffle_epi8(units2, shuffles[v][2])
+            );
+            _mm_storeu_si128((__m128i *)&output[record * 6 + v * 16], vector);
+        }
+    }
+    return record;
+}
+
+static size_t interleaveFourInputsSse2(
+    char const * const * const inputs,
+    size_t const recordCount,
+    char * const output
+) {
+    size_t record = 0;
+    for (; record + 8 <= recordCount; record += 8) {
+        __m128i const units0 = _mm_loadu_si128((__m128i const *)&inputs[0][record * 2]);
+        __m128i const units1 = _mm_loadu_si128((__m128i const *)&inputs[1][record * 2]);
+        __m128i const units2 = _mm_loadu_si128((__m128i const *)&inputs[2][record * 2]);
+        __m128i const units3 = _mm_loadu_si128((__m128i const *)&inputs[3][record * 2]);
+
+        __m128i const low01 = _mm_unpacklo_epi16(units0, units1);
+        __m128i const high01 = _mm_unpackhi_epi16(units0, units1);
+        __m128i const low23 = _mm_unpacklo_epi16(units2, units3);
+        __m128i const high23 = _mm_unpackhi_epi16(units2, units3);
+
+        _mm_storeu_si128((__m128i *)&output[record * 8], _mm_unpacklo_epi32(low01, low23));
+        _mm_storeu_si128((__m128i *)&output[record * 8 + 16], _mm_unpackhi_epi32(low01, low23));
+        _mm_storeu_si128((__m128i *)&output[record * 8 + 32], _mm_unpacklo_epi32(high01, high23));
+        _mm_storeu_si128((__m128i *)&output[record * 8 + 48], _mm_unpackhi_epi32(high01, high23));
+    }
+    return record;
+}
+
+__attribute__((target("avx2")))
+static size_t interleaveFourInputsAvx2(
+    char const * const * const inputs,
+    size_t const recordCount,
+    char * const output
+) {
+    size_t record = 0;
+    for (; record + 16 <= recordCount; record += 16) {
+        __m256i const units0 = _mm256_loadu_si256((__m256i const *)&inputs[0][record * 2]);
+        __m256i const units1 = _mm256_loadu_si256((__m256i const *)&inputs[1][record * 2]);
+        __m256i const units2 = _mm256_loadu_si256((__m256i const *)&inputs[2][record * 2]);
+        __m256i const units3 = _mm256_loadu_si256((__m256i const *)&inputs[3][record * 2]);
+
+        storeFourInputRoundsAvx2(
+            _mm256_unpacklo_epi16(units0, units1),
+            _mm256_unpacklo_epi16(units2, units3),
+            &output[record * 8]
+        );
+        storeFourInputRoundsAvx2(
+            _mm256_unpackhi_epi16(units0, units1),
+            _mm256_unpackhi_epi16(units2, units3),
+            &output[record * 8 + 32]
+        );
+    }
+    return record;
+}
+
+/**
+ * Store the rounds held by one half of four inputs' units, unpacked pairwise, to output[0, 32) and output[64, 96). A
+ * separate function so that unoptimized builds do not keep every intermediate vector of a whole step on the stack.
+ */
+__attribute__((target("avx2")))
+static void storeFourInputRoundsAvx2(__m256i const units01, __m256i const units23, char * const output) {
+    // Each lane now holds two rounds of four units; recombine lanes so rounds are in order
+    __m256i const rounds0 = _mm256_unpacklo_epi32(units01, units23);
+    __m256i const rounds1 = _mm256_unpackhi_epi32(units01, units23);
+
+    _mm256_storeu_si256((__m256i *)output, _mm256_permute2x128_si256(rounds0, rounds1, 0x20));
+    _mm256_storeu_si256((__m256i *)&output[64], _mm256_permute2x128_si256(rounds0, rounds1, 0x31));
+}
+#endif
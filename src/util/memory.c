@@ -5,8 +5,52 @@
 #include "../../include/util/error.h"
 
 #include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <assert.h>
+
+/**
+ * A chunk of an arena's memory, whose data follows the chunk header (padded so that the data is aligned for any type).
+ */
+struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t capacity;
+};
+
+/**
+ * The chunks of an arena, in the order they are used, and how much of the current chunk is used. Chunks after the
+ * current one are left over from before the last reset.
+ */
+struct Arena {
+    size_t chunkSize;
+    struct ArenaChunk *firstChunk;
+    struct ArenaChunk *currentChunk;
+    size_t usedLength;
+};
+
+static size_t const arenaChunkHeaderSize = (
+    (sizeof (struct ArenaChunk) + _Alignof(max_align_t) - 1) / _Alignof(max_align_t) * _Alignof(max_align_t)
+);
+static size_t const scratchArenaChunkSize = 65536;
+
+static pthread_once_t scratchArenaKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t scratchArenaKey;
+static _Thread_local struct Arena *threadScratchArena = NULL;
+
+static char *getArenaChunkData(struct ArenaChunk *chunk);
+static void *tryAllocInArenaChunk(
+    struct Arena *arena,
+    struct ArenaChunk *chunk,
+    size_t usedLength,
+    size_t alignment,
+    size_t size
+);
+static void createScratchArenaKey(void);
+static void destroyScratchArena(void *arenaAsVoidPtr);
 
 /**
  * Allocate memory of the given size using malloc. If the allocation fails, abort the program with an error message.
@@ -38,6 +82,46 @@ void *safeMalloc(size_t const size, char const * const callerDescription) {
     return memory;
 }
 
+/**
+ * Allocate memory of the given size and alignment using aligned_alloc. The size is rounded up to a multiple of the
+ * alignment. If the allocation fails, abort the program with an error message.
+ *
+ * @param alignment The alignment of the memory, in bytes. Must be a power of two.
+ * @param size The size of the memory, in bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The allocated memory. The caller is responsible for freeing the memory using free.
+ */
+void *safeAlignedMalloc(size_t const alignment, size_t const size, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "safeAlignedMalloc");
+    guardFmt(
+        alignment != 0 && (alignment & (alignment - 1)) == 0,
+        "safeAlignedMalloc: alignment must be a power of two (actual: %zu)",
+        alignment
+    );
+
+    size_t const alignedSize = (size + alignment - 1) / alignment * alignment;
+    void * const memory = aligned_alloc(alignment, alignedSize);
+    if (memory == NULL) {
+        int const alignedAllocErrorCode = errno;
+        char const * const alignedAllocErrorMessage = strerror(alignedAllocErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to allocate %zu bytes of memory aligned to %zu bytes using aligned_alloc"
+            " (error code: %d; error message: \"%s\")",
+            callerDescription,
+            alignedSize,
+            alignment,
+            alignedAllocErrorCode,
+            alignedAllocErrorMessage
+        );
+        return NULL;
+    }
+
+    return memory;
+}
+
 /**
  * Resize the given memory using realloc. If the reallocation fails, abort the program with an error message.
  *
@@ -68,3 +152,309 @@ void *safeRealloc(void * const memory, size_t const newSize, char const * const
 
     return newMemory;
 }
+
+/**
+ * Create an empty arena. If the operation fails, abort the program with an error message.
+ *
+ * @param chunkSize The size of each chunk of memory the arena obtains from malloc, in bytes. A larger allocation gets a
+ *                  chunk of its own size.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The arena. The caller is responsible for destroying it using arenaDestroy.
+ */
+struct Arena *arenaCreate(size_t const chunkSize, char const * const callerDescription) {
+    guard(chunkSize > 0, "arenaCreate: chunkSize must be positive");
+    guardNotNull(callerDescription, "callerDescription", "arenaCreate");
+
+    struct Arena * const arena = safeMalloc(sizeof *arena, callerDescription);
+    arena->chunkSize = chunkSize;
+    arena->firstChunk = NULL;
+    arena->currentChunk = NULL;
+    arena->usedLength = 0;
+    return arena;
+}
+
+/**
+ * Allocate memory of the given size from the given arena, aligned for any type. If the allocation fails, abort the
+ * program with an error message.
+ *
+ * @param arena The arena.
+ * @param size The size of the memory, in bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The allocated memory, which lasts until the arena is reset past it or destroyed.
+ */
+void *arenaAlloc(struct Arena * const arena, size_t const size, char const * const callerDescription) {
+    return arenaAlignedAlloc(arena, _Alignof(max_align_t), size, callerDescription);
+}
+
+/**
+ * Allocate memory of the given size and alignment from the given arena. If the allocation fails, abort the program
+ * with an error message.
+ *
+ * @param arena The arena.
+ * @param alignment The alignment of the memory, in bytes. Must be a power of two.
+ * @param size The size of the memory, in bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The allocated memory, which lasts until the arena is reset past it or destroyed.
+ */
+void *arenaAlignedAlloc(
+    struct Arena * const arena,
+    size_t const alignment,
+    size_t const size,
+    char const * const callerDescription
+) {
+    hotGuardNotNull(arena, "arena", "arenaAlignedAlloc");
+    hotGuardFmt(
+        alignment != 0 && (alignment & (alignment - 1)) == 0,
+        "arenaAlignedAlloc: alignment must be a power of two (actual: %zu)",
+        alignment
+    );
+    hotGuardNotNull(callerDescription, "callerDescription", "arenaAlignedAlloc");
+
+    // Use the rest of the current chunk, or else the first chunk left over from before a reset that fits
+    struct ArenaChunk *chunk = arena->currentChunk;
+    size_t usedLength = arena->usedLength;
+    while (chunk != NULL) {
+        void * const memory = tryAllocInArenaChunk(arena, chunk, usedLength, alignment, size);
+        if (memory != NULL) {
+            return memory;
+        }
+        if (chunk->next == NULL) {
+            break;
+        }
+        chunk = chunk->next;
+        usedLength = 0;
+    }
+
+    size_t capacity = arena->chunkSize;
+    if (size > SIZE_MAX - arenaChunkHeaderSize - alignment) {
+        abortWithErrorFmt("%s: Failed to allocate %zu bytes of memory from an arena", callerDescription, size);
+        return NULL;
+    }
+    if (capacity < size + alignment) {
+        capacity = size + alignment;
+    }
+
+    struct ArenaChunk * const newChunk = safeMalloc(arenaChunkHeaderSize + capacity, callerDescription);
+    newChunk->next = NULL;
+    newChunk->capacity = capacity;
+    if (chunk == NULL) {
+        arena->firstChunk = newChunk;
+    } else {
+        chunk->next = newChunk;
+    }
+
+    void * const memory = tryAllocInArenaChunk(arena, newChunk, 0, alignment, size);
+    assert(memory != NULL);
+    return memory;
+}
+
+/**
+ * Get the current position of the given arena, to later release everything allocated after it using arenaResetToMark.
+ *
+ * @param arena The arena.
+ *
+ * @returns The mark.
+ */
+struct ArenaMark arenaGetMark(struct Arena const * const arena) {
+    hotGuardNotNull(arena, "arena", "arenaGetMark");
+
+    return (struct ArenaMark){
+        .chunk = arena->currentChunk,
+        .usedLength = arena->usedLength
+    };
+}
+
+/**
+ * Release everything allocated from the given arena since the given mark was taken, keeping its chunks for later
+ * allocations.
+ *
+ * @param arena The arena.
+ * @param mark A mark taken from the arena since it was last reset to before the mark.
+ */
+void arenaResetToMark(struct Arena * const arena, struct ArenaMark const mark) {
+    hotGuardNotNull(arena, "arena", "arenaResetToMark");
+
+    // A mark taken before the first allocation is the start of the first chunk
+    arena->currentChunk = mark.chunk != NULL ? mark.chunk : arena->firstChunk;
+    arena->usedLength = mark.usedLength;
+}
+
+/**
+ * Release everything allocated from the given arena, keeping its chunks for later allocations.
+ *
+ * @param arena The arena.
+ */
+void arenaReset(struct Arena * const arena) {
+    hotGuardNotNull(arena, "arena", "arenaReset");
+
+    arena->currentChunk = arena->firstChunk;
+    arena->usedLength = 0;
+}
+
+/**
+ * Destroy the given arena, freeing all of its memory.
+ *
+ * @param arena The arena.
+ */
+void arenaDestroy(struct Arena * const arena) {
+    guardNotNull(arena, "arena", "arenaDestroy");
+
+    struct ArenaChunk *chunk = arena->firstChunk;
+    while (chunk != NULL) {
+        struct ArenaChunk * const nextChunk = chunk->next;
+        free(chunk);
+        chunk = nextChunk;
+    }
+    free(arena);
+}
+
+/**
+ * Get the calling thread's scratch arena, for memory that is only needed until the caller returns. The caller takes a
+ * mark (see arenaGetMark) before allocating and resets the arena to it before returning, so that nested callers can
+ * share the arena. The arena is created by the thread's first call and destroyed when the thread exits, or earlier by
+ * releaseThreadScratchArena. If the operation fails, abort the program with an error message.
+ *
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The arena, which only the calling thread may use.
+ */
+struct Arena *getThreadScratchArena(char const * const callerDescription) {
+    hotGuardNotNull(callerDescription, "callerDescription", "getThreadScratchArena");
+
+    if (threadScratchArena != NULL) {
+        return threadScratchArena;
+    }
+
+    int const onceErrorCode = pthread_once(&scratchArenaKeyOnce, createScratchArenaKey);
+    if (onceErrorCode != 0) {
+        abortWithErrorFmt(
+            "%s: Failed to create the scratch arena key using pthread_once (error code: %d; error message: \"%s\")",
+            callerDescription,
+            onceErrorCode,
+            strerror(onceErrorCode)
+        );
+        return NULL;
+    }
+
+    struct Arena * const arena = arenaCreate(scratchArenaChunkSize, callerDescription);
+
+    // Registered so the arena is destroyed when the thread exits
+    int const setSpecificErrorCode = pthread_setspecific(scratchArenaKey, arena);
+    if (setSpecificErrorCode != 0) {
+        abortWithErrorFmt(
+            "%s: Failed to register the scratch arena using pthread_setspecific"
+            " (error code: %d; error message: \"%s\")",
+            callerDescription,
+            setSpecificErrorCode,
+            strerror(setSpecificErrorCode)
+        );
+        return NULL;
+    }
+
+    threadScratchArena = arena;
+    return arena;
+}
+
+/**
+ * Determine whether the calling thread has a scratch arena, so that code which creates one only for its own use can
+ * tell whether releasing it afterwards would destroy an arena its caller already had.
+ *
+ * @returns True if getThreadScratchArena has created the calling thread's arena and it has not been destroyed since.
+ */
+bool hasThreadScratchArena(void) {
+    return threadScratchArena != NULL;
+}
+
+/**
+ * Destroy the calling thread's scratch arena, if it has one and nothing is allocated from it, so that a thread that
+ * never exits does not keep it. Key destructors do not run for the main thread when it returns from main, so this is
+ * the only way its arena is freed. Only the code that caused the arena to be created should release it (see
+ * hasThreadScratchArena), since callers further up the stack may hold the arena itself. A later call to
+ * getThreadScratchArena creates a new arena. The key under which arenas are registered is never deleted, since other
+ * threads may still hold arenas under it. If the operation fails, abort the program with an error message.
+ *
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void releaseThreadScratchArena(char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "releaseThreadScratchArena");
+
+    struct Arena * const arena = threadScratchArena;
+    if (arena == NULL) {
+        return;
+    }
+
+    // A caller further up the stack still holds memory from the arena
+    if (arena->currentChunk != arena->firstChunk || arena->usedLength > 0) {
+        return;
+    }
+
+    int const setSpecificErrorCode = pthread_setspecific(scratchArenaKey, NULL);
+    if (setSpecificErrorCode != 0) {
+        abortWithErrorFmt(
+            "%s: Failed to unregister the scratch arena using pthread_setspecific"
+            " (error code: %d; error message: \"%s\")",
+            callerDescription,
+            setSpecificErrorCode,
+            strerror(setSpecificErrorCode)
+        );
+        return;
+    }
+
+    threadScratchArena = NULL;
+    arenaDestroy(arena);
+}
+
+static char *getArenaChunkData(struct ArenaChunk * const chunk) {
+    return (char *)chunk + arenaChunkHeaderSize;
+}
+
+/**
+ * Allocate memory from the given chunk of the given arena, of which the given length is in use, and make that chunk
+ * the arena's current chunk.
+ *
+ * @returns The memory, or null if it does not fit in the chunk.
+ */
+static void *tryAllocInArenaChunk(
+    struct Arena * const arena,
+    struct ArenaChunk * const chunk,
+    size_t const usedLength,
+    size_t const alignment,
+    size_t const size
+) {
+    char * const data = getArenaChunkData(chunk);
+    uintptr_t const freeAddress = (uintptr_t)&data[usedLength];
+    size_t const padding = (size_t)((alignment - freeAddress % alignment) % alignment);
+    if (padding > chunk->capacity - usedLength || size > chunk->capacity - usedLength - padding) {
+        return NULL;
+    }
+
+    arena->currentChunk = chunk;
+    arena->usedLength = usedLength + padding + size;
+    return &data[usedLength + padding];
+}
+
+static void createScratchArenaKey(void) {
+    int const keyCreateErrorCode = pthread_key_create(&scratchArenaKey, destroyScratchArena);
+    if (keyCreateErrorCode != 0) {
+        abortWithErrorFmt(
+            "createScratchArenaKey: Failed to create key using pthread_key_create"
+            " (error code: %d; error message: \"%s\")",
+            keyCreateErrorCode,
+            strerror(keyCreateErrorCode)
+        );
+    }
+}
+
+static void destroyScratchArena(void * const arenaAsVoidPtr) {
+    // Another key's destructor may still call getThreadScratchArena, which must not return the destroyed arena
+    threadScratchArena = NULL;
+    arenaDestroy(arenaAsVoidPtr);
+}
@@ -0,0 +1,198 @@
+#include "../../include/util/poll.h"
+
+#include "../../include/util/memory.h"
+#include "../../include/util/file.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+/**
+ * An epoll instance that waits for file descriptors to become readable (or hung up). Each file descriptor is identified
+ * to the caller by the user data it was added with.
+ */
+struct Poller {
+    int epollFileDescriptor;
+
+    struct epoll_event *events;
+    size_t maxEventCount;
+};
+
+/**
+ * Create a poller. If the operation fails, abort the program with an error message.
+ *
+ * @param maxEventCount The maximum number of ready file descriptors reported by one pollerWait. Must be positive.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The poller. The caller is responsible for destroying it using pollerDestroy.
+ */
+struct Poller *pollerCreate(size_t const maxEventCount, char const * const callerDescription) {
+    guard(maxEventCount > 0 && maxEventCount <= INT32_MAX, "pollerCreate: maxEventCount is out of range");
+    guardNotNull(callerDescription, "callerDescription", "pollerCreate");
+
+    int const epollFileDescriptor = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFileDescriptor < 0) {
+        int const epollCreateErrorCode = errno;
+        char const * const epollCreateErrorMessage = strerror(epollCreateErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to create poller using epoll_create1 (error code: %d; error message: \"%s\")",
+            callerDescription,
+            epollCreateErrorCode,
+            epollCreateErrorMessage
+        );
+        return NULL;
+    }
+
+    struct Poller * const poller = safeMalloc(sizeof *poller, callerDescription);
+    poller->epollFileDescriptor = epollFileDescriptor;
+    poller->events = safeMalloc(sizeof *poller->events * maxEventCount, callerDescription);
+    poller->maxEventCount = maxEventCount;
+    return poller;
+}
+
+/**
+ * Start waiting for the given file descriptor to become readable. Regular files and some devices do not support
+ * polling, in which case the caller should read them with blocking reads instead. If the operation otherwise fails,
+ * abort the program with an error message.
+ *
+ * @param poller The poller.
+ * @param fileDescriptor The file descriptor, open for reading.
+ * @param userData The value to report from pollerWait when the file descriptor is ready.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns True if the file descriptor was added, or false if it does not support polling.
+ */
+bool pollerTryAdd(
+    struct Poller * const poller,
+    int const fileDescriptor,
+    uint64_t const userData,
+    char const * const callerDescription
+) {
+    guardNotNull(poller, "poller", "pollerTryAdd");
+    guardNotNull(callerDescription, "callerDescription", "pollerTryAdd");
+
+    struct epoll_event event = {
+        .events = EPOLLIN,
+        .data = { .u64 = userData }
+    };
+    if (epoll_ctl(poller->epollFileDescriptor, EPOLL_CTL_ADD, fileDescriptor, &event) != 0) {
+        int const epollCtlErrorCode = errno;
+        if (epollCtlErrorCode == EPERM) {
+            return false;
+        }
+        char const * const epollCtlErrorMessage = strerror(epollCtlErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to add file descriptor %d to poller using epoll_ctl (error code: %d; error message: \"%s\")",
+            callerDescription,
+            fileDescriptor,
+            epollCtlErrorCode,
+            epollCtlErrorMessage
+        );
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Stop waiting for the given file descriptor, which was added using pollerTryAdd. If the operation fails, abort the
+ * program with an error message.
+ *
+ * @param poller The poller.
+ * @param fileDescriptor The file descriptor.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void pollerRemove(struct Poller * const poller, int const fileDescriptor, char const * const callerDescription) {
+    guardNotNull(poller, "poller", "pollerRemove");
+    guardNotNull(callerDescription, "callerDescription", "pollerRemove");
+
+    if (epoll_ctl(poller->epollFileDescriptor, EPOLL_CTL_DEL, fileDescriptor, NULL) != 0) {
+        int const epollCtlErrorCode = errno;
+        char const * const epollCtlErrorMessage = strerror(epollCtlErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to remove file descriptor %d from poller using epoll_ctl (error code: %d; error message: "
+                "\"%s\")",
+            callerDescription,
+            fileDescriptor,
+            epollCtlErrorCode,
+            epollCtlErrorMessage
+        );
+    }
+}
+
+/**
+ * Wait until at least one added file descriptor is readable or hung up, retrying after interruptions. If the operation
+ * fails, abort the program with an error message.
+ *
+ * @param poller The poller.
+ * @param userDatasOut The buffer into which to store the user data of each ready file descriptor.
+ * @param userDatasCapacity The length of the buffer. Must be positive.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of ready file descriptors.
+ */
+size_t pollerWait(
+    struct Poller * const poller,
+    uint64_t * const userDatasOut,
+    size_t const userDatasCapacity,
+    char const * const callerDescription
+) {
+    guardNotNull(poller, "poller", "pollerWait");
+    guardNotNull(userDatasOut, "userDatasOut", "pollerWait");
+    guard(userDatasCapacity > 0, "pollerWait: userDatasCapacity must be positive");
+    guardNotNull(callerDescription, "callerDescription", "pollerWait");
+
+    size_t const maxEventCount = userDatasCapacity < poller->maxEventCount ? userDatasCapacity : poller->maxEventCount;
+    while (true) {
+        int const readyCount = epoll_wait(poller->epollFileDescriptor, poller->events, (int)maxEventCount, -1);
+        if (readyCount >= 0) {
+            for (int i = 0; i < readyCount; i += 1) {
+                userDatasOut[i] = poller->events[i].data.u64;
+            }
+            return (size_t)readyCount;
+        }
+
+        int const epollWaitErrorCode = errno;
+        if (epollWaitErrorCode == EINTR) {
+            continue;
+        }
+        char const * const epollWaitErrorMessage = strerror(epollWaitErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to wait for file descriptors using epoll_wait (error code: %d; error message: \"%s\")",
+            callerDescription,
+            epollWaitErrorCode,
+            epollWaitErrorMessage
+        );
+        return 0;
+    }
+}
+
+/**
+ * Destroy the given poller. The file descriptors it waits for are not closed.
+ *
+ * @param poller The poller.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void pollerDestroy(struct Poller * const poller, char const * const callerDescription) {
+    guardNotNull(poller, "poller", "pollerDestroy");
+    guardNotNull(callerDescription, "callerDescription", "pollerDestroy");
+
+    safeClose(poller->epollFileDescriptor, callerDescription);
+    free(poller->events);
+    free(poller);
+}
@@ -0,0 +1,240 @@
+#include "../../include/util/record.h"
+
+#include "../../include/util/file.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * Get the format of `"%c\n"` records, as read and written by hw5.
+ *
+ * @returns The format.
+ */
+struct RecordFormat characterRecordFormat(void) {
+    return (struct RecordFormat){
+        .kind = RECORD_KIND_CHARACTER,
+        .delimiter = '\n',
+        .length = 1
+    };
+}
+
+/**
+ * Get the format of newline-terminated lines.
+ *
+ * @returns The format.
+ */
+struct RecordFormat lineRecordFormat(void) {
+    return delimitedRecordFormat('\n');
+}
+
+/**
+ * Get the format of records terminated by the given delimiter.
+ *
+ * @param delimiter The delimiter.
+ *
+ * @returns The format.
+ */
+struct RecordFormat delimitedRecordFormat(char const delimiter) {
+    return (struct RecordFormat){
+        .kind = RECORD_KIND_DELIMITED,
+        .delimiter = delimiter,
+        .length = 0
+    };
+}
+
+/**
+ * Get the format of records of the given fixed number of bytes.
+ *
+ * @param length The number of bytes in a record. Must be positive.
+ *
+ * @returns The format.
+ */
+struct RecordFormat fixedRecordFormat(size_t const length) {
+    guard(length > 0, "fixedRecordFormat: length must be positive");
+
+    return (struct RecordFormat){
+        .kind = RECORD_KIND_FIXED,
+        .delimiter = '\0',
+        .length = length
+    };
+}
+
+/**
+ * Initialize the given scan state for the start of an input.
+ *
+ * @param scanOutPtr The scan state.
+ */
+void recordScanInit(struct RecordScan * const scanOutPtr) {
+    guardNotNull(scanOutPtr, "scanOutPtr", "recordScanInit");
+
+    scanOutPtr->skippingWhitespace = false;
+    scanOutPtr->recordLength = 0;
+}
+
+/**
+ * Scan the next piece of the current record from the given bytes: the bytes of the record up to its end, or up to the
+ * end of the bytes if the record continues past them. Bytes skipped between records (whitespace after a
+ * RECORD_KIND_CHARACTER record) are consumed but are not part of the piece. A record that the input ends before it is
+ * complete is still a record; see getRecordTerminator.
+ *
+ * @param formatPtr The record format.
+ * @param scanPtr The scan state, which must start out initialized by recordScanInit. Updated on return.
+ * @param data The bytes to scan.
+ * @param dataLength The number of bytes to scan.
+ * @param pieceOffsetOutPtr Where to store the offset of the piece within the bytes.
+ * @param pieceLengthOutPtr Where to store the number of bytes in the piece, which is 0 only if no record starts within
+ *                          the bytes.
+ * @param completeOutPtr Where to store whether the piece completes the record.
+ *
+ * @returns The number of bytes consumed, which ends with the piece. This is less than dataLength only if the piece
+ *          completes the record.
+ */
+size_t scanRecordPiece(
+    struct RecordFormat const * const formatPtr,
+    struct RecordScan * const scanPtr,
+    char const * const data,
+    size_t const dataLength,
+    size_t * const pieceOffsetOutPtr,
+    size_t * const pieceLengthOutPtr,
+    bool * const completeOutPtr
+) {
+    hotGuardNotNull(formatPtr, "formatPtr", "scanRecordPiece");
+    hotGuardNotNull(scanPtr, "scanPtr", "scanRecordPiece");
+    hotGuard(data != NULL || dataLength == 0, "scanRecordPiece: data must not be null");
+    hotGuardNotNull(pieceOffsetOutPtr, "pieceOffsetOutPtr", "scanRecordPiece");
+    hotGuardNotNull(pieceLengthOutPtr, "pieceLengthOutPtr", "scanRecordPiece");
+    hotGuardNotNull(completeOutPtr, "completeOutPtr", "scanRecordPiece");
+
+    size_t pieceOffset = 0;
+    size_t pieceLength = 0;
+    bool complete = false;
+
+    switch (formatPtr->kind) {
+        case RECORD_KIND_CHARACTER: {
+            if (scanPtr->skippingWhitespace) {
+                while (pieceOffset < dataLength && isScanfWhitespace(data[pieceOffset])) {
+                    pieceOffset += 1;
+                }
+            }
+            if (pieceOffset < dataLength) {
+                pieceLength = 1;
+                complete = true;
+                scanPtr->skippingWhitespace = true;
+            }
+            break;
+        }
+        case RECORD_KIND_DELIMITED: {
+            char const * const delimiterPtr = dataLength > 0 ? memchr(data, formatPtr->delimiter, dataLength) : NULL;
+            complete = delimiterPtr != NULL;
+            pieceLength = complete ? (size_t)(delimiterPtr - data) + 1 : dataLength;
+            break;
+        }
+        case RECORD_KIND_FIXED: {
+            size_t const remainingLength = formatPtr->length - scanPtr->recordLength;
+            complete = dataLength >= remainingLength;
+            pieceLength = complete ? remainingLength : dataLength;
+            break;
+        }
+        default: {
+            abortWithErrorFmt("scanRecordPiece: Unknown record kind %d", (int)formatPtr->kind);
+            break;
+        }
+    }
+
+    scanPtr->recordLength = complete ? 0 : scanPtr->recordLength + pieceLength;
+
+    *pieceOffsetOutPtr = pieceOffset;
+    *pieceLengthOutPtr = pieceLength;
+    *completeOutPtr = complete;
+    return pieceOffset + pieceLength;
+}
+
+/**
+ * Count the records completed within the given bytes (see scanRecordPiece). Counts over consecutive ranges of an input
+ * can be summed by passing the same scan state; at the end of the input, a nonzero recordLength in the scan state is
+ * one more, incomplete, record.
+ *
+ * @param formatPtr The record format.
+ * @param scanPtr The scan state, which must start out initialized by recordScanInit. Updated on return.
+ * @param data The bytes to scan.
+ * @param dataLength The number of bytes to scan.
+ *
+ * @returns The number of records completed within the bytes.
+ */
+size_t countCompleteRecords(
+    struct RecordFormat const * const formatPtr,
+    struct RecordScan * const scanPtr,
+    char const * const data,
+    size_t const dataLength
+) {
+    hotGuardNotNull(formatPtr, "formatPtr", "countCompleteRecords");
+    hotGuardNotNull(scanPtr, "scanPtr", "countCompleteRecords");
+    hotGuard(data != NULL || dataLength == 0, "countCompleteRecords: data must not be null");
+
+    if (formatPtr->kind == RECORD_KIND_FIXED) {
+        size_t const scannedLength = scanPtr->recordLength + dataLength;
+        scanPtr->recordLength = scannedLength % formatPtr->length;
+        return scannedLength / formatPtr->length;
+    }
+
+    size_t recordCount = 0;
+    size_t position = 0;
+    while (position < dataLength) {
+        size_t pieceOffset;
+        size_t pieceLength;
+        bool complete;
+        position += scanRecordPiece(
+            formatPtr,
+            scanPtr,
+            &data[position],
+            dataLength - position,
+            &pieceOffset,
+            &pieceLength,
+            &complete
+        );
+        if (complete) {
+            recordCount += 1;
+        }
+    }
+    return recordCount;
+}
+
+/**
+ * Get the byte to write after the bytes of a record, if any: a newline after a RECORD_KIND_CHARACTER record, or the
+ * delimiter after a RECORD_KIND_DELIMITED record that the input ended before.
+ *
+ * @param formatPtr The record format.
+ * @param complete Whether the record was completed, rather than cut short by the end of the input.
+ * @param terminatorOutPtr Where to store the byte.
+ *
+ * @returns Whether a byte is to be written.
+ */
+bool getRecordTerminator(
+    struct RecordFormat const * const formatPtr,
+    bool const complete,
+    char * const terminatorOutPtr
+) {
+    hotGuardNotNull(formatPtr, "formatPtr", "getRecordTerminator");
+    hotGuardNotNull(terminatorOutPtr, "terminatorOutPtr", "getRecordTerminator");
+
+    switch (formatPtr->kind) {
+        case RECORD_KIND_CHARACTER: {
+            *terminatorOutPtr = '\n';
+            return true;
+        }
+        case RECORD_KIND_DELIMITED: {
+            *terminatorOutPtr = formatPtr->delimiter;
+            return !complete;
+        }
+        case RECORD_KIND_FIXED: {
+            return false;
+        }
+        default: {
+            abortWithErrorFmt("getRecordTerminator: Unknown record kind %d", (int)formatPtr->kind);
+            return false;
+        }
+    }
+}
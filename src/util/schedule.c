@@ -0,0 +1,184 @@
+#include "../../include/util/schedule.h"
+
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+static struct InterleaveSchedule *createSchedule(
+    size_t slotCount,
+    size_t inputCount,
+    char const *callerDescription
+);
+static void finishSchedule(struct InterleaveSchedule *schedule, char const *callerDescription);
+
+/**
+ * Create the schedule that takes one record from each input in turn. If the operation fails, abort the program with an
+ * error message.
+ *
+ * @param inputCount The number of inputs.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The schedule. The caller is responsible for destroying it using interleaveScheduleDestroy.
+ */
+struct InterleaveSchedule *interleaveScheduleCreate(size_t const inputCount, char const * const callerDescription) {
+    guardNotNull(callerDescription, "callerDescription", "interleaveScheduleCreate");
+
+    struct InterleaveSchedule * const schedule = createSchedule(inputCount, inputCount, callerDescription);
+    for (size_t i = 0; i < inputCount; i += 1) {
+        schedule->slots[i] = (uint32_t)i;
+    }
+    finishSchedule(schedule, callerDescription);
+
+    return schedule;
+}
+
+/**
+ * Create the schedule that takes the given number of consecutive records from each input in turn. If a weight is 0,
+ * or the operation fails, abort the program with an error message.
+ *
+ * @param weights The number of records to take from each input per round.
+ * @param inputCount The number of inputs.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The schedule. The caller is responsible for destroying it using interleaveScheduleDestroy.
+ */
+struct InterleaveSchedule *interleaveScheduleCreateWeighted(
+    size_t const * const weights,
+    size_t const inputCount,
+    char const * const callerDescription
+) {
+    guard(weights != NULL || inputCount == 0, "interleaveScheduleCreateWeighted: weights must not be null");
+    guardNotNull(callerDescription, "callerDescription", "interleaveScheduleCreateWeighted");
+
+    size_t slotCount = 0;
+    for (size_t i = 0; i < inputCount; i += 1) {
+        if (weights[i] == 0 || weights[i] > SIZE_MAX / sizeof (uint32_t) - slotCount) {
+            abortWithErrorFmt("%s: Weight %zu of input %zu is out of range", callerDescription, weights[i], i);
+        }
+        slotCount += weights[i];
+    }
+
+    struct InterleaveSchedule * const schedule = createSchedule(slotCount, inputCount, callerDescription);
+    size_t slot = 0;
+    for (size_t i = 0; i < inputCount; i += 1) {
+        for (size_t j = 0; j < weights[i]; j += 1) {
+            schedule->slots[slot] = (uint32_t)i;
+            slot += 1;
+        }
+    }
+    finishSchedule(schedule, callerDescription);
+
+    return schedule;
+}
+
+/**
+ * Create the schedule whose rounds take a record from each input in the given pattern in turn. If the pattern names an
+ * input that does not exist or leaves out an input, or the operation fails, abort the program with an error message.
+ *
+ * @param pattern The input index of each slot of a round.
+ * @param patternLength The number of slots in a round.
+ * @param inputCount The number of inputs.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The schedule. The caller is responsible for destroying it using interleaveScheduleDestroy.
+ */
+struct InterleaveSchedule *interleaveScheduleCreatePattern(
+    size_t const * const pattern,
+    size_t const patternLength,
+    size_t const inputCount,
+    char const * const callerDescription
+) {
+    guard(pattern != NULL || patternLength == 0, "interleaveScheduleCreatePattern: pattern must not be null");
+    guardNotNull(callerDescription, "callerDescription", "interleaveScheduleCreatePattern");
+
+    struct InterleaveSchedule * const schedule = createSchedule(patternLength, inputCount, callerDescription);
+    for (size_t slot = 0; slot < patternLength; slot += 1) {
+        if (pattern[slot] >= inputCount) {
+            abortWithErrorFmt(
+                "%s: Slot %zu of the pattern names input %zu of only %zu",
+                callerDescription,
+                slot,
+                pattern[slot],
+                inputCount
+            );
+        }
+        schedule->slots[slot] = (uint32_t)pattern[slot];
+    }
+    finishSchedule(schedule, callerDescription);
+
+    return schedule;
+}
+
+/**
+ * Destroy the given schedule.
+ *
+ * @param schedule The schedule.
+ */
+void interleaveScheduleDestroy(struct InterleaveSchedule * const schedule) {
+    guardNotNull(schedule, "schedule", "interleaveScheduleDestroy");
+
+    free(schedule->slots);
+    free(schedule);
+}
+
+/**
+ * Allocate a schedule of the given number of slots, which are left for the caller to fill in.
+ */
+static struct InterleaveSchedule *createSchedule(
+    size_t const slotCount,
+    size_t const inputCount,
+    char const * const callerDescription
+) {
+    if (inputCount > UINT32_MAX) {
+        abortWithErrorFmt("%s: A schedule cannot have %zu inputs", callerDescription, inputCount);
+    }
+
+    struct InterleaveSchedule * const schedule = safeMalloc(sizeof *schedule, callerDescription);
+    schedule->slots = safeMalloc(sizeof *schedule->slots * (slotCount > 0 ? slotCount : 1), callerDescription);
+    schedule->slotCount = slotCount;
+    schedule->inputCount = inputCount;
+    schedule->roundRobin = false;
+    return schedule;
+}
+
+/**
+ * Check that the filled-in slots of the given schedule give every input a slot, and determine whether they are round
+ * robin.
+ */
+static void finishSchedule(struct InterleaveSchedule * const schedule, char const * const callerDescription) {
+    // Each input's first slot is counted once, so the count reaches inputCount only if no input was left out
+    size_t const inputCount = schedule->inputCount;
+    bool * const seen = safeMalloc(sizeof *seen * (inputCount > 0 ? inputCount : 1), callerDescription);
+    for (size_t i = 0; i < inputCount; i += 1) {
+        seen[i] = false;
+    }
+
+    size_t seenCount = 0;
+    bool roundRobin = schedule->slotCount == inputCount;
+    for (size_t slot = 0; slot < schedule->slotCount; slot += 1) {
+        uint32_t const inputIndex = schedule->slots[slot];
+        roundRobin = roundRobin && inputIndex == slot;
+        if (!seen[inputIndex]) {
+            seen[inputIndex] = true;
+            seenCount += 1;
+        }
+    }
+    free(seen);
+
+    if (seenCount < inputCount) {
+        abortWithErrorFmt(
+            "%s: The schedule leaves out %zu of %zu inputs",
+            callerDescription,
+            inputCount - seenCount,
+            inputCount
+        );
+    }
+    schedule->roundRobin = roundRobin;
+}
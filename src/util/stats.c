@@ -0,0 +1,48 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/util/stats.h"
+
+#include "../../include/util/guard.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/**
+ * Zero the given counters.
+ *
+ * @param stats The counters.
+ */
+void threadStatsInit(struct ThreadStats * const stats) {
+    guardNotNull(stats, "stats", "threadStatsInit");
+
+    atomic_init(&stats->recordCount, 0);
+    atomic_init(&stats->byteCount, 0);
+    atomic_init(&stats->waitCount, 0);
+    atomic_init(&stats->blockedNanoseconds, 0);
+    atomic_init(&stats->ioNanoseconds, 0);
+}
+
+/**
+ * Add to the given counter. Only one thread may update a counter at a time, so this is a plain load and store rather
+ * than a locked read-modify-write; concurrent readers see either the old or the new value.
+ *
+ * @param counterPtr The counter.
+ * @param amount The amount to add.
+ */
+void threadStatsAdd(atomic_uint_least64_t * const counterPtr, uint64_t const amount) {
+    uint_least64_t const value = atomic_load_explicit(counterPtr, memory_order_relaxed);
+    atomic_store_explicit(counterPtr, value + amount, memory_order_relaxed);
+}
+
+/**
+ * Get the current time of the monotonic clock, for measuring durations.
+ *
+ * @returns The time, in nanoseconds since an arbitrary point.
+ */
+uint64_t getMonotonicNanoseconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000u + (uint64_t)time.tv_nsec;
+}
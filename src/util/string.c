@@ -7,6 +7,10 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+static void growStringBuilder(struct StringBuilder *builder, size_t minCapacity, char const *callerDescription);
 
 /**
  * If the given buffer is non-null, format the string into the buffer. If the buffer is null, simply calculate the
@@ -162,14 +166,381 @@ char *formatString(char const * const format, ...) {
 char *formatStringVA(char const * const format, va_list formatArgs) {
     guardNotNull(format, "format", "formatStringVA");
 
-    va_list formatArgsForVsprintf;
-    va_copy(formatArgsForVsprintf, formatArgs);
+    // Short strings are formatted in one pass into the builder's inline buffer before being copied out
+    struct StringBuilder builder;
+    stringBuilderInit(&builder);
+    stringBuilderAppendFmtVA(&builder, "formatStringVA", format, formatArgs);
+    return stringBuilderDetachString(&builder, "formatStringVA");
+}
+
+/**
+ * Create a string in the given arena using the specified format and format args.
+ *
+ * @param arena The arena from which to allocate the string.
+ * @param format The string format (printf).
+ * @param ... The string format arguments (printf).
+ *
+ * @returns The formatted string, which lasts until the arena is reset past it or destroyed.
+ */
+char *formatStringInArena(struct Arena * const arena, char const * const format, ...) {
+    va_list formatArgs;
+    va_start(formatArgs, format);
+    char * const formattedString = formatStringInArenaVA(arena, format, formatArgs);
+    va_end(formatArgs);
+    return formattedString;
+}
+
+/**
+ * Create a string in the given arena using the specified format and format args.
+ *
+ * @param arena The arena from which to allocate the string.
+ * @param format The string format (printf).
+ * @param formatArgs The string format arguments (printf).
+ *
+ * @returns The formatted string, which lasts until the arena is reset past it or destroyed.
+ */
+char *formatStringInArenaVA(struct Arena * const arena, char const * const format, va_list formatArgs) {
+    guardNotNull(arena, "arena", "formatStringInArenaVA");
+    guardNotNull(format, "format", "formatStringInArenaVA");
 
-    size_t const formattedStringLength = safeVsnprintf(NULL, 0, format, formatArgs, "formatStringVA");
-    char * const formattedString = safeMalloc(sizeof *formattedString * (formattedStringLength + 1), "formatStringVA");
+    va_list formatArgsForRetry;
+    va_copy(formatArgsForRetry, formatArgs);
 
-    safeVsprintf(formattedString, format, formatArgsForVsprintf, "formatStringVA");
-    va_end(formatArgsForVsprintf);
+    // Short strings are formatted once on the stack and copied into the arena. Longer ones are measured by that pass
+    // and formatted again straight into a block of the arena, so neither touches the heap
+    char shortString[STRING_BUILDER_INLINE_CAPACITY];
+    size_t const formattedLength = safeVsnprintf(
+        shortString,
+        sizeof shortString,
+        format,
+        formatArgs,
+        "formatStringInArenaVA"
+    );
+    char * const formattedString = arenaAlloc(
+        arena,
+        sizeof *formattedString * (formattedLength + 1),
+        "formatStringInArenaVA"
+    );
+    if (formattedLength < sizeof shortString) {
+        memcpy(formattedString, shortString, formattedLength + 1);
+    } else {
+        safeVsnprintf(formattedString, formattedLength + 1, format, formatArgsForRetry, "formatStringInArenaVA");
+    }
+    va_end(formatArgsForRetry);
 
     return formattedString;
 }
+
+/**
+ * Initialize an empty string builder, which holds its contents inline until they outgrow it.
+ *
+ * @param builderOutPtr The builder. The caller is responsible for destroying it using stringBuilderDestroy.
+ */
+void stringBuilderInit(struct StringBuilder * const builderOutPtr) {
+    guardNotNull(builderOutPtr, "builderOutPtr", "stringBuilderInit");
+
+    builderOutPtr->data = builderOutPtr->inlineBuffer;
+    builderOutPtr->length = 0;
+    builderOutPtr->capacity = STRING_BUILDER_INLINE_CAPACITY - 1;
+    builderOutPtr->data[0] = '\0';
+}
+
+/**
+ * Ensure that the given number of characters can be appended to the builder without it growing. If the operation
+ * fails, abort the program with an error message.
+ *
+ * @param builder The builder.
+ * @param additionalLength The number of characters.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void stringBuilderReserve(
+    struct StringBuilder * const builder,
+    size_t const additionalLength,
+    char const * const callerDescription
+) {
+    hotGuardNotNull(builder, "builder", "stringBuilderReserve");
+    hotGuardNotNull(callerDescription, "callerDescription", "stringBuilderReserve");
+
+    if (additionalLength <= builder->capacity - builder->length) {
+        return;
+    }
+    if (additionalLength >= SIZE_MAX - builder->length) {
+        abortWithErrorFmt(
+            "%s: A string of %zu characters cannot grow by %zu more",
+            callerDescription,
+            builder->length,
+            additionalLength
+        );
+    }
+    growStringBuilder(builder, builder->length + additionalLength, callerDescription);
+}
+
+/**
+ * Append a character to the builder. If the operation fails, abort the program with an error message.
+ *
+ * @param builder The builder.
+ * @param character The character.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void stringBuilderAppendChar(
+    struct StringBuilder * const builder,
+    char const character,
+    char const * const callerDescription
+) {
+    hotGuardNotNull(builder, "builder", "stringBuilderAppendChar");
+    hotGuardNotNull(callerDescription, "callerDescription", "stringBuilderAppendChar");
+
+    if (builder->length == builder->capacity) {
+        stringBuilderReserve(builder, 1, callerDescription);
+    }
+    builder->data[builder->length] = character;
+    builder->length += 1;
+    builder->data[builder->length] = '\0';
+}
+
+/**
+ * Append a span of bytes to the builder. If the operation fails, abort the program with an error message.
+ *
+ * @param builder The builder.
+ * @param data The bytes, which may include null characters.
+ * @param dataLength The number of bytes.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void stringBuilderAppendBytes(
+    struct StringBuilder * const builder,
+    char const * const data,
+    size_t const dataLength,
+    char const * const callerDescription
+) {
+    hotGuardNotNull(builder, "builder", "stringBuilderAppendBytes");
+    hotGuard(data != NULL || dataLength == 0, "stringBuilderAppendBytes: data must not be null");
+    hotGuardNotNull(callerDescription, "callerDescription", "stringBuilderAppendBytes");
+
+    if (dataLength == 0) {
+        return;
+    }
+    stringBuilderReserve(builder, dataLength, callerDescription);
+    memcpy(builder->data + builder->length, data, dataLength);
+    builder->length += dataLength;
+    builder->data[builder->length] = '\0';
+}
+
+/**
+ * Append a null-terminated string to the builder. If the operation fails, abort the program with an error message.
+ *
+ * @param builder The builder.
+ * @param string The string.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void stringBuilderAppendString(
+    struct StringBuilder * const builder,
+    char const * const string,
+    char const * const callerDescription
+) {
+    hotGuardNotNull(string, "string", "stringBuilderAppendString");
+
+    stringBuilderAppendBytes(builder, string, strlen(string), callerDescription);
+}
+
+/**
+ * Append the decimal digits of an unsigned integer to the builder, without going through printf. If the operation
+ * fails, abort the program with an error message.
+ *
+ * @param builder The builder.
+ * @param value The integer.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void stringBuilderAppendUnsigned(
+    struct StringBuilder * const builder,
+    uint64_t const value,
+    char const * const callerDescription
+) {
+    // Enough for the 20 digits of UINT64_MAX, filled in from the end
+    char digits[20];
+    size_t digitIndex = sizeof digits;
+    uint64_t remainingValue = value;
+    do {
+        digitIndex -= 1;
+        digits[digitIndex] = (char)('0' + remainingValue % 10);
+        remainingValue /= 10;
+    } while (remainingValue > 0);
+
+    stringBuilderAppendBytes(builder, &digits[digitIndex], sizeof digits - digitIndex, callerDescription);
+}
+
+/**
+ * Append the decimal digits of a signed integer to the builder, without going through printf. If the operation fails,
+ * abort the program with an error message.
+ *
+ * @param builder The builder.
+ * @param value The integer.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void stringBuilderAppendSigned(
+    struct StringBuilder * const builder,
+    int64_t const value,
+    char const * const callerDescription
+) {
+    if (value >= 0) {
+        stringBuilderAppendUnsigned(builder, (uint64_t)value, callerDescription);
+        return;
+    }
+
+    // Negated in unsigned arithmetic, which is also correct for INT64_MIN
+    stringBuilderAppendChar(builder, '-', callerDescription);
+    stringBuilderAppendUnsigned(builder, (uint64_t)0 - (uint64_t)value, callerDescription);
+}
+
+/**
+ * Append a formatted string to the builder. If the operation fails, abort the program with an error message.
+ *
+ * @param builder The builder.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ * @param format The string format (printf).
+ * @param ... The string format arguments (printf).
+ */
+void stringBuilderAppendFmt(
+    struct StringBuilder * const builder,
+    char const * const callerDescription,
+    char const * const format,
+    ...
+) {
+    va_list formatArgs;
+    va_start(formatArgs, format);
+    stringBuilderAppendFmtVA(builder, callerDescription, format, formatArgs);
+    va_end(formatArgs);
+}
+
+/**
+ * Append a formatted string to the builder. A format with no conversions is copied as is; any other is formatted
+ * straight into the builder's free space, and formatted a second time only if it did not fit. If the operation fails,
+ * abort the program with an error message.
+ *
+ * @param builder The builder.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ * @param format The string format (printf).
+ * @param formatArgs The string format arguments (printf).
+ */
+void stringBuilderAppendFmtVA(
+    struct StringBuilder * const builder,
+    char const * const callerDescription,
+    char const * const format,
+    va_list formatArgs
+) {
+    hotGuardNotNull(builder, "builder", "stringBuilderAppendFmtVA");
+    hotGuardNotNull(format, "format", "stringBuilderAppendFmtVA");
+    hotGuardNotNull(callerDescription, "callerDescription", "stringBuilderAppendFmtVA");
+
+    if (strchr(format, '%') == NULL) {
+        stringBuilderAppendString(builder, format, callerDescription);
+        return;
+    }
+
+    va_list formatArgsForRetry;
+    va_copy(formatArgsForRetry, formatArgs);
+
+    size_t const freeLength = builder->capacity - builder->length;
+    size_t const formattedLength = safeVsnprintf(
+        builder->data + builder->length,
+        freeLength + 1,
+        format,
+        formatArgs,
+        callerDescription
+    );
+    if (formattedLength > freeLength) {
+        stringBuilderReserve(builder, formattedLength, callerDescription);
+        safeVsnprintf(
+            builder->data + builder->length,
+            formattedLength + 1,
+            format,
+            formatArgsForRetry,
+            callerDescription
+        );
+    }
+    va_end(formatArgsForRetry);
+
+    builder->length += formattedLength;
+}
+
+/**
+ * Empty the builder, keeping its capacity.
+ *
+ * @param builder The builder.
+ */
+void stringBuilderClear(struct StringBuilder * const builder) {
+    hotGuardNotNull(builder, "builder", "stringBuilderClear");
+
+    builder->length = 0;
+    builder->data[0] = '\0';
+}
+
+/**
+ * Take the builder's contents as a string of their own, leaving the builder empty. If the operation fails, abort the
+ * program with an error message.
+ *
+ * @param builder The builder.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The string. The caller is responsible for freeing the memory.
+ */
+char *stringBuilderDetachString(struct StringBuilder * const builder, char const * const callerDescription) {
+    guardNotNull(builder, "builder", "stringBuilderDetachString");
+    guardNotNull(callerDescription, "callerDescription", "stringBuilderDetachString");
+
+    char *string;
+    if (builder->data == builder->inlineBuffer) {
+        string = safeMalloc(sizeof *string * (builder->length + 1), callerDescription);
+        memcpy(string, builder->data, builder->length + 1);
+    } else {
+        string = builder->data;
+    }
+
+    stringBuilderInit(builder);
+    return string;
+}
+
+/**
+ * Destroy the given builder, freeing its contents if they moved to the heap.
+ *
+ * @param builder The builder.
+ */
+void stringBuilderDestroy(struct StringBuilder * const builder) {
+    guardNotNull(builder, "builder", "stringBuilderDestroy");
+
+    if (builder->data != builder->inlineBuffer) {
+        free(builder->data);
+    }
+}
+
+/**
+ * Move the builder's contents to a heap buffer that holds at least the given number of characters, at least doubling
+ * its capacity.
+ */
+static void growStringBuilder(
+    struct StringBuilder * const builder,
+    size_t const minCapacity,
+    char const * const callerDescription
+) {
+    size_t newCapacity = builder->capacity <= SIZE_MAX / 2 ? builder->capacity * 2 + 1 : SIZE_MAX - 1;
+    if (newCapacity < minCapacity) {
+        newCapacity = minCapacity;
+    }
+
+    if (builder->data == builder->inlineBuffer) {
+        char * const data = safeMalloc(sizeof *data * (newCapacity + 1), callerDescription);
+        memcpy(data, builder->data, builder->length + 1);
+        builder->data = data;
+    } else {
+        builder->data = safeRealloc(builder->data, sizeof *builder->data * (newCapacity + 1), callerDescription);
+    }
+    builder->capacity = newCapacity;
+}
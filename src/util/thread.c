@@ -1,15 +1,206 @@
+#define _GNU_SOURCE
+
 #include "../include/util/thread.h"
 
+#include "../include/util/memory.h"
+#include "../include/util/stats.h"
 #include "../include/util/guard.h"
 #include "../include/util/error.h"
 
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include <string.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <assert.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define THREAD_X86 1
+#else
+#define THREAD_X86 0
+#endif
+
+#if defined(__aarch64__)
+#define THREAD_AARCH64 1
+#else
+#define THREAD_AARCH64 0
+#endif
+
+/**
+ * A bounded lock-free single-producer/single-consumer byte queue. The producer and consumer never contend on a lock
+ * while the ring is neither empty nor full; a thread only parks (see SpscRingWait) when it cannot make progress. The
+ * indices are free-running and wrap using the capacity mask, which requires the capacity to be a power of two.
+ */
+struct SpscRing {
+    // Written by the consumer only
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t readIndex;
+    atomic_bool consumerParked;
+    struct ThreadStats *consumerStats;
+
+    // Written by the producer only
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t writeIndex;
+    atomic_bool producerParked;
+    atomic_bool closed;
+    struct ThreadStats *producerStats;
+
+    // Immutable after creation, plus the parking primitives for the slow path
+    _Alignas(CACHE_LINE_SIZE) char *buffer;
+    size_t capacityMask;
+    enum SpscRingWait wait;
+    struct SpinWaitPolicy spinWaitPolicy;
+
+    pthread_mutex_t parkMutex;
+    pthread_cond_t notEmptyCondition;
+    pthread_cond_t notFullCondition;
+
+    struct Event notEmptyEvent;
+    struct Event notFullEvent;
+};
+
+/**
+ * The states of an Event's futex word.
+ */
+enum EventState {
+    EVENT_STATE_UNSET,
+    EVENT_STATE_SET,
+
+    /**
+     * Unset, and a thread may be asleep in futexWait, so setting the event must wake it.
+     */
+    EVENT_STATE_UNSET_WITH_SLEEPERS
+};
+
+struct WorkerPoolTaskEntry {
+    WorkerPoolTask task;
+    void *taskArg;
+};
+
+/**
+ * One worker's double-ended task queue. The owning worker pushes and pops at the tail (most recently submitted first,
+ * while its data is still warm), and idle workers steal from the head (oldest first). Each deque has its own lock, so
+ * workers contend only when stealing from the same victim. The indices are free-running and wrap using the capacity
+ * mask; the deque grows when full.
+ */
+struct WorkerDeque {
+    _Alignas(CACHE_LINE_SIZE) pthread_mutex_t mutex;
+    struct WorkerPoolTaskEntry *entries;
+    size_t capacityMask;
+    size_t headIndex;
+    size_t tailIndex;
+};
+
+struct WorkerPoolThreadStartArg {
+    struct WorkerPool *pool;
+    size_t workerIndex;
+};
+
+/**
+ * The processors a thread was allowed to run on before it was pinned.
+ */
+struct ThreadAffinity {
+    cpu_set_t *cpuSet;
+    size_t cpuSetSize;
+};
+
+/**
+ * A fixed set of worker threads that run submitted tasks, balancing load by work stealing. The number of threads is
+ * bounded by the pool size regardless of how many tasks are submitted.
+ */
+struct WorkerPool {
+    struct WorkerDeque *deques;
+    size_t workerCount;
+    pthread_t *threadIds;
+    struct WorkerPoolThreadStartArg *threadStartArgs;
+
+    // Submitted tasks not yet taken by a worker
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t queuedTaskCount;
+    atomic_size_t nextDequeIndex;
+
+    // The parking primitives for idle workers
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t idleWorkerCount;
+    bool shuttingDown;
+    pthread_mutex_t idleMutex;
+    pthread_cond_t workAvailableCondition;
+};
+
+static void futexWait(atomic_int *futexPtr, int expectedValue, char const *callerDescription);
+static void futexWake(atomic_int *futexPtr, int wakeCount, char const *callerDescription);
+
+static bool spscRingIsFull(struct SpscRing *ring);
+static bool spscRingIsEmptyAndOpen(struct SpscRing *ring);
+static bool spscRingIsNotFullCallback(void *ringAsVoidPtr);
+static bool spscRingIsNotEmptyOrClosedCallback(void *ringAsVoidPtr);
+static void spscRingParkProducer(struct SpscRing *ring, char const *callerDescription);
+static void spscRingParkConsumer(struct SpscRing *ring, char const *callerDescription);
+static void addParkStats(struct ThreadStats *stats, uint64_t waitCount, uint64_t parkStartNanoseconds);
+static void spscRingWakeConsumer(struct SpscRing *ring, char const *callerDescription);
+static void spscRingWakeProducer(struct SpscRing *ring, char const *callerDescription);
+
+static void workerDequePushTail(
+    struct WorkerDeque *deque,
+    struct WorkerPoolTaskEntry entry,
+    char const *callerDescription
+);
+static bool workerDequeTryPopTail(
+    struct WorkerDeque *deque,
+    struct WorkerPoolTaskEntry *entryOutPtr,
+    char const *callerDescription
+);
+static bool workerDequeTrySteal(
+    struct WorkerDeque *deque,
+    struct WorkerPoolTaskEntry *entryOutPtr,
+    char const *callerDescription
+);
+static bool workerPoolTryTakeTask(
+    struct WorkerPool *pool,
+    size_t workerIndex,
+    struct WorkerPoolTaskEntry *entryOutPtr
+);
+static void *workerPoolThreadStart(void *argAsVoidPtr);
+
+static void initThreadAttributes(
+    pthread_attr_t *attributesOutPtr,
+    struct ThreadSettings const *settingsPtr,
+    char const *callerDescription
+);
+static cpu_set_t *createCpuSet(
+    size_t const *cpus,
+    size_t cpuCount,
+    size_t *cpuSetSizeOutPtr,
+    char const *callerDescription
+);
+static void setCurrentThreadAffinity(cpu_set_t const *cpuSet, size_t cpuSetSize, char const *callerDescription);
+
+static size_t const initialWorkerDequeCapacity = 64;
+static unsigned int const maxSpinPauseCount = 1024;
+
+/**
+ * The pool and worker index of the calling thread if it is a pool worker, so that tasks submitted from within a task
+ * go to the submitting worker's own deque.
+ */
+static _Thread_local struct WorkerPoolThreadStartArg const *currentWorker = NULL;
+
+/**
+ * Get the number of processors currently online, for sizing pools of worker threads.
+ *
+ * @returns The number of online processors, or 1 if it cannot be determined.
+ */
+size_t getOnlineProcessorCount(void) {
+    long const processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    return processorCount > 0 ? (size_t)processorCount : 1;
+}
 
 /**
  * Create a new thread. If the operation fails, abort the program with an error message.
  *
- * @param attributes The attributes with which to create the thread, or null to use the default attributes.
+ * @param settingsPtr The stack size and processors of the thread, or null to use the defaults.
  * @param startRoutine The function to run in the new thread. This function will be called with startRoutineArg as its
  *                     sole argument. If this function returns, the effect is as if there was an implicit call to
  *                     pthread_exit() using the return value of startRoutine as the exit status.
@@ -20,15 +211,29 @@
  * @returns The ID of the newly created thread.
  */
 pthread_t safePthreadCreate(
-    pthread_attr_t const * const attributes,
+    struct ThreadSettings const * const settingsPtr,
     PthreadCreateStartRoutine const startRoutine,
     void * const startRoutineArg,
     char const * const callerDescription
 ) {
     guardNotNull(callerDescription, "callerDescription", "safePthreadCreate");
 
+    bool const hasAttributes = settingsPtr != NULL && (settingsPtr->stackSize > 0 || settingsPtr->cpuCount > 0);
+    pthread_attr_t attributes;
+    if (hasAttributes) {
+        initThreadAttributes(&attributes, settingsPtr, callerDescription);
+    }
+
     pthread_t threadId;
-    int const pthreadCreateErrorCode = pthread_create(&threadId, attributes, startRoutine, startRoutineArg);
+    int const pthreadCreateErrorCode = pthread_create(
+        &threadId,
+        hasAttributes ? &attributes : NULL,
+        startRoutine,
+        startRoutineArg
+    );
+    if (hasAttributes) {
+        pthread_attr_destroy(&attributes);
+    }
     if (pthreadCreateErrorCode != 0) {
         char const * const pthreadCreateErrorMessage = strerror(pthreadCreateErrorCode);
 
@@ -73,6 +278,110 @@ void *safePthreadJoin(pthread_t const threadId, char const * const callerDescrip
     return threadReturnValue;
 }
 
+/**
+ * Get the settings of one thread of a group spread over the processors of the given settings: the same stack size,
+ * pinned to a single processor, with the group's threads taking the processors in turn.
+ *
+ * @param settingsPtr The settings of the group, or null to use the defaults.
+ * @param threadIndex The index of the thread within the group.
+ *
+ * @returns The thread's settings, which borrow the processors of settingsPtr.
+ */
+struct ThreadSettings spreadThreadSettings(struct ThreadSettings const * const settingsPtr, size_t const threadIndex) {
+    if (settingsPtr == NULL) {
+        return (struct ThreadSettings){ .stackSize = 0, .cpus = NULL, .cpuCount = 0 };
+    }
+    if (settingsPtr->cpuCount == 0) {
+        return *settingsPtr;
+    }
+
+    return (struct ThreadSettings){
+        .stackSize = settingsPtr->stackSize,
+        .cpus = &settingsPtr->cpus[threadIndex % settingsPtr->cpuCount],
+        .cpuCount = 1
+    };
+}
+
+/**
+ * Restrict the calling thread to the given processors. If the operation fails, abort the program with an error
+ * message.
+ *
+ * @param cpus The processors the thread may run on.
+ * @param cpuCount The number of processors. Must be positive.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The thread's previous affinity. The caller is responsible for restoring it using
+ *          restoreCurrentThreadAffinity.
+ */
+struct ThreadAffinity *pinCurrentThread(
+    size_t const * const cpus,
+    size_t const cpuCount,
+    char const * const callerDescription
+) {
+    guardNotNull(cpus, "cpus", "pinCurrentThread");
+    guard(cpuCount > 0, "pinCurrentThread: cpuCount must be positive");
+    guardNotNull(callerDescription, "callerDescription", "pinCurrentThread");
+
+    // The kernel rejects a mask smaller than its own, so grow the mask until the current affinity fits
+    struct ThreadAffinity * const previousAffinity = safeMalloc(sizeof *previousAffinity, callerDescription);
+    size_t maskCpuCount = getOnlineProcessorCount() > CPU_SETSIZE ? getOnlineProcessorCount() : CPU_SETSIZE;
+    while (true) {
+        previousAffinity->cpuSet = CPU_ALLOC(maskCpuCount);
+        if (previousAffinity->cpuSet == NULL) {
+            abortWithErrorFmt("%s: Failed to allocate a set of %zu processors", callerDescription, maskCpuCount);
+        }
+        previousAffinity->cpuSetSize = CPU_ALLOC_SIZE(maskCpuCount);
+
+        int const getErrorCode = pthread_getaffinity_np(
+            pthread_self(),
+            previousAffinity->cpuSetSize,
+            previousAffinity->cpuSet
+        );
+        if (getErrorCode == 0) {
+            break;
+        }
+        CPU_FREE(previousAffinity->cpuSet);
+        if (getErrorCode != EINVAL || maskCpuCount > SIZE_MAX / 2) {
+            abortWithErrorFmt(
+                "%s: Failed to get the affinity of the calling thread using pthread_getaffinity_np"
+                " (error code: %d; error message: \"%s\")",
+                callerDescription,
+                getErrorCode,
+                strerror(getErrorCode)
+            );
+        }
+        maskCpuCount *= 2;
+    }
+
+    size_t cpuSetSize;
+    cpu_set_t * const cpuSet = createCpuSet(cpus, cpuCount, &cpuSetSize, callerDescription);
+    setCurrentThreadAffinity(cpuSet, cpuSetSize, callerDescription);
+    CPU_FREE(cpuSet);
+
+    return previousAffinity;
+}
+
+/**
+ * Restore the affinity of the calling thread from before a call to pinCurrentThread. If the operation fails, abort the
+ * program with an error message.
+ *
+ * @param previousAffinity The affinity returned by pinCurrentThread.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void restoreCurrentThreadAffinity(
+    struct ThreadAffinity * const previousAffinity,
+    char const * const callerDescription
+) {
+    guardNotNull(previousAffinity, "previousAffinity", "restoreCurrentThreadAffinity");
+    guardNotNull(callerDescription, "callerDescription", "restoreCurrentThreadAffinity");
+
+    setCurrentThreadAffinity(previousAffinity->cpuSet, previousAffinity->cpuSetSize, callerDescription);
+    CPU_FREE(previousAffinity->cpuSet);
+    free(previousAffinity);
+}
+
 /**
  * Initialize the given mutex memory. If the operation fails, abort the program with an error message.
  *
@@ -110,8 +419,8 @@ void safeMutexInit(
  *                          the calling function, plus extra information if useful.
  */
 void safeMutexLock(pthread_mutex_t * const mutexPtr, char const * const callerDescription) {
-    guardNotNull(mutexPtr, "mutexPtr", "safeMutexLock");
-    guardNotNull(callerDescription, "callerDescription", "safeMutexLock");
+    hotGuardNotNull(mutexPtr, "mutexPtr", "safeMutexLock");
+    hotGuardNotNull(callerDescription, "callerDescription", "safeMutexLock");
 
     int const mutexLockErrorCode = pthread_mutex_lock(mutexPtr);
     if (mutexLockErrorCode != 0) {
@@ -134,8 +443,8 @@ void safeMutexLock(pthread_mutex_t * const mutexPtr, char const * const callerDe
  *                          the calling function, plus extra information if useful.
  */
 void safeMutexUnlock(pthread_mutex_t * const mutexPtr, char const * const callerDescription) {
-    guardNotNull(mutexPtr, "mutexPtr", "safeMutexUnlock");
-    guardNotNull(callerDescription, "callerDescription", "safeMutexUnlock");
+    hotGuardNotNull(mutexPtr, "mutexPtr", "safeMutexUnlock");
+    hotGuardNotNull(callerDescription, "callerDescription", "safeMutexUnlock");
 
     int const mutexUnlockErrorCode = pthread_mutex_unlock(mutexPtr);
     if (mutexUnlockErrorCode != 0) {
@@ -211,8 +520,8 @@ void safeConditionInit(
  *                          the calling function, plus extra information if useful.
  */
 void safeConditionSignal(pthread_cond_t * const conditionPtr, char const * const callerDescription) {
-    guardNotNull(conditionPtr, "conditionPtr", "safeConditionSignal");
-    guardNotNull(callerDescription, "callerDescription", "safeConditionSignal");
+    hotGuardNotNull(conditionPtr, "conditionPtr", "safeConditionSignal");
+    hotGuardNotNull(callerDescription, "callerDescription", "safeConditionSignal");
 
     int const condSignalErrorCode = pthread_cond_signal(conditionPtr);
     if (condSignalErrorCode != 0) {
@@ -227,6 +536,30 @@ void safeConditionSignal(pthread_cond_t * const conditionPtr, char const * const
     }
 }
 
+/**
+ * Wake every thread waiting for the given condition. If the operation fails, abort the program with an error message.
+ *
+ * @param conditionPtr A pointer to the condition.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void safeConditionBroadcast(pthread_cond_t * const conditionPtr, char const * const callerDescription) {
+    hotGuardNotNull(conditionPtr, "conditionPtr", "safeConditionBroadcast");
+    hotGuardNotNull(callerDescription, "callerDescription", "safeConditionBroadcast");
+
+    int const condBroadcastErrorCode = pthread_cond_broadcast(conditionPtr);
+    if (condBroadcastErrorCode != 0) {
+        char const * const condBroadcastErrorMessage = strerror(condBroadcastErrorCode);
+
+        abortWithErrorFmt(
+            "%s: Failed to broadcast condition using pthread_cond_broadcast (error code: %d; error message: \"%s\")",
+            callerDescription,
+            condBroadcastErrorCode,
+            condBroadcastErrorMessage
+        );
+    }
+}
+
 /**
  * Wait for the given condition. If the operation fails, abort the program with an error message.
  *
@@ -240,9 +573,9 @@ void safeConditionWait(
     pthread_mutex_t * const mutexPtr,
     char const * const callerDescription
 ) {
-    guardNotNull(conditionPtr, "conditionPtr", "safeConditionWait");
-    guardNotNull(mutexPtr, "mutexPtr", "safeConditionWait");
-    guardNotNull(callerDescription, "callerDescription", "safeConditionWait");
+    hotGuardNotNull(conditionPtr, "conditionPtr", "safeConditionWait");
+    hotGuardNotNull(mutexPtr, "mutexPtr", "safeConditionWait");
+    hotGuardNotNull(callerDescription, "callerDescription", "safeConditionWait");
 
     int const condWaitErrorCode = pthread_cond_wait(conditionPtr, mutexPtr);
     if (condWaitErrorCode != 0) {
@@ -280,3 +613,999 @@ void safeConditionDestroy(pthread_cond_t * const conditionPtr, char const * cons
         );
     }
 }
+
+/**
+ * Hint to the processor that the calling thread is busy-waiting, e.g. to save power and to yield pipeline resources to
+ * a sibling hyperthread.
+ */
+void cpuRelax(void) {
+#if THREAD_X86
+    __builtin_ia32_pause();
+#elif THREAD_AARCH64
+    __asm__ __volatile__("yield");
+#else
+    atomic_signal_fence(memory_order_seq_cst);
+#endif
+}
+
+/**
+ * Wait for the given condition to become true without blocking, following the given policy: spin for up to
+ * policy.spinRounds rounds, doubling the number of pause instructions each round (up to a cap), then yield the
+ * processor up to policy.yieldRounds times. The condition is checked after every round.
+ *
+ * @param policy The policy.
+ * @param isDone The condition.
+ * @param isDoneArg The argument to pass to isDone.
+ *
+ * @returns True if the condition became true, or false if the policy was exhausted and the caller should park.
+ */
+bool spinWait(struct SpinWaitPolicy const policy, SpinWaitCondition const isDone, void * const isDoneArg) {
+    guard(isDone != NULL, "spinWait: isDone must not be null");
+
+    unsigned int pauseCount = 1;
+    for (unsigned int round = 0; round < policy.spinRounds; round += 1) {
+        for (unsigned int i = 0; i < pauseCount; i += 1) {
+            cpuRelax();
+        }
+        if (isDone(isDoneArg)) {
+            return true;
+        }
+
+        if (pauseCount < maxSpinPauseCount) {
+            pauseCount <<= 1;
+        }
+    }
+
+    for (unsigned int round = 0; round < policy.yieldRounds; round += 1) {
+        sched_yield();
+        if (isDone(isDoneArg)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Initialize the given event memory, unset.
+ *
+ * @param eventOutPtr A pointer to the memory where the event should be initialized. This pointer must be used directly
+ *                    in all event-related functions (no copies).
+ */
+void eventInit(struct Event * const eventOutPtr) {
+    guardNotNull(eventOutPtr, "eventOutPtr", "eventInit");
+
+    atomic_init(&eventOutPtr->state, EVENT_STATE_UNSET);
+}
+
+/**
+ * Set the given event, releasing one waiting thread, or the next thread to wait if none is waiting. Setting an event
+ * that is already set has no further effect. Only makes a system call if a thread may be asleep on the event. If the
+ * operation fails, abort the program with an error message.
+ *
+ * @param eventPtr A pointer to the event.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void eventSet(struct Event * const eventPtr, char const * const callerDescription) {
+    hotGuardNotNull(eventPtr, "eventPtr", "eventSet");
+    hotGuardNotNull(callerDescription, "callerDescription", "eventSet");
+
+    int const previousState = atomic_exchange_explicit(&eventPtr->state, EVENT_STATE_SET, memory_order_release);
+    if (previousState == EVENT_STATE_UNSET_WITH_SLEEPERS) {
+        futexWake(&eventPtr->state, 1, callerDescription);
+    }
+}
+
+/**
+ * Consume the given event if it is set, without waiting.
+ *
+ * @param eventPtr A pointer to the event.
+ *
+ * @returns True if the event was set (and is now unset), or false if it was not set.
+ */
+bool eventTryWait(struct Event * const eventPtr) {
+    hotGuardNotNull(eventPtr, "eventPtr", "eventTryWait");
+
+    int expectedState = EVENT_STATE_SET;
+    return atomic_compare_exchange_strong_explicit(
+        &eventPtr->state,
+        &expectedState,
+        EVENT_STATE_UNSET,
+        memory_order_acquire,
+        memory_order_relaxed
+    );
+}
+
+/**
+ * Wait until the given event is set, then consume it. Returns without a system call if the event is already set. If
+ * the operation fails, abort the program with an error message.
+ *
+ * @param eventPtr A pointer to the event.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void eventWait(struct Event * const eventPtr, char const * const callerDescription) {
+    hotGuardNotNull(eventPtr, "eventPtr", "eventWait");
+    hotGuardNotNull(callerDescription, "callerDescription", "eventWait");
+
+    if (eventTryWait(eventPtr)) {
+        return;
+    }
+
+    // Once this thread has slept, it cannot tell whether other threads are still asleep, so it consumes the event by
+    // leaving it marked as having sleepers; at worst the next eventSet makes one unneeded wake call
+    while (true) {
+        int state = atomic_load_explicit(&eventPtr->state, memory_order_relaxed);
+        if (state == EVENT_STATE_SET) {
+            if (
+                atomic_compare_exchange_weak_explicit(
+                    &eventPtr->state,
+                    &state,
+                    EVENT_STATE_UNSET_WITH_SLEEPERS,
+                    memory_order_acquire,
+                    memory_order_relaxed
+                )
+            ) {
+                return;
+            }
+            continue;
+        }
+
+        if (
+            state == EVENT_STATE_UNSET
+            && !atomic_compare_exchange_weak_explicit(
+                &eventPtr->state,
+                &state,
+                EVENT_STATE_UNSET_WITH_SLEEPERS,
+                memory_order_relaxed,
+                memory_order_relaxed
+            )
+        ) {
+            continue;
+        }
+
+        futexWait(&eventPtr->state, EVENT_STATE_UNSET_WITH_SLEEPERS, callerDescription);
+    }
+}
+
+/**
+ * Create a single-producer/single-consumer byte ring. Exactly one thread may write to the ring and exactly one
+ * (possibly different) thread may read from it. If the operation fails, abort the program with an error message.
+ *
+ * @param minCapacity The minimum number of bytes the ring must be able to hold. The actual capacity is rounded up to a
+ *                    power of two.
+ * @param wait How the producer and consumer wait when the ring is full or empty.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The ring. The caller is responsible for destroying it using spscRingDestroy.
+ */
+struct SpscRing *spscRingCreate(
+    size_t const minCapacity,
+    enum SpscRingWait const wait,
+    char const * const callerDescription
+) {
+    guard(minCapacity > 0, "spscRingCreate: minCapacity must be positive");
+    guardNotNull(callerDescription, "callerDescription", "spscRingCreate");
+
+    size_t capacity = 1;
+    while (capacity < minCapacity) {
+        capacity <<= 1;
+    }
+
+    struct SpscRing * const ring = safeAlignedMalloc(CACHE_LINE_SIZE, sizeof *ring, callerDescription);
+    atomic_init(&ring->readIndex, 0);
+    atomic_init(&ring->consumerParked, false);
+    atomic_init(&ring->writeIndex, 0);
+    atomic_init(&ring->producerParked, false);
+    atomic_init(&ring->closed, false);
+    ring->consumerStats = NULL;
+    ring->producerStats = NULL;
+    ring->buffer = safeMalloc(sizeof *ring->buffer * capacity, callerDescription);
+    ring->capacityMask = capacity - 1;
+    ring->wait = wait;
+    ring->spinWaitPolicy = (struct SpinWaitPolicy){ .spinRounds = 0, .yieldRounds = 0 };
+
+    safeMutexInit(&ring->parkMutex, NULL, callerDescription);
+    safeConditionInit(&ring->notEmptyCondition, NULL, callerDescription);
+    safeConditionInit(&ring->notFullCondition, NULL, callerDescription);
+
+    eventInit(&ring->notEmptyEvent);
+    eventInit(&ring->notFullEvent);
+
+    return ring;
+}
+
+/**
+ * Attribute the time the ring's producer and consumer spend parked (and the number of condition waits) to the given
+ * counters. Must be called before the ring is used.
+ *
+ * @param ring The ring.
+ * @param producerStats The producer's counters, or null to not count the producer's waits.
+ * @param consumerStats The consumer's counters, or null to not count the consumer's waits.
+ */
+void spscRingSetStats(
+    struct SpscRing * const ring,
+    struct ThreadStats * const producerStats,
+    struct ThreadStats * const consumerStats
+) {
+    guardNotNull(ring, "ring", "spscRingSetStats");
+
+    ring->producerStats = producerStats;
+    ring->consumerStats = consumerStats;
+}
+
+/**
+ * Make the ring's producer and consumer busy-wait according to the given policy (see spinWait) before parking. By
+ * default they park right away. Must be called before the ring is used.
+ *
+ * @param ring The ring.
+ * @param policy The policy.
+ */
+void spscRingSetSpinWaitPolicy(struct SpscRing * const ring, struct SpinWaitPolicy const policy) {
+    guardNotNull(ring, "ring", "spscRingSetSpinWaitPolicy");
+
+    ring->spinWaitPolicy = policy;
+}
+
+/**
+ * Write as many of the given bytes to the ring as currently fit without blocking. May only be called by the producer.
+ *
+ * @param ring The ring.
+ * @param data The bytes to write.
+ * @param length The number of bytes to write.
+ *
+ * @returns The number of bytes written, which may be zero if the ring is full.
+ */
+size_t spscRingTryWrite(struct SpscRing * const ring, char const * const data, size_t const length) {
+    hotGuardNotNull(ring, "ring", "spscRingTryWrite");
+    hotGuardNotNull(data, "data", "spscRingTryWrite");
+
+    size_t const capacity = ring->capacityMask + 1;
+    size_t const writeIndex = atomic_load_explicit(&ring->writeIndex, memory_order_relaxed);
+    size_t const readIndex = atomic_load_explicit(&ring->readIndex, memory_order_acquire);
+
+    size_t const freeLength = capacity - (writeIndex - readIndex);
+    size_t const writeLength = length < freeLength ? length : freeLength;
+    if (writeLength == 0) {
+        return 0;
+    }
+
+    size_t const writeOffset = writeIndex & ring->capacityMask;
+    size_t const firstPartLength = (
+        writeLength < capacity - writeOffset ? writeLength : capacity - writeOffset
+    );
+    memcpy(&ring->buffer[writeOffset], data, firstPartLength);
+    memcpy(ring->buffer, &data[firstPartLength], writeLength - firstPartLength);
+
+    atomic_store_explicit(&ring->writeIndex, writeIndex + writeLength, memory_order_release);
+    return writeLength;
+}
+
+/**
+ * Read as many bytes from the ring as are currently available, up to the buffer length, without blocking. May only be
+ * called by the consumer.
+ *
+ * @param ring The ring.
+ * @param buffer The buffer into which to read.
+ * @param bufferLength The length of the buffer.
+ *
+ * @returns The number of bytes read, which may be zero if the ring is empty.
+ */
+size_t spscRingTryRead(struct SpscRing * const ring, char * const buffer, size_t const bufferLength) {
+    hotGuardNotNull(ring, "ring", "spscRingTryRead");
+    hotGuardNotNull(buffer, "buffer", "spscRingTryRead");
+
+    size_t const capacity = ring->capacityMask + 1;
+    size_t const readIndex = atomic_load_explicit(&ring->readIndex, memory_order_relaxed);
+    size_t const writeIndex = atomic_load_explicit(&ring->writeIndex, memory_order_acquire);
+
+    size_t const usedLength = writeIndex - readIndex;
+    size_t const readLength = bufferLength < usedLength ? bufferLength : usedLength;
+    if (readLength == 0) {
+        return 0;
+    }
+
+    size_t const readOffset = readIndex & ring->capacityMask;
+    size_t const firstPartLength = readLength < capacity - readOffset ? readLength : capacity - readOffset;
+    memcpy(buffer, &ring->buffer[readOffset], firstPartLength);
+    memcpy(&buffer[firstPartLength], ring->buffer, readLength - firstPartLength);
+
+    atomic_store_explicit(&ring->readIndex, readIndex + readLength, memory_order_release);
+    return readLength;
+}
+
+/**
+ * Write all of the given bytes to the ring, parking the calling thread whenever the ring is full. May only be called
+ * by the producer. If the operation fails, abort the program with an error message.
+ *
+ * @param ring The ring.
+ * @param data The bytes to write.
+ * @param length The number of bytes to write.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void spscRingWrite(
+    struct SpscRing * const ring,
+    char const * const data,
+    size_t const length,
+    char const * const callerDescription
+) {
+    hotGuardNotNull(ring, "ring", "spscRingWrite");
+    hotGuardNotNull(data, "data", "spscRingWrite");
+    hotGuardNotNull(callerDescription, "callerDescription", "spscRingWrite");
+
+    size_t writtenLength = 0;
+    while (writtenLength < length) {
+        size_t const chunkLength = spscRingTryWrite(ring, &data[writtenLength], length - writtenLength);
+        if (chunkLength > 0) {
+            writtenLength += chunkLength;
+            spscRingWakeConsumer(ring, callerDescription);
+            continue;
+        }
+
+        spscRingParkProducer(ring, callerDescription);
+    }
+}
+
+/**
+ * Read at least one byte from the ring, parking the calling thread while the ring is empty and has not been closed.
+ * May only be called by the consumer. If the operation fails, abort the program with an error message.
+ *
+ * @param ring The ring.
+ * @param buffer The buffer into which to read.
+ * @param bufferLength The length of the buffer. Must be positive.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The number of bytes read, or 0 if the ring has been closed and drained.
+ */
+size_t spscRingRead(
+    struct SpscRing * const ring,
+    char * const buffer,
+    size_t const bufferLength,
+    char const * const callerDescription
+) {
+    hotGuardNotNull(ring, "ring", "spscRingRead");
+    hotGuardNotNull(buffer, "buffer", "spscRingRead");
+    hotGuard(bufferLength > 0, "spscRingRead: bufferLength must be positive");
+    hotGuardNotNull(callerDescription, "callerDescription", "spscRingRead");
+
+    while (true) {
+        size_t const readLength = spscRingTryRead(ring, buffer, bufferLength);
+        if (readLength > 0) {
+            spscRingWakeProducer(ring, callerDescription);
+            return readLength;
+        }
+
+        if (atomic_load_explicit(&ring->closed, memory_order_acquire)) {
+            // Bytes written before the ring was closed are visible now
+            size_t const finalReadLength = spscRingTryRead(ring, buffer, bufferLength);
+            if (finalReadLength > 0) {
+                spscRingWakeProducer(ring, callerDescription);
+            }
+            return finalReadLength;
+        }
+
+        spscRingParkConsumer(ring, callerDescription);
+    }
+}
+
+/**
+ * Determine whether the ring is empty. If called by the producer, an empty ring stays empty until the producer writes
+ * to it; otherwise, the result may be outdated as soon as it is returned.
+ *
+ * @param ring The ring.
+ *
+ * @returns Whether the ring is empty.
+ */
+bool spscRingIsEmpty(struct SpscRing * const ring) {
+    hotGuardNotNull(ring, "ring", "spscRingIsEmpty");
+
+    return atomic_load_explicit(&ring->writeIndex, memory_order_relaxed)
+        == atomic_load_explicit(&ring->readIndex, memory_order_acquire);
+}
+
+/**
+ * Mark the ring as closed, meaning the producer will not write any more bytes. Once the consumer has drained the ring,
+ * spscRingRead will return 0. May only be called by the producer. If the operation fails, abort the program with an
+ * error message.
+ *
+ * @param ring The ring.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void spscRingClose(struct SpscRing * const ring, char const * const callerDescription) {
+    guardNotNull(ring, "ring", "spscRingClose");
+    guardNotNull(callerDescription, "callerDescription", "spscRingClose");
+
+    atomic_store_explicit(&ring->closed, true, memory_order_release);
+    spscRingWakeConsumer(ring, callerDescription);
+}
+
+/**
+ * Destroy the given ring. Neither the producer nor the consumer may use the ring afterward. If the operation fails,
+ * abort the program with an error message.
+ *
+ * @param ring The ring.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void spscRingDestroy(struct SpscRing * const ring, char const * const callerDescription) {
+    guardNotNull(ring, "ring", "spscRingDestroy");
+    guardNotNull(callerDescription, "callerDescription", "spscRingDestroy");
+
+    safeMutexDestroy(&ring->parkMutex, callerDescription);
+    safeConditionDestroy(&ring->notEmptyCondition, callerDescription);
+    safeConditionDestroy(&ring->notFullCondition, callerDescription);
+
+    free(ring->buffer);
+    free(ring);
+}
+
+static void futexWait(atomic_int * const futexPtr, int const expectedValue, char const * const callerDescription) {
+    long const futexResult = syscall(SYS_futex, futexPtr, FUTEX_WAIT_PRIVATE, expectedValue, NULL, NULL, 0);
+    if (futexResult != 0) {
+        int const futexErrorCode = errno;
+        if (futexErrorCode == EAGAIN || futexErrorCode == EINTR) {
+            return;
+        }
+
+        abortWithErrorFmt(
+            "%s: Failed to wait for event using futex (error code: %d; error message: \"%s\")",
+            callerDescription,
+            futexErrorCode,
+            strerror(futexErrorCode)
+        );
+    }
+}
+
+static void futexWake(atomic_int * const futexPtr, int const wakeCount, char const * const callerDescription) {
+    long const futexResult = syscall(SYS_futex, futexPtr, FUTEX_WAKE_PRIVATE, wakeCount, NULL, NULL, 0);
+    if (futexResult < 0) {
+        int const futexErrorCode = errno;
+
+        abortWithErrorFmt(
+            "%s: Failed to wake event waiters using futex (error code: %d; error message: \"%s\")",
+            callerDescription,
+            futexErrorCode,
+            strerror(futexErrorCode)
+        );
+    }
+}
+
+static bool spscRingIsFull(struct SpscRing * const ring) {
+    return atomic_load_explicit(&ring->writeIndex, memory_order_relaxed)
+        - atomic_load_explicit(&ring->readIndex, memory_order_acquire)
+        > ring->capacityMask;
+}
+
+static bool spscRingIsEmptyAndOpen(struct SpscRing * const ring) {
+    return atomic_load_explicit(&ring->writeIndex, memory_order_acquire)
+            == atomic_load_explicit(&ring->readIndex, memory_order_relaxed)
+        && !atomic_load_explicit(&ring->closed, memory_order_acquire);
+}
+
+/**
+ * Block the producer until the ring is not full.
+ */
+static void spscRingParkProducer(struct SpscRing * const ring, char const * const callerDescription) {
+    uint64_t const parkStartNanoseconds = ring->producerStats != NULL ? getMonotonicNanoseconds() : 0;
+    uint64_t waitCount = 0;
+
+    if (spinWait(ring->spinWaitPolicy, spscRingIsNotFullCallback, ring)) {
+        addParkStats(ring->producerStats, waitCount, parkStartNanoseconds);
+        return;
+    }
+
+    switch (ring->wait) {
+        case SPSC_RING_WAIT_CONDITION: {
+            safeMutexLock(&ring->parkMutex, callerDescription);
+            atomic_store_explicit(&ring->producerParked, true, memory_order_relaxed);
+            // Pairs with the fence in spscRingWakeProducer so that either the consumer sees the parked flag or this
+            // thread sees the consumer's read index update
+            atomic_thread_fence(memory_order_seq_cst);
+            while (spscRingIsFull(ring)) {
+                safeConditionWait(&ring->notFullCondition, &ring->parkMutex, callerDescription);
+                waitCount += 1;
+            }
+            atomic_store_explicit(&ring->producerParked, false, memory_order_relaxed);
+            safeMutexUnlock(&ring->parkMutex, callerDescription);
+            break;
+        }
+        case SPSC_RING_WAIT_EVENT: {
+            atomic_store_explicit(&ring->producerParked, true, memory_order_relaxed);
+            // Pairs with the fence in spscRingWakeProducer, as above; a wake that lands between the check and the wait
+            // leaves the event set, so the wait returns immediately
+            atomic_thread_fence(memory_order_seq_cst);
+            while (spscRingIsFull(ring)) {
+                eventWait(&ring->notFullEvent, callerDescription);
+                waitCount += 1;
+            }
+            atomic_store_explicit(&ring->producerParked, false, memory_order_relaxed);
+            break;
+        }
+        default: {
+            abortWithErrorFmt("%s: Unknown ring wait %d", callerDescription, (int)ring->wait);
+            return;
+        }
+    }
+
+    addParkStats(ring->producerStats, waitCount, parkStartNanoseconds);
+}
+
+/**
+ * Block the consumer until the ring is not empty or has been closed.
+ */
+static void spscRingParkConsumer(struct SpscRing * const ring, char const * const callerDescription) {
+    uint64_t const parkStartNanoseconds = ring->consumerStats != NULL ? getMonotonicNanoseconds() : 0;
+    uint64_t waitCount = 0;
+
+    if (spinWait(ring->spinWaitPolicy, spscRingIsNotEmptyOrClosedCallback, ring)) {
+        addParkStats(ring->consumerStats, waitCount, parkStartNanoseconds);
+        return;
+    }
+
+    switch (ring->wait) {
+        case SPSC_RING_WAIT_CONDITION: {
+            safeMutexLock(&ring->parkMutex, callerDescription);
+            atomic_store_explicit(&ring->consumerParked, true, memory_order_relaxed);
+            // Pairs with the fence in spscRingWakeConsumer
+            atomic_thread_fence(memory_order_seq_cst);
+            while (spscRingIsEmptyAndOpen(ring)) {
+                safeConditionWait(&ring->notEmptyCondition, &ring->parkMutex, callerDescription);
+                waitCount += 1;
+            }
+            atomic_store_explicit(&ring->consumerParked, false, memory_order_relaxed);
+            safeMutexUnlock(&ring->parkMutex, callerDescription);
+            break;
+        }
+        case SPSC_RING_WAIT_EVENT: {
+            atomic_store_explicit(&ring->consumerParked, true, memory_order_relaxed);
+            // Pairs with the fence in spscRingWakeConsumer
+            atomic_thread_fence(memory_order_seq_cst);
+            while (spscRingIsEmptyAndOpen(ring)) {
+                eventWait(&ring->notEmptyEvent, callerDescription);
+                waitCount += 1;
+            }
+            atomic_store_explicit(&ring->consumerParked, false, memory_order_relaxed);
+            break;
+        }
+        default: {
+            abortWithErrorFmt("%s: Unknown ring wait %d", callerDescription, (int)ring->wait);
+            return;
+        }
+    }
+
+    addParkStats(ring->consumerStats, waitCount, parkStartNanoseconds);
+}
+
+static void addParkStats(
+    struct ThreadStats * const stats,
+    uint64_t const waitCount,
+    uint64_t const parkStartNanoseconds
+) {
+    if (stats == NULL) {
+        return;
+    }
+
+    threadStatsAdd(&stats->waitCount, waitCount);
+    threadStatsAdd(&stats->blockedNanoseconds, getMonotonicNanoseconds() - parkStartNanoseconds);
+}
+
+static bool spscRingIsNotFullCallback(void * const ringAsVoidPtr) {
+    return !spscRingIsFull(ringAsVoidPtr);
+}
+
+static bool spscRingIsNotEmptyOrClosedCallback(void * const ringAsVoidPtr) {
+    return !spscRingIsEmptyAndOpen(ringAsVoidPtr);
+}
+
+static void spscRingWakeConsumer(struct SpscRing * const ring, char const * const callerDescription) {
+    // Pairs with the fence in spscRingParkConsumer so that either this thread sees the parked flag or the consumer
+    // sees the write index update
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&ring->consumerParked, memory_order_relaxed)) {
+        return;
+    }
+
+    if (ring->wait == SPSC_RING_WAIT_EVENT) {
+        eventSet(&ring->notEmptyEvent, callerDescription);
+        return;
+    }
+
+    safeMutexLock(&ring->parkMutex, callerDescription);
+    safeConditionSignal(&ring->notEmptyCondition, callerDescription);
+    safeMutexUnlock(&ring->parkMutex, callerDescription);
+}
+
+static void spscRingWakeProducer(struct SpscRing * const ring, char const * const callerDescription) {
+    // Pairs with the fence in spscRingParkProducer
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_load_explicit(&ring->producerParked, memory_order_relaxed)) {
+        return;
+    }
+
+    if (ring->wait == SPSC_RING_WAIT_EVENT) {
+        eventSet(&ring->notFullEvent, callerDescription);
+        return;
+    }
+
+    safeMutexLock(&ring->parkMutex, callerDescription);
+    safeConditionSignal(&ring->notFullCondition, callerDescription);
+    safeMutexUnlock(&ring->parkMutex, callerDescription);
+}
+
+/**
+ * Create a pool of worker threads. If the operation fails, abort the program with an error message.
+ *
+ * @param workerCount The number of worker threads. Must be positive.
+ * @param settingsPtr The stack size and processors of the worker threads, or null to use the defaults. Each worker is
+ *                    pinned to one of the processors, taking them in turn (see spreadThreadSettings).
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ *
+ * @returns The pool. The caller is responsible for destroying it using workerPoolDestroy.
+ */
+struct WorkerPool *workerPoolCreate(
+    size_t const workerCount,
+    struct ThreadSettings const * const settingsPtr,
+    char const * const callerDescription
+) {
+    guard(workerCount > 0, "workerPoolCreate: workerCount must be positive");
+    guardNotNull(callerDescription, "callerDescription", "workerPoolCreate");
+
+    struct WorkerPool * const pool = safeAlignedMalloc(CACHE_LINE_SIZE, sizeof *pool, callerDescription);
+    pool->deques = safeAlignedMalloc(CACHE_LINE_SIZE, sizeof *pool->deques * workerCount, callerDescription);
+    pool->workerCount = workerCount;
+    pool->threadIds = safeMalloc(sizeof *pool->threadIds * workerCount, callerDescription);
+    pool->threadStartArgs = safeMalloc(sizeof *pool->threadStartArgs * workerCount, callerDescription);
+
+    atomic_init(&pool->queuedTaskCount, 0);
+    atomic_init(&pool->nextDequeIndex, 0);
+    atomic_init(&pool->idleWorkerCount, 0);
+    pool->shuttingDown = false;
+    safeMutexInit(&pool->idleMutex, NULL, callerDescription);
+    safeConditionInit(&pool->workAvailableCondition, NULL, callerDescription);
+
+    for (size_t i = 0; i < workerCount; i += 1) {
+        struct WorkerDeque * const deque = &pool->deques[i];
+
+        safeMutexInit(&deque->mutex, NULL, callerDescription);
+        deque->entries = safeMalloc(sizeof *deque->entries * initialWorkerDequeCapacity, callerDescription);
+        deque->capacityMask = initialWorkerDequeCapacity - 1;
+        deque->headIndex = 0;
+        deque->tailIndex = 0;
+    }
+
+    for (size_t i = 0; i < workerCount; i += 1) {
+        struct WorkerPoolThreadStartArg * const threadStartArgPtr = &pool->threadStartArgs[i];
+        threadStartArgPtr->pool = pool;
+        threadStartArgPtr->workerIndex = i;
+
+        struct ThreadSettings const threadSettings = spreadThreadSettings(settingsPtr, i);
+        pool->threadIds[i] = safePthreadCreate(
+            &threadSettings,
+            workerPoolThreadStart,
+            threadStartArgPtr,
+            callerDescription
+        );
+    }
+
+    return pool;
+}
+
+/**
+ * Submit a task to be run by one of the pool's workers. Tasks may be submitted from any thread, including from within
+ * a running task. No ordering between tasks is guaranteed. If the operation fails, abort the program with an error
+ * message.
+ *
+ * @param pool The pool.
+ * @param task The function to run on a worker thread.
+ * @param taskArg The argument to pass to task.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void workerPoolSubmit(
+    struct WorkerPool * const pool,
+    WorkerPoolTask const task,
+    void * const taskArg,
+    char const * const callerDescription
+) {
+    hotGuardNotNull(pool, "pool", "workerPoolSubmit");
+    hotGuard(task != NULL, "workerPoolSubmit: task must not be null");
+    hotGuardNotNull(callerDescription, "callerDescription", "workerPoolSubmit");
+
+    size_t const dequeIndex = (
+        currentWorker != NULL && currentWorker->pool == pool
+            ? currentWorker->workerIndex
+            : atomic_fetch_add_explicit(&pool->nextDequeIndex, 1, memory_order_relaxed) % pool->workerCount
+    );
+    struct WorkerPoolTaskEntry const entry = { .task = task, .taskArg = taskArg };
+    workerDequePushTail(&pool->deques[dequeIndex], entry, callerDescription);
+
+    atomic_fetch_add_explicit(&pool->queuedTaskCount, 1, memory_order_seq_cst);
+    // Pairs with the idle check in workerPoolThreadStart so that either this thread sees the idle worker or the worker
+    // sees the queued task
+    if (atomic_load_explicit(&pool->idleWorkerCount, memory_order_seq_cst) == 0) {
+        return;
+    }
+
+    safeMutexLock(&pool->idleMutex, callerDescription);
+    safeConditionSignal(&pool->workAvailableCondition, callerDescription);
+    safeMutexUnlock(&pool->idleMutex, callerDescription);
+}
+
+/**
+ * Run every task submitted to the pool (including tasks submitted by those tasks), then stop and destroy the pool. No
+ * tasks may be submitted from outside the pool afterward. If the operation fails, abort the program with an error
+ * message.
+ *
+ * @param pool The pool.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void workerPoolDestroy(struct WorkerPool * const pool, char const * const callerDescription) {
+    guardNotNull(pool, "pool", "workerPoolDestroy");
+    guardNotNull(callerDescription, "callerDescription", "workerPoolDestroy");
+
+    safeMutexLock(&pool->idleMutex, callerDescription);
+    pool->shuttingDown = true;
+    safeConditionBroadcast(&pool->workAvailableCondition, callerDescription);
+    safeMutexUnlock(&pool->idleMutex, callerDescription);
+
+    for (size_t i = 0; i < pool->workerCount; i += 1) {
+        safePthreadJoin(pool->threadIds[i], callerDescription);
+    }
+
+    for (size_t i = 0; i < pool->workerCount; i += 1) {
+        struct WorkerDeque * const deque = &pool->deques[i];
+
+        safeMutexDestroy(&deque->mutex, callerDescription);
+        free(deque->entries);
+    }
+    safeMutexDestroy(&pool->idleMutex, callerDescription);
+    safeConditionDestroy(&pool->workAvailableCondition, callerDescription);
+
+    free(pool->deques);
+    free(pool->threadIds);
+    free(pool->threadStartArgs);
+    free(pool);
+}
+
+static void workerDequePushTail(
+    struct WorkerDeque * const deque,
+    struct WorkerPoolTaskEntry const entry,
+    char const * const callerDescription
+) {
+    safeMutexLock(&deque->mutex, callerDescription);
+
+    if (deque->tailIndex - deque->headIndex > deque->capacityMask) {
+        // Full; grow, unwrapping the entries so they start at the beginning of the new array
+        size_t const capacity = deque->capacityMask + 1;
+        struct WorkerPoolTaskEntry * const entries = safeMalloc(
+            sizeof *entries * capacity * 2,
+            callerDescription
+        );
+        for (size_t i = 0; i < capacity; i += 1) {
+            entries[i] = deque->entries[(deque->headIndex + i) & deque->capacityMask];
+        }
+
+        free(deque->entries);
+        deque->entries = entries;
+        deque->capacityMask = capacity * 2 - 1;
+        deque->headIndex = 0;
+        deque->tailIndex = capacity;
+    }
+
+    deque->entries[deque->tailIndex & deque->capacityMask] = entry;
+    deque->tailIndex += 1;
+
+    safeMutexUnlock(&deque->mutex, callerDescription);
+}
+
+static bool workerDequeTryPopTail(
+    struct WorkerDeque * const deque,
+    struct WorkerPoolTaskEntry * const entryOutPtr,
+    char const * const callerDescription
+) {
+    safeMutexLock(&deque->mutex, callerDescription);
+
+    bool const found = deque->tailIndex != deque->headIndex;
+    if (found) {
+        deque->tailIndex -= 1;
+        *entryOutPtr = deque->entries[deque->tailIndex & deque->capacityMask];
+    }
+
+    safeMutexUnlock(&deque->mutex, callerDescription);
+    return found;
+}
+
+static bool workerDequeTrySteal(
+    struct WorkerDeque * const deque,
+    struct WorkerPoolTaskEntry * const entryOutPtr,
+    char const * const callerDescription
+) {
+    safeMutexLock(&deque->mutex, callerDescription);
+
+    bool const found = deque->tailIndex != deque->headIndex;
+    if (found) {
+        *entryOutPtr = deque->entries[deque->headIndex & deque->capacityMask];
+        deque->headIndex += 1;
+    }
+
+    safeMutexUnlock(&deque->mutex, callerDescription);
+    return found;
+}
+
+/**
+ * Take a task from the given worker's own deque, or else steal one from the other workers' deques in turn.
+ */
+static bool workerPoolTryTakeTask(
+    struct WorkerPool * const pool,
+    size_t const workerIndex,
+    struct WorkerPoolTaskEntry * const entryOutPtr
+) {
+    if (workerDequeTryPopTail(&pool->deques[workerIndex], entryOutPtr, "workerPoolTryTakeTask")) {
+        return true;
+    }
+
+    for (size_t i = 1; i < pool->workerCount; i += 1) {
+        size_t const victimIndex = (workerIndex + i) % pool->workerCount;
+        if (workerDequeTrySteal(&pool->deques[victimIndex], entryOutPtr, "workerPoolTryTakeTask")) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void *workerPoolThreadStart(void * const argAsVoidPtr) {
+    assert(argAsVoidPtr != NULL);
+    struct WorkerPoolThreadStartArg const * const argPtr = argAsVoidPtr;
+    struct WorkerPool * const pool = argPtr->pool;
+
+    currentWorker = argPtr;
+
+    while (true) {
+        struct WorkerPoolTaskEntry entry;
+        if (workerPoolTryTakeTask(pool, argPtr->workerIndex, &entry)) {
+            atomic_fetch_sub_explicit(&pool->queuedTaskCount, 1, memory_order_relaxed);
+            entry.task(entry.taskArg);
+            continue;
+        }
+
+        if (atomic_load_explicit(&pool->queuedTaskCount, memory_order_seq_cst) > 0) {
+            // A task is being pushed or another worker is just taking one; look again
+            continue;
+        }
+
+        safeMutexLock(&pool->idleMutex, "workerPoolThreadStart");
+        atomic_fetch_add_explicit(&pool->idleWorkerCount, 1, memory_order_seq_cst);
+        while (atomic_load_explicit(&pool->queuedTaskCount, memory_order_seq_cst) == 0 && !pool->shuttingDown) {
+            safeConditionWait(&pool->workAvailableCondition, &pool->idleMutex, "workerPoolThreadStart");
+        }
+        atomic_fetch_sub_explicit(&pool->idleWorkerCount, 1, memory_order_relaxed);
+        bool const stopping = pool->shuttingDown
+            && atomic_load_explicit(&pool->queuedTaskCount, memory_order_seq_cst) == 0;
+        safeMutexUnlock(&pool->idleMutex, "workerPoolThreadStart");
+
+        if (stopping) {
+            break;
+        }
+    }
+
+    currentWorker = NULL;
+    return NULL;
+}
+
+/**
+ * Initialize thread creation attributes from the given settings.
+ */
+static void initThreadAttributes(
+    pthread_attr_t * const attributesOutPtr,
+    struct ThreadSettings const * const settingsPtr,
+    char const * const callerDescription
+) {
+    int const initErrorCode = pthread_attr_init(attributesOutPtr);
+    if (initErrorCode != 0) {
+        abortWithErrorFmt(
+            "%s: Failed to initialize thread attributes using pthread_attr_init"
+            " (error code: %d; error message: \"%s\")",
+            callerDescription,
+            initErrorCode,
+            strerror(initErrorCode)
+        );
+    }
+
+    if (settingsPtr->stackSize > 0) {
+        int const stackSizeErrorCode = pthread_attr_setstacksize(attributesOutPtr, settingsPtr->stackSize);
+        if (stackSizeErrorCode != 0) {
+            abortWithErrorFmt(
+                "%s: Failed to set a thread stack size of %zu bytes using pthread_attr_setstacksize"
+                " (error code: %d; error message: \"%s\")",
+                callerDescription,
+                settingsPtr->stackSize,
+                stackSizeErrorCode,
+                strerror(stackSizeErrorCode)
+            );
+        }
+    }
+
+    if (settingsPtr->cpuCount > 0) {
+        guardNotNull(settingsPtr->cpus, "settingsPtr->cpus", "initThreadAttributes");
+
+        size_t cpuSetSize;
+        cpu_set_t * const cpuSet = createCpuSet(
+            settingsPtr->cpus,
+            settingsPtr->cpuCount,
+            &cpuSetSize,
+            callerDescription
+        );
+        int const affinityErrorCode = pthread_attr_setaffinity_np(attributesOutPtr, cpuSetSize, cpuSet);
+        CPU_FREE(cpuSet);
+        if (affinityErrorCode != 0) {
+            abortWithErrorFmt(
+                "%s: Failed to set thread affinity using pthread_attr_setaffinity_np"
+                " (error code: %d; error message: \"%s\")",
+                callerDescription,
+                affinityErrorCode,
+                strerror(affinityErrorCode)
+            );
+        }
+    }
+}
+
+/**
+ * Allocate a processor set holding the given processors. The caller is responsible for freeing it using CPU_FREE.
+ */
+static cpu_set_t *createCpuSet(
+    size_t const * const cpus,
+    size_t const cpuCount,
+    size_t * const cpuSetSizeOutPtr,
+    char const * const callerDescription
+) {
+    size_t maxCpu = 0;
+    for (size_t i = 0; i < cpuCount; i += 1) {
+        if (cpus[i] > maxCpu) {
+            maxCpu = cpus[i];
+        }
+    }
+    if (maxCpu >= (size_t)INT_MAX) {
+        abortWithErrorFmt("%s: Processor %zu is out of range", callerDescription, maxCpu);
+    }
+
+    cpu_set_t * const cpuSet = CPU_ALLOC(maxCpu + 1);
+    if (cpuSet == NULL) {
+        abortWithErrorFmt("%s: Failed to allocate a set of %zu processors", callerDescription, maxCpu + 1);
+    }
+    size_t const cpuSetSize = CPU_ALLOC_SIZE(maxCpu + 1);
+    CPU_ZERO_S(cpuSetSize, cpuSet);
+    for (size_t i = 0; i < cpuCount; i += 1) {
+        CPU_SET_S(cpus[i], cpuSetSize, cpuSet);
+    }
+
+    *cpuSetSizeOutPtr = cpuSetSize;
+    return cpuSet;
+}
+
+/**
+ * Restrict the calling thread to the processors of the given set.
+ */
+static void setCurrentThreadAffinity(
+    cpu_set_t const * const cpuSet,
+    size_t const cpuSetSize,
+    char const * const callerDescription
+) {
+    int const setErrorCode = pthread_setaffinity_np(pthread_self(), cpuSetSize, cpuSet);
+    if (setErrorCode != 0) {
+        abortWithErrorFmt(
+            "%s: Failed to set the affinity of the calling thread using pthread_setaffinity_np"
+            " (error code: %d; error message: \"%s\")",
+            callerDescription,
+            setErrorCode,
+            strerror(setErrorCode)
+        );
+    }
+}
@@ -0,0 +1,288 @@
+#define _GNU_SOURCE
+
+#include "../../include/util/uring.h"
+
+#include "../../include/util/memory.h"
+#include "../../include/util/guard.h"
+#include "../../include/util/error.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/**
+ * A minimal io_uring instance driven through the raw system calls, so no liburing is needed at build time. The ring
+ * indices shared with the kernel are accessed with acquire/release atomics as the io_uring ABI requires.
+ */
+struct Uring {
+    int ringFileDescriptor;
+
+    void *submissionRingMemory;
+    size_t submissionRingSize;
+    void *completionRingMemory;
+    size_t completionRingSize;
+    struct io_uring_sqe *submissionEntries;
+    size_t submissionEntriesSize;
+
+    unsigned int *submissionHeadPtr;
+    unsigned int *submissionTailPtr;
+    unsigned int submissionMask;
+    unsigned int submissionEntryCount;
+    unsigned int *submissionArray;
+    unsigned int pendingSubmissionCount;
+
+    unsigned int *completionHeadPtr;
+    unsigned int *completionTailPtr;
+    unsigned int completionMask;
+    struct io_uring_cqe *completionEntries;
+};
+
+static void *mapRingMemory(int ringFileDescriptor, size_t size, off_t offset);
+
+/**
+ * Create an io_uring instance. This can fail on kernels without io_uring, when it has been disabled (e.g. by a seccomp
+ * policy or the kernel.io_uring_disabled sysctl), or when the locked memory limit is too low, in which case the caller
+ * should fall back to ordinary system calls.
+ *
+ * @param entryCount The number of submission queue entries, which also bounds the number of requests in flight.
+ * @param callerDescription A description of the caller to be included in error messages. This could be the name of the
+ *                          calling function, plus extra information if useful.
+ *
+ * @returns The ring, or null if io_uring is unavailable. The caller is responsible for destroying the ring using
+ *          uringDestroy.
+ */
+struct Uring *tryUringCreate(unsigned int const entryCount, char const * const callerDescription) {
+    guard(entryCount > 0, "tryUringCreate: entryCount must be positive");
+    guardNotNull(callerDescription, "callerDescription", "tryUringCreate");
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof params);
+
+    long const setupResult = syscall(__NR_io_uring_setup, entryCount, &params);
+    if (setupResult < 0) {
+        return NULL;
+    }
+    int const ringFileDescriptor = (int)setupResult;
+
+    size_t const submissionRingSize = params.sq_off.array + params.sq_entries * sizeof (unsigned int);
+    size_t const completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+    bool const singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+    size_t const firstRingSize = (
+        singleMapping && completionRingSize > submissionRingSize ? completionRingSize : submissionRingSize
+    );
+    void * const submissionRingMemory = mapRingMemory(ringFileDescriptor, firstRingSize, IORING_OFF_SQ_RING);
+    void * const completionRingMemory = (
+        singleMapping
+            ? submissionRingMemory
+            : mapRingMemory(ringFileDescriptor, completionRingSize, IORING_OFF_CQ_RING)
+    );
+    size_t const submissionEntriesSize = params.sq_entries * sizeof (struct io_uring_sqe);
+    void * const submissionEntries = mapRingMemory(ringFileDescriptor, submissionEntriesSize, IORING_OFF_SQES);
+
+    if (submissionRingMemory == NULL || completionRingMemory == NULL || submissionEntries == NULL) {
+        if (submissionEntries != NULL) {
+            munmap(submissionEntries, submissionEntriesSize);
+        }
+        if (completionRingMemory != NULL && !singleMapping) {
+            munmap(completionRingMemory, completionRingSize);
+        }
+        if (submissionRingMemory != NULL) {
+            munmap(submissionRingMemory, firstRingSize);
+        }
+        close(ringFileDescriptor);
+        return NULL;
+    }
+
+    char * const submissionRingBytes = submissionRingMemory;
+    char * const completionRingBytes = completionRingMemory;
+
+    struct Uring * const ring = safeMalloc(sizeof *ring, callerDescription);
+    ring->ringFileDescriptor = ringFileDescriptor;
+    ring->submissionRingMemory = submissionRingMemory;
+    ring->submissionRingSize = firstRingSize;
+    ring->completionRingMemory = singleMapping ? NULL : completionRingMemory;
+    ring->completionRingSize = completionRingSize;
+    ring->submissionEntries = submissionEntries;
+    ring->submissionEntriesSize = submissionEntriesSize;
+
+    ring->submissionHeadPtr = (unsigned int *)(void *)&submissionRingBytes[params.sq_off.head];
+    ring->submissionTailPtr = (unsigned int *)(void *)&submissionRingBytes[params.sq_off.tail];
+    ring->submissionMask = *(unsigned int *)(void *)&submissionRingBytes[params.sq_off.ring_mask];
+    ring->submissionEntryCount = params.sq_entries;
+    ring->submissionArray = (unsigned int *)(void *)&submissionRingBytes[params.sq_off.array];
+    ring->pendingSubmissionCount = 0;
+
+    ring->completionHeadPtr = (unsigned int *)(void *)&completionRingBytes[params.cq_off.head];
+    ring->completionTailPtr = (unsigned int *)(void *)&completionRingBytes[params.cq_off.tail];
+    ring->completionMask = *(unsigned int *)(void *)&completionRingBytes[params.cq_off.ring_mask];
+    ring->completionEntries = (struct io_uring_cqe *)(void *)&completionRingBytes[params.cq_off.cqes];
+
+    return ring;
+}
+
+/**
+ * Queue a read request. The request is not sent to the kernel until uringSubmitAndWait is called.
+ *
+ * @param ring The ring.
+ * @param fileDescriptor The file descriptor to read from.
+ * @param buffer The buffer into which to read, which must stay valid until the request completes.
+ * @param length The maximum number of bytes to read.
+ * @param offset The file offset at which to read, or -1 to read from (and advance) the file's current position, as
+ *               required for pipes and other non-seekable files.
+ * @param userData A value identifying the request, returned with its completion.
+ *
+ * @returns True if the request was queued, or false if the submission queue is full.
+ */
+bool uringTryPrepareRead(
+    struct Uring * const ring,
+    int const fileDescriptor,
+    void * const buffer,
+    unsigned int const length,
+    int64_t const offset,
+    uint64_t const userData
+) {
+    guardNotNull(ring, "ring", "uringTryPrepareRead");
+    guardNotNull(buffer, "buffer", "uringTryPrepareRead");
+
+    unsigned int const head = __atomic_load_n(ring->submissionHeadPtr, __ATOMIC_ACQUIRE);
+    unsigned int const tail = *ring->submissionTailPtr;
+    if (tail - head >= ring->submissionEntryCount) {
+        return false;
+    }
+
+    unsigned int const index = tail & ring->submissionMask;
+    struct io_uring_sqe * const entryPtr = &ring->submissionEntries[index];
+    memset(entryPtr, 0, sizeof *entryPtr);
+    entryPtr->opcode = IORING_OP_READ;
+    entryPtr->fd = fileDescriptor;
+    entryPtr->addr = (uint64_t)(uintptr_t)buffer;
+    entryPtr->len = length;
+    entryPtr->off = (uint64_t)offset;
+    entryPtr->user_data = userData;
+
+    ring->submissionArray[index] = index;
+    __atomic_store_n(ring->submissionTailPtr, tail + 1, __ATOMIC_RELEASE);
+    ring->pendingSubmissionCount += 1;
+    return true;
+}
+
+/**
+ * Send all queued requests to the kernel, then wait until at least the given number of completions are available. If
+ * the operation fails, abort the program with an error message.
+ *
+ * @param ring The ring.
+ * @param waitCount The number of completions to wait for, which may be 0.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void uringSubmitAndWait(struct Uring * const ring, unsigned int const waitCount, char const * const callerDescription) {
+    guardNotNull(ring, "ring", "uringSubmitAndWait");
+    guardNotNull(callerDescription, "callerDescription", "uringSubmitAndWait");
+
+    while (true) {
+        unsigned int const flags = waitCount > 0 ? IORING_ENTER_GETEVENTS : 0;
+        long const enterResult = syscall(
+            __NR_io_uring_enter,
+            ring->ringFileDescriptor,
+            ring->pendingSubmissionCount,
+            waitCount,
+            flags,
+            NULL,
+            0
+        );
+        if (enterResult < 0) {
+            int const enterErrorCode = errno;
+            if (enterErrorCode == EINTR) {
+                continue;
+            }
+            char const * const enterErrorMessage = strerror(enterErrorCode);
+
+            abortWithErrorFmt(
+                "%s: Failed to submit to io_uring using io_uring_enter (error code: %d; error message: \"%s\")",
+                callerDescription,
+                enterErrorCode,
+                enterErrorMessage
+            );
+            return;
+        }
+
+        unsigned int const submittedCount = (unsigned int)enterResult;
+        ring->pendingSubmissionCount -= (
+            submittedCount < ring->pendingSubmissionCount ? submittedCount : ring->pendingSubmissionCount
+        );
+        if (ring->pendingSubmissionCount == 0) {
+            return;
+        }
+    }
+}
+
+/**
+ * Take the next available completion, if any, without waiting.
+ *
+ * @param ring The ring.
+ * @param userDataOutPtr Where to store the completed request's user data.
+ * @param resultOutPtr Where to store the request's result: the number of bytes read, or a negated errno value.
+ *
+ * @returns True if a completion was taken, or false if none is available.
+ */
+bool uringTryTakeCompletion(
+    struct Uring * const ring,
+    uint64_t * const userDataOutPtr,
+    int32_t * const resultOutPtr
+) {
+    guardNotNull(ring, "ring", "uringTryTakeCompletion");
+    guardNotNull(userDataOutPtr, "userDataOutPtr", "uringTryTakeCompletion");
+    guardNotNull(resultOutPtr, "resultOutPtr", "uringTryTakeCompletion");
+
+    unsigned int const head = *ring->completionHeadPtr;
+    unsigned int const tail = __atomic_load_n(ring->completionTailPtr, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return false;
+    }
+
+    struct io_uring_cqe const * const entryPtr = &ring->completionEntries[head & ring->completionMask];
+    *userDataOutPtr = entryPtr->user_data;
+    *resultOutPtr = entryPtr->res;
+
+    __atomic_store_n(ring->completionHeadPtr, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * Destroy the given ring. Any requests still in flight are cancelled by the kernel.
+ *
+ * @param ring The ring.
+ * @param callerDescription A description of the caller to be included in the error message. This could be the name of
+ *                          the calling function, plus extra information if useful.
+ */
+void uringDestroy(struct Uring * const ring, char const * const callerDescription) {
+    guardNotNull(ring, "ring", "uringDestroy");
+    guardNotNull(callerDescription, "callerDescription", "uringDestroy");
+
+    munmap(ring->submissionEntries, ring->submissionEntriesSize);
+    if (ring->completionRingMemory != NULL) {
+        munmap(ring->completionRingMemory, ring->completionRingSize);
+    }
+    munmap(ring->submissionRingMemory, ring->submissionRingSize);
+    close(ring->ringFileDescriptor);
+    free(ring);
+}
+
+static void *mapRingMemory(int const ringFileDescriptor, size_t const size, off_t const offset) {
+    void * const memory = mmap(
+        NULL,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        ringFileDescriptor,
+        offset
+    );
+    return memory == MAP_FAILED ? NULL : memory;
+}